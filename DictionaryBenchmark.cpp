@@ -0,0 +1,503 @@
+/*
+* DictionaryBenchmark
+*
+* Compares shared lookup tables under read-heavy mixes: Dictionary behind a
+* std::mutex, Dictionary behind a std::shared_mutex, and ConcurrentDictionary.
+* Every run fills --keys keys, then has each thread do --ops random lookups,
+* inserts and removes in rounds of --round ops. Between rounds all threads
+* wait for ConcurrentDictionary::Reclaim(), as a game would once per frame,
+* and the other tables sit through the same barriers so the numbers compare.
+* Writes are split evenly between inserts and removes, so the table keeps
+* about the same size. One row per table, thread count and read percentage.
+*
+* Usage: DictionaryBenchmark [--threads 1,2,4,...] [--reads 100,99,90]
+*                            [--keys 4096] [--ops 200000] [--round 5000]
+*                            [--format csv|json] [--output path]
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "Utils/ConcurrentDictionary.h"
+#include "Utils/Dictionary.h"
+#include "Utils/Random.h"
+
+namespace Config
+{
+    constexpr uint32_t keys = 4096U;
+    constexpr uint32_t opsPerThread = 200000U;
+    constexpr uint32_t opsPerRound = 5000U;
+    constexpr uint32_t maxListSize = 32U;
+}
+
+enum TableType
+{
+    TableType_Mutex,
+    TableType_SharedMutex,
+    TableType_Concurrent,
+    TableType_Count,
+};
+
+constexpr const char* TABLE_NAMES[TableType_Count] = { "mutex", "shared_mutex", "concurrent" };
+
+struct Options
+{
+    const char* myOutputPath = nullptr;
+    bool myIsJson = false;
+
+    uint32_t myThreadCounts[Config::maxListSize];
+    uint32_t myThreadCountsSize = 0U;
+    uint32_t myReadPercents[Config::maxListSize];
+    uint32_t myReadPercentsSize = 0U;
+
+    uint32_t myKeyCount = Config::keys;
+    uint32_t myOpsPerThread = Config::opsPerThread;
+    uint32_t myOpsPerRound = Config::opsPerRound;
+};
+
+struct RunResult
+{
+    TableType myTable;
+    uint32_t myThreadCount;
+    uint32_t myReadPercent;
+    uint64_t myOps;
+    double mySeconds;
+    double myOpsPerSecond;
+    /* Keeps the lookups from being optimized away, and doubles as a sanity check. */
+    uint64_t myHits;
+};
+
+/* Spreads sequential keys, like Dictionary's users do with their own hash functors. */
+struct HashKey
+{
+    uint64_t operator()(uint64_t aKey) const
+    {
+        aKey ^= aKey >> 33;
+        aKey *= 0xFF51AFD7ED558CCDULL;
+        aKey ^= aKey >> 33;
+        return aKey;
+    }
+};
+
+using LockedDictionary = Dictionary<uint64_t, uint64_t, HashKey>;
+using SharedDictionary = ConcurrentDictionary<uint64_t, uint64_t, HashKey>;
+
+/* Dictionary::Insert() does not check for the key, so existing keys are overwritten through operator[]. */
+static void DictionaryWrite(LockedDictionary* aDictionary, uint64_t aKey, bool anIsInsert)
+{
+    if (anIsInsert)
+    {
+        /* Null when the table could not grow; the key then simply stays absent. */
+        uint64_t* const value = (*aDictionary)[aKey];
+        if (value)
+        {
+            *value = aKey;
+        }
+    }
+    else
+    {
+        aDictionary->Remove(aKey);
+    }
+}
+
+/* Lets every thread finish a round before the main thread reclaims and starts the next one. */
+class RoundBarrier
+{
+public:
+    explicit RoundBarrier(uint32_t aThreadCount)
+        : myThreadCount(aThreadCount)
+        , myArrived(0U)
+        , myRound(0U)
+    {
+    }
+
+    /* Blocks until the main thread calls Release(). Returns the new round. */
+    uint32_t Arrive(uint32_t aRound)
+    {
+        std::unique_lock<std::mutex> lock(myMutex);
+        if (++myArrived == myThreadCount)
+        {
+            myAllArrived.notify_one();
+        }
+        myReleased.wait(lock, [&] { return myRound != aRound; });
+
+        return myRound;
+    }
+
+    void WaitForAll()
+    {
+        std::unique_lock<std::mutex> lock(myMutex);
+        myAllArrived.wait(lock, [&] { return myArrived == myThreadCount; });
+    }
+
+    void Release()
+    {
+        {
+            std::lock_guard<std::mutex> lock(myMutex);
+            myArrived = 0U;
+            ++myRound;
+        }
+        myReleased.notify_all();
+    }
+
+private:
+    std::mutex myMutex;
+    std::condition_variable myAllArrived;
+    std::condition_variable myReleased;
+    uint32_t myThreadCount;
+    uint32_t myArrived;
+    uint32_t myRound;
+};
+
+static bool ParseList(const char* aText, uint32_t* someValuesOut, uint32_t* aSizeOut)
+{
+    *aSizeOut = 0U;
+    while (*aText && *aSizeOut < Config::maxListSize)
+    {
+        char* end = nullptr;
+        const unsigned long value = strtoul(aText, &end, 10);
+        if (end == aText)
+        {
+            return false;
+        }
+
+        someValuesOut[(*aSizeOut)++] = (uint32_t)value;
+        aText = *end == ',' ? end + 1 : end;
+    }
+
+    return *aSizeOut > 0U && *aText == '\0';
+}
+
+static bool ParseOptions(int argc, char** argv, Options* anOptionsOut)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* const arg = argv[i];
+        const char* const value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        bool isValid = true;
+        if (!value)
+        {
+            isValid = false;
+        }
+        else if (strcmp(arg, "--output") == 0)
+        {
+            anOptionsOut->myOutputPath = value;
+        }
+        else if (strcmp(arg, "--format") == 0)
+        {
+            anOptionsOut->myIsJson = strcmp(value, "json") == 0;
+            isValid = anOptionsOut->myIsJson || strcmp(value, "csv") == 0;
+        }
+        else if (strcmp(arg, "--threads") == 0)
+        {
+            isValid = ParseList(value, anOptionsOut->myThreadCounts, &anOptionsOut->myThreadCountsSize);
+        }
+        else if (strcmp(arg, "--reads") == 0)
+        {
+            isValid = ParseList(value, anOptionsOut->myReadPercents, &anOptionsOut->myReadPercentsSize);
+        }
+        else if (strcmp(arg, "--keys") == 0)
+        {
+            anOptionsOut->myKeyCount = (uint32_t)strtoul(value, nullptr, 10);
+        }
+        else if (strcmp(arg, "--ops") == 0)
+        {
+            anOptionsOut->myOpsPerThread = (uint32_t)strtoul(value, nullptr, 10);
+        }
+        else if (strcmp(arg, "--round") == 0)
+        {
+            anOptionsOut->myOpsPerRound = (uint32_t)strtoul(value, nullptr, 10);
+        }
+        else
+        {
+            isValid = false;
+        }
+
+        if (!isValid)
+        {
+            fprintf(stderr, "DICTIONARYBENCHMARK: Bad argument '%s'.\n", arg);
+            return false;
+        }
+        ++i;
+    }
+
+    for (uint32_t i = 0U; i < anOptionsOut->myThreadCountsSize; ++i)
+    {
+        if (anOptionsOut->myThreadCounts[i] == 0U)
+        {
+            fprintf(stderr, "DICTIONARYBENCHMARK: Thread counts start at 1.\n");
+            return false;
+        }
+    }
+    for (uint32_t i = 0U; i < anOptionsOut->myReadPercentsSize; ++i)
+    {
+        if (anOptionsOut->myReadPercents[i] > 100U)
+        {
+            fprintf(stderr, "DICTIONARYBENCHMARK: Read percentages go up to 100.\n");
+            return false;
+        }
+    }
+    if (anOptionsOut->myKeyCount == 0U || anOptionsOut->myOpsPerRound == 0U)
+    {
+        fprintf(stderr, "DICTIONARYBENCHMARK: --keys and --round have to be at least 1.\n");
+        return false;
+    }
+
+    /* Defaults: doubling thread counts up to 32, and mostly-read mixes. */
+    if (anOptionsOut->myThreadCountsSize == 0U)
+    {
+        for (uint32_t threads = 1U; threads <= 32U; threads *= 2U)
+        {
+            anOptionsOut->myThreadCounts[anOptionsOut->myThreadCountsSize++] = threads;
+        }
+    }
+    if (anOptionsOut->myReadPercentsSize == 0U)
+    {
+        constexpr uint32_t readPercents[] = { 100U, 99U, 90U };
+        for (uint32_t percent : readPercents)
+        {
+            anOptionsOut->myReadPercents[anOptionsOut->myReadPercentsSize++] = percent;
+        }
+    }
+
+    return true;
+}
+
+static RunResult Run(const Options& someOptions, TableType aTable, uint32_t aThreadCount, uint32_t aReadPercent)
+{
+    LockedDictionary lockedDictionary(someOptions.myKeyCount * 2U);
+    std::mutex mutex;
+    std::shared_mutex sharedMutex;
+    SharedDictionary sharedDictionary;
+
+    for (uint64_t key = 0U; key < someOptions.myKeyCount; ++key)
+    {
+        if (aTable == TableType_Concurrent)
+        {
+            sharedDictionary.Insert(key, key);
+        }
+        else
+        {
+            DictionaryWrite(&lockedDictionary, key, true);
+        }
+    }
+
+    const uint32_t roundCount = (someOptions.myOpsPerThread + someOptions.myOpsPerRound - 1U) / someOptions.myOpsPerRound;
+    RoundBarrier barrier(aThreadCount);
+    std::vector<uint64_t> hits(aThreadCount, 0U);
+
+    auto work = [&](uint32_t aThreadIndex)
+    {
+        Random random(aThreadIndex + 1U);
+        uint64_t threadHits = 0U;
+        uint32_t opsLeft = someOptions.myOpsPerThread;
+
+        for (uint32_t round = 0U; round < roundCount; ++round)
+        {
+            const uint32_t opCount = opsLeft < someOptions.myOpsPerRound ? opsLeft : someOptions.myOpsPerRound;
+            opsLeft -= opCount;
+
+            for (uint32_t op = 0U; op < opCount; ++op)
+            {
+                const uint64_t key = random.Next() % someOptions.myKeyCount;
+                const bool isRead = random.Next() % 100U < aReadPercent;
+                const bool isInsert = (random.Next() & 1U) != 0U;
+
+                switch (aTable)
+                {
+                case TableType_Mutex:
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (isRead)
+                    {
+                        threadHits += lockedDictionary.Get(key) != nullptr;
+                    }
+                    else
+                    {
+                        DictionaryWrite(&lockedDictionary, key, isInsert);
+                    }
+                    break;
+                }
+                case TableType_SharedMutex:
+                {
+                    if (isRead)
+                    {
+                        std::shared_lock<std::shared_mutex> lock(sharedMutex);
+                        threadHits += lockedDictionary.Get(key) != nullptr;
+                    }
+                    else
+                    {
+                        std::lock_guard<std::shared_mutex> lock(sharedMutex);
+                        DictionaryWrite(&lockedDictionary, key, isInsert);
+                    }
+                    break;
+                }
+                case TableType_Concurrent:
+                {
+                    if (isRead)
+                    {
+                        threadHits += sharedDictionary.Contains(key);
+                    }
+                    else if (isInsert)
+                    {
+                        sharedDictionary.Insert(key, key);
+                    }
+                    else
+                    {
+                        sharedDictionary.Remove(key);
+                    }
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+
+            barrier.Arrive(round);
+        }
+
+        hits[aThreadIndex] = threadHits;
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0U; t < aThreadCount; ++t)
+    {
+        threads.emplace_back(work, t);
+    }
+
+    for (uint32_t round = 0U; round < roundCount; ++round)
+    {
+        barrier.WaitForAll();
+        sharedDictionary.Reclaim();
+        barrier.Release();
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    RunResult result;
+    result.myTable = aTable;
+    result.myThreadCount = aThreadCount;
+    result.myReadPercent = aReadPercent;
+    result.myOps = (uint64_t)someOptions.myOpsPerThread * aThreadCount;
+    result.mySeconds = seconds;
+    result.myOpsPerSecond = seconds > 0.0 ? (double)result.myOps / seconds : 0.0;
+    result.myHits = 0U;
+    for (uint64_t threadHits : hits)
+    {
+        result.myHits += threadHits;
+    }
+
+    return result;
+}
+
+static void WriteResults(FILE* aFile, const Options& someOptions, const std::vector<RunResult>& someResults)
+{
+    if (someOptions.myIsJson)
+    {
+        fprintf(aFile, "{\"keys\":%u,\"opsPerThread\":%u,\"opsPerRound\":%u,\"runs\":[",
+            someOptions.myKeyCount, someOptions.myOpsPerThread, someOptions.myOpsPerRound);
+    }
+    else
+    {
+        fputs("table,threads,read_percent,ops,seconds,ops_per_s,hits\n", aFile);
+    }
+
+    for (size_t i = 0U; i < someResults.size(); ++i)
+    {
+        const RunResult& r = someResults[i];
+        if (someOptions.myIsJson)
+        {
+            fprintf(aFile, "%s\n{\"table\":\"%s\",\"threads\":%u,\"readPercent\":%u,\"ops\":%llu,\"seconds\":%.4f,\"opsPerSecond\":%.0f,\"hits\":%llu}",
+                i > 0U ? "," : "", TABLE_NAMES[r.myTable], r.myThreadCount, r.myReadPercent,
+                (unsigned long long)r.myOps, r.mySeconds, r.myOpsPerSecond, (unsigned long long)r.myHits);
+        }
+        else
+        {
+            fprintf(aFile, "%s,%u,%u,%llu,%.4f,%.0f,%llu\n",
+                TABLE_NAMES[r.myTable], r.myThreadCount, r.myReadPercent,
+                (unsigned long long)r.myOps, r.mySeconds, r.myOpsPerSecond, (unsigned long long)r.myHits);
+        }
+    }
+
+    if (someOptions.myIsJson)
+    {
+        fputs("\n]}\n", aFile);
+    }
+}
+
+static bool SaveResults(const Options& someOptions, const std::vector<RunResult>& someResults)
+{
+    if (!someOptions.myOutputPath)
+    {
+        WriteResults(stdout, someOptions, someResults);
+        return true;
+    }
+
+    char tempPath[512];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", someOptions.myOutputPath);
+
+    FILE* file = fopen(tempPath, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    WriteResults(file, someOptions, someResults);
+
+    const bool succeeded = !ferror(file);
+    if (fclose(file) != 0 || !succeeded || rename(tempPath, someOptions.myOutputPath) != 0)
+    {
+        remove(tempPath);
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, &options))
+    {
+        return 1;
+    }
+
+    std::vector<RunResult> results;
+    for (uint32_t r = 0U; r < options.myReadPercentsSize; ++r)
+    {
+        for (uint32_t t = 0U; t < options.myThreadCountsSize; ++t)
+        {
+            for (uint32_t table = 0U; table < TableType_Count; ++table)
+            {
+                fprintf(stderr, "DICTIONARYBENCHMARK: %s, %u threads, %u%% reads...\n",
+                    TABLE_NAMES[table], options.myThreadCounts[t], options.myReadPercents[r]);
+                results.push_back(Run(options, (TableType)table, options.myThreadCounts[t], options.myReadPercents[r]));
+            }
+        }
+    }
+
+    if (!SaveResults(options, results))
+    {
+        fprintf(stderr, "DICTIONARYBENCHMARK: [%s] Failed to write results.\n", options.myOutputPath);
+        return 1;
+    }
+
+    return 0;
+}
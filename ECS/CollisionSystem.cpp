@@ -0,0 +1,338 @@
+#include "CollisionSystem.h"
+
+#include "../Utils/Profiler.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COLLISION_USE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Systems
+{
+    constexpr uint32_t COLLISION_GATHER_BATCH_SIZE = 256U;
+    constexpr uint32_t COLLISION_SWEEP_BATCH_SIZE = 32U;
+    /* Pairs a sweep batch collects before publishing them with a single atomic add. */
+    constexpr uint32_t COLLISION_LOCAL_PAIRS = 256U;
+    constexpr uint32_t COLLISION_RESOLVE_BATCH_SIZE = 64U;
+
+    static_assert(MAX_ENTITIES <= 0x10000U, "Pairs pack two sweep indices into 16 bits each.");
+
+    /* Maps a float to an unsigned integer with the same ordering. */
+    static uint32_t OrderableBits(float aValue)
+    {
+        uint32_t bits;
+        memcpy(&bits, &aValue, sizeof(bits));
+
+        return bits & 0x80000000U ? ~bits : bits | 0x80000000U;
+    }
+
+    struct PairBuffer
+    {
+        uint32_t myPairs[COLLISION_LOCAL_PAIRS];
+        uint32_t myCount;
+    };
+
+    static void FlushPairs(CollisionState* aState, PairBuffer& aBuffer)
+    {
+        if (aBuffer.myCount == 0U)
+        {
+            return;
+        }
+
+        const uint32_t first = aState->myPairCount.fetch_add(aBuffer.myCount, std::memory_order_relaxed);
+        assert(first + aBuffer.myCount <= MAX_COLLISION_PAIRS && "More overlapping pairs than pairs of entities.");
+        for (uint32_t i = 0U; i < aBuffer.myCount; ++i)
+        {
+            aState->myPairs[first + i] = aBuffer.myPairs[i];
+        }
+        aBuffer.myCount = 0U;
+    }
+
+    static void AddPair(CollisionState* aState, PairBuffer& aBuffer, uint32_t aFirst, uint32_t aSecond)
+    {
+        aBuffer.myPairs[aBuffer.myCount++] = aFirst << 16 | aSecond;
+        if (aBuffer.myCount == COLLISION_LOCAL_PAIRS)
+        {
+            FlushPairs(aState, aBuffer);
+        }
+    }
+
+    /* Tests sphere i against every later sphere whose x interval starts before sphere i's ends. */
+    static void SweepSphere(CollisionState* aState, PairBuffer& aBuffer, uint32_t i)
+    {
+        const float maxX = aState->myMaxX[i];
+        const uint32_t count = aState->myCount;
+
+#if defined(COLLISION_USE_SSE)
+        const __m128 maxX4 = _mm_set1_ps(maxX);
+        const __m128 x4 = _mm_set1_ps(aState->myX[i]);
+        const __m128 y4 = _mm_set1_ps(aState->myY[i]);
+        const __m128 z4 = _mm_set1_ps(aState->myZ[i]);
+        const __m128 r4 = _mm_set1_ps(aState->myRadii[i]);
+
+        for (uint32_t j = i + 1; j < count; j += COLLISION_LANES)
+        {
+            const __m128 inRange = _mm_cmple_ps(_mm_loadu_ps(aState->myMinX + j), maxX4);
+            const int inRangeMask = _mm_movemask_ps(inRange);
+            if (inRangeMask == 0)
+            {
+                break;
+            }
+
+            const __m128 dx = _mm_sub_ps(_mm_loadu_ps(aState->myX + j), x4);
+            const __m128 dy = _mm_sub_ps(_mm_loadu_ps(aState->myY + j), y4);
+            const __m128 dz = _mm_sub_ps(_mm_loadu_ps(aState->myZ + j), z4);
+            const __m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            const __m128 radiusSum = _mm_add_ps(_mm_loadu_ps(aState->myRadii + j), r4);
+
+            const int overlapMask = _mm_movemask_ps(_mm_and_ps(inRange, _mm_cmplt_ps(distanceSquared, _mm_mul_ps(radiusSum, radiusSum))));
+            for (uint32_t lane = 0U; overlapMask && lane < COLLISION_LANES; ++lane)
+            {
+                if ((overlapMask >> lane) & 1)
+                {
+                    AddPair(aState, aBuffer, i, j + lane);
+                }
+            }
+
+            /* Sorted by min x, so once a lane falls out of range every later sphere does too. */
+            if (inRangeMask != 0xF)
+            {
+                break;
+            }
+        }
+#else
+        for (uint32_t j = i + 1; j < count && aState->myMinX[j] <= maxX; ++j)
+        {
+            const float dx = aState->myX[j] - aState->myX[i];
+            const float dy = aState->myY[j] - aState->myY[i];
+            const float dz = aState->myZ[j] - aState->myZ[i];
+            const float radiusSum = aState->myRadii[j] + aState->myRadii[i];
+
+            if (dx * dx + dy * dy + dz * dz < radiusSum * radiusSum)
+            {
+                AddPair(aState, aBuffer, i, j);
+            }
+        }
+#endif
+    }
+
+    /* Flips the part of aVelocity that points along aNormal, if it does. Returns whether it did. */
+    static bool Reflect(Vector3& aVelocity, const Vector3& aNormal)
+    {
+        const float along = aVelocity.x * aNormal.x + aVelocity.y * aNormal.y + aVelocity.z * aNormal.z;
+        if (along <= 0.f)
+        {
+            return false;
+        }
+
+        aVelocity.x -= 2.f * along * aNormal.x;
+        aVelocity.y -= 2.f * along * aNormal.y;
+        aVelocity.z -= 2.f * along * aNormal.z;
+        return true;
+    }
+
+    static void ResolvePair(
+        ComponentList<TransformComponent>* someTransformComps,
+        ComponentList<MovementComponent>* someMovementComps,
+        CollisionState* aState,
+        uint32_t aFirst,
+        uint32_t aSecond)
+    {
+        /* Earlier pairs may already have pushed these two apart. */
+        Vector3 normal = { aState->myX[aSecond] - aState->myX[aFirst], aState->myY[aSecond] - aState->myY[aFirst], aState->myZ[aSecond] - aState->myZ[aFirst] };
+        const float distance = sqrtf(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+        const float penetration = aState->myRadii[aFirst] + aState->myRadii[aSecond] - distance;
+        if (penetration <= 0.f)
+        {
+            return;
+        }
+
+        if (distance > 1e-6f)
+        {
+            normal = { normal.x / distance, normal.y / distance, normal.z / distance };
+        }
+        else
+        {
+            normal = { 1.f, 0.f, 0.f };
+        }
+
+        const Entity first = aState->myEntities[aFirst];
+        const Entity second = aState->myEntities[aSecond];
+        /* Read only; pairs in the same batch touch other entities, so lookups are safe in parallel. */
+        const bool firstMoves = someMovementComps->HasComponent(first);
+        const bool secondMoves = someMovementComps->HasComponent(second);
+        if (!firstMoves && !secondMoves)
+        {
+            return;
+        }
+
+        /* Entities without a MovementComponent are static and take none of the push. */
+        const float firstShare = !firstMoves ? 0.f : (!secondMoves ? 1.f : 0.5f);
+        const float secondShare = 1.f - firstShare;
+
+        const Vector3 firstPush = { -normal.x * penetration * firstShare, -normal.y * penetration * firstShare, -normal.z * penetration * firstShare };
+        const Vector3 secondPush = { normal.x * penetration * secondShare, normal.y * penetration * secondShare, normal.z * penetration * secondShare };
+
+        Vector3& firstPosition = someTransformComps->GetComponent(first).myPosition;
+        Vector3& secondPosition = someTransformComps->GetComponent(second).myPosition;
+        firstPosition = { firstPosition.x + firstPush.x, firstPosition.y + firstPush.y, firstPosition.z + firstPush.z };
+        secondPosition = { secondPosition.x + secondPush.x, secondPosition.y + secondPush.y, secondPosition.z + secondPush.z };
+
+        aState->myX[aFirst] += firstPush.x;
+        aState->myY[aFirst] += firstPush.y;
+        aState->myZ[aFirst] += firstPush.z;
+        aState->myX[aSecond] += secondPush.x;
+        aState->myY[aSecond] += secondPush.y;
+        aState->myZ[aSecond] += secondPush.z;
+
+        /* Marking changes writes list-wide state, so it waits until every batch is done. */
+        aState->myIsPushed[aFirst] = true;
+        aState->myIsPushed[aSecond] = true;
+
+        if (firstMoves && Reflect(someMovementComps->GetComponent(first).myVelocity, normal))
+        {
+            aState->myIsReflected[aFirst] = true;
+        }
+        if (secondMoves && Reflect(someMovementComps->GetComponent(second).myVelocity, { -normal.x, -normal.y, -normal.z }))
+        {
+            aState->myIsReflected[aSecond] = true;
+        }
+    }
+}
+
+void Systems::Collide(
+    ComponentList<TransformComponent>* someTransformComps,
+    ComponentList<MovementComponent>* someMovementComps,
+    ComponentList<ModelComponent>* someModelComps,
+    CollisionState* aState,
+    JobSystem* aJobSystem)
+{
+    PROFILE_ZONE("Systems::Collide");
+
+    const ModelComponent* modelList = someModelComps->GetDenseComponents();
+    const uint32_t count = someModelComps->GetSize();
+    aState->myCount = count;
+
+    aJobSystem->ParallelFor(count, COLLISION_GATHER_BATCH_SIZE, [&](uint32_t aBegin, uint32_t anEnd)
+    {
+        for (uint32_t compIndex = aBegin; compIndex < anEnd; ++compIndex)
+        {
+            const ModelComponent& model = modelList[compIndex];
+            const Vector3& position = someTransformComps->GetComponent(someModelComps->GetEntityFromComponent(compIndex)).myPosition;
+            const BoundingSphere bounds = ModelManager::GetBoundingSphere(model.myModel);
+
+            const Vector4 sphere = {
+                position.x + bounds.myCenter.x * model.myScale,
+                position.y + bounds.myCenter.y * model.myScale,
+                position.z + bounds.myCenter.z * model.myScale,
+                bounds.myRadius * model.myScale,
+            };
+            aState->myUnsortedSpheres[compIndex] = sphere;
+
+            /* Ties break on the entity, not the dense index, so the order does not depend on add/remove history. */
+            const uint64_t entity = someModelComps->GetEntityFromComponent(compIndex);
+            aState->mySortKeys[compIndex] = (uint64_t)OrderableBits(sphere.x - sphere.w) << 32 | entity << 16 | compIndex;
+        }
+    });
+
+    std::sort(aState->mySortKeys, aState->mySortKeys + count);
+
+    aJobSystem->ParallelFor(count, COLLISION_GATHER_BATCH_SIZE, [&](uint32_t aBegin, uint32_t anEnd)
+    {
+        for (uint32_t i = aBegin; i < anEnd; ++i)
+        {
+            const uint32_t compIndex = (uint32_t)(aState->mySortKeys[i] & 0xFFFFU);
+            const Vector4& sphere = aState->myUnsortedSpheres[compIndex];
+
+            aState->myMinX[i] = sphere.x - sphere.w;
+            aState->myMaxX[i] = sphere.x + sphere.w;
+            aState->myX[i] = sphere.x;
+            aState->myY[i] = sphere.y;
+            aState->myZ[i] = sphere.z;
+            aState->myRadii[i] = sphere.w;
+            aState->myEntities[i] = someModelComps->GetEntityFromComponent(compIndex);
+        }
+    });
+
+    /* Padding lanes never start inside anyone's x interval. */
+    for (uint32_t lane = 0U; lane < COLLISION_LANES; ++lane)
+    {
+        aState->myMinX[count + lane] = INFINITY;
+        aState->myMaxX[count + lane] = -INFINITY;
+        aState->myX[count + lane] = aState->myY[count + lane] = aState->myZ[count + lane] = 0.f;
+        aState->myRadii[count + lane] = 0.f;
+    }
+
+    aState->myPairCount.store(0U, std::memory_order_relaxed);
+    aJobSystem->ParallelFor(count, COLLISION_SWEEP_BATCH_SIZE, [&](uint32_t aBegin, uint32_t anEnd)
+    {
+        PairBuffer buffer;
+        buffer.myCount = 0U;
+
+        for (uint32_t i = aBegin; i < anEnd; ++i)
+        {
+            SweepSphere(aState, buffer, i);
+        }
+        FlushPairs(aState, buffer);
+    });
+
+    const uint32_t pairCount = aState->myPairCount.load(std::memory_order_relaxed);
+
+    /* Batches publish in whatever order they finish; sorting makes resolution order fixed. */
+    std::sort(aState->myPairs, aState->myPairs + pairCount);
+
+    /*
+    * Each pair goes into the first batch after the ones holding earlier pairs
+    * of either entity. Pairs within a batch then share no entity, and every
+    * entity sees its pairs in sweep order, as if they ran one at a time.
+    */
+    memset(aState->myNextBatches, 0, sizeof(uint32_t) * count);
+    for (uint32_t p = 0U; p < pairCount; ++p)
+    {
+        const uint32_t first = (uint32_t)(aState->myPairs[p] >> 16) & 0xFFFFU;
+        const uint32_t second = (uint32_t)aState->myPairs[p] & 0xFFFFU;
+        const uint32_t batch = std::max(aState->myNextBatches[first], aState->myNextBatches[second]);
+
+        aState->myPairs[p] |= (uint64_t)batch << 32;
+        aState->myNextBatches[first] = aState->myNextBatches[second] = batch + 1U;
+    }
+    std::sort(aState->myPairs, aState->myPairs + pairCount);
+
+    memset(aState->myIsPushed, 0, sizeof(bool) * count);
+    memset(aState->myIsReflected, 0, sizeof(bool) * count);
+    for (uint32_t batchBegin = 0U; batchBegin < pairCount; )
+    {
+        uint32_t batchEnd = batchBegin + 1U;
+        while (batchEnd < pairCount && aState->myPairs[batchEnd] >> 32 == aState->myPairs[batchBegin] >> 32)
+        {
+            ++batchEnd;
+        }
+
+        aJobSystem->ParallelFor(batchEnd - batchBegin, COLLISION_RESOLVE_BATCH_SIZE, [&](uint32_t aBegin, uint32_t anEnd)
+        {
+            for (uint32_t p = batchBegin + aBegin; p < batchBegin + anEnd; ++p)
+            {
+                ResolvePair(someTransformComps, someMovementComps, aState, (uint32_t)(aState->myPairs[p] >> 16) & 0xFFFFU, (uint32_t)aState->myPairs[p] & 0xFFFFU);
+            }
+        });
+        batchBegin = batchEnd;
+    }
+
+    for (uint32_t i = 0U; i < count; ++i)
+    {
+        if (aState->myIsPushed[i])
+        {
+            someTransformComps->MarkChanged(aState->myEntities[i]);
+        }
+        if (aState->myIsReflected[i])
+        {
+            someMovementComps->MarkChanged(aState->myEntities[i]);
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#if !defined(COLLISIONSYSTEM_H_)
+#define COLLISIONSYSTEM_H_
+
+#pragma once
+
+#include "ComponentList.h"
+#include "Components.h"
+
+#include "../Utils/JobSystem.h"
+
+#include <atomic>
+
+/*
+* Every pair of entities can overlap at once, so no pair is ever dropped. A
+* smaller buffer would have to drop pairs in whatever order the sweep batches
+* happen to finish, and lockstep worlds would then diverge.
+*/
+constexpr uint32_t MAX_COLLISION_PAIRS = MAX_ENTITIES * (MAX_ENTITIES - 1U) / 2U;
+/* Sweep arrays are padded so the last SIMD group can always be loaded whole. */
+constexpr uint32_t COLLISION_LANES = 4U;
+
+/* Sweep and contact scratch for Systems::Collide, kept between ticks to avoid reallocating. */
+struct CollisionState
+{
+    /* World-space model spheres in sweep order, sorted by their lowest x. */
+    float myMinX[MAX_ENTITIES + COLLISION_LANES];
+    float myMaxX[MAX_ENTITIES + COLLISION_LANES];
+    float myX[MAX_ENTITIES + COLLISION_LANES];
+    float myY[MAX_ENTITIES + COLLISION_LANES];
+    float myZ[MAX_ENTITIES + COLLISION_LANES];
+    float myRadii[MAX_ENTITIES + COLLISION_LANES];
+    Entity myEntities[MAX_ENTITIES];
+    uint32_t myCount;
+
+    /* Spheres in dense ModelComponent order and their (orderable min x << 32 | dense index) keys. */
+    Vector4 myUnsortedSpheres[MAX_ENTITIES];
+    uint64_t mySortKeys[MAX_ENTITIES];
+
+    /*
+    * Overlapping pairs as (first sweep index << 16 | second sweep index) in the
+    * low half. Once sorted, the resolve batch goes in the high half and they are
+    * sorted again, so each batch is contiguous and in sweep order.
+    */
+    uint64_t myPairs[MAX_COLLISION_PAIRS];
+    std::atomic<uint32_t> myPairCount;
+
+    /* Per sweep index: the first batch free to take its next pair, and whether resolving moved or turned it. */
+    uint32_t myNextBatches[MAX_ENTITIES];
+    bool myIsPushed[MAX_ENTITIES];
+    bool myIsReflected[MAX_ENTITIES];
+};
+
+namespace Systems
+{
+    /*
+    * Sort-and-sweep over the scaled model bounding spheres, then pushes every
+    * overlapping pair apart and reflects the velocities that point into the
+    * contact. Both run in parallel. Pairs are resolved in batches that share
+    * no entity, and each pair's batch comes after every earlier pair (in sweep
+    * order) of its two entities, so the result is the same as resolving them
+    * one by one in sweep order, whatever the worker count.
+    */
+    void Collide(
+        ComponentList<TransformComponent>* someTransformComps,
+        ComponentList<MovementComponent>* someMovementComps,
+        ComponentList<ModelComponent>* someModelComps,
+        CollisionState* aState,
+        JobSystem* aJobSystem);
+}
+
+#endif // COLLISIONSYSTEM_H_
@@ -6,12 +6,47 @@
 #include "EntityService.h"
 #include "../Utils/BitArray.h"
 
-template <class ComponentType>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+constexpr uint32_t MAX_COMPONENT_OBSERVERS = 4U;
+constexpr uint32_t MAX_MEMBERSHIP_LISTENERS = 8U;
+
+/*
+* Components are stored densely, with maps between entities and array
+* indices. Empty structs are tags instead: they carry no data, so the
+* specialization below keeps nothing but a bitset of the entities that have
+* them.
+*/
+template <class ComponentType, bool IsTag = std::is_empty<ComponentType>::value>
 class ComponentList
 {
 public:
+	/*
+	* Observers hear about adds, removes and changes once per DispatchEvents()
+	* call, as entity lists in ascending order, instead of polling every frame.
+	* Events are coalesced: a component added and removed between two
+	* dispatches is never reported, and an added one is not also reported as
+	* changed. A removed component can still be read with GetRemovedComponent()
+	* during its on-remove callback; the values are only kept while at least
+	* one observer has an on-remove callback, and only as far as memory for
+	* them can be allocated. Any callback may be null.
+	*/
+	using ObserverCallback = void (*)(ComponentList& aList, const Entity* someEntities, uint32_t aCount, void* aUserData);
+
+	struct Observer
+	{
+		ObserverCallback myOnAdd = nullptr;
+		ObserverCallback myOnRemove = nullptr;
+		ObserverCallback myOnChange = nullptr;
+		void* myUserData = nullptr;
+	};
+
 	ComponentList();
-	~ComponentList() = default;
+	~ComponentList();
 
 	ComponentList(const ComponentList&) = delete;
 	ComponentList(ComponentList&&) = delete;
@@ -23,6 +58,8 @@ public:
 	void RemoveComponent(Entity anEntity);
 	ComponentType& GetComponent(Entity anEntity);
 	const ComponentType& GetComponent(Entity anEntity) const;
+	/* GetComponent() that also calls MarkChanged(), for writes observers and replication should see. */
+	ComponentType& GetMutableComponent(Entity anEntity);
 	Entity GetEntityFromComponent(uint32_t componentIndex) const;
 
 	ComponentType* GetDenseComponents();
@@ -34,10 +71,98 @@ public:
 	void Deactivate(Entity anEntity);
 	void SetActive(Entity anEntity, bool aValue = true);
 	void ActivateAll();
+	/*
+	* Activates or deactivates every entity in someEntities at once. Activation
+	* changes made by parallel jobs go into an AtomicBitArray or per-batch
+	* BitArrays and are applied here afterwards, so jobs never race on the list.
+	*/
+	void SetActiveEntities(const BitArray<MAX_ENTITIES>& someEntities, bool aValue);
 
 	void SetComponentAsDefaultForAllEntities();
 
+	/* Removes every component at once. */
+	void Clear();
+
+	/*
+	* Incremental insertion sort of the dense arrays by someKeys[entity], or by
+	* entity when someKeys is null. Moves at most aMaxSwaps components per call
+	* and carries on where it stopped next time, so the cost of restoring order
+	* after swap-removals can be spread over frames. Keys may change between
+	* calls; the sort follows them. Lists sorted with the same keys end up in
+	* the same relative order. Components keep their entity, so nothing is
+	* stamped as changed. Returns the number of swaps done.
+	*/
+	uint32_t SortStep(const uint32_t* someKeys, uint32_t aMaxSwaps);
+
+	/*
+	* Change tracking for replication. Adding, removing and MarkChanged() stamp
+	* the entity with the current change version; writes through GetComponent()
+	* or the dense array are not seen until MarkChanged() is called. Each chunk
+	* of CHANGE_CHUNK_SIZE entities also keeps its newest stamp, so unchanged
+	* chunks can be skipped without looking at every entity.
+	*/
+	static constexpr uint32_t CHANGE_CHUNK_SIZE = 64U;
+	static constexpr uint32_t CHANGE_CHUNK_COUNT = (MAX_ENTITIES + CHANGE_CHUNK_SIZE - 1U) / CHANGE_CHUNK_SIZE;
+
+	void SetChangeVersion(uint32_t aVersion);
+	void MarkChanged(Entity anEntity);
+	/* Stamps every entity, as if everything was removed and re-added. Observers see every component as added. */
+	void MarkAllChanged();
+	uint32_t GetChangeVersion(Entity anEntity) const;
+	uint32_t GetRemoveVersion(Entity anEntity) const;
+	uint32_t GetChunkVersion(uint32_t aChunk) const;
+
+	/* Returns the slot to pass to RemoveObserver(), or -1 if all MAX_COMPONENT_OBSERVERS are taken. */
+	int AddObserver(const Observer& anObserver);
+	void RemoveObserver(int aSlot);
+	/* Sends the events queued since the last dispatch. Events raised by the callbacks go out next time. */
+	void DispatchEvents();
+	/* The value an entity being reported as removed had, or nullptr if there was no memory to keep it. */
+	const ComponentType* GetRemovedComponent(Entity anEntity) const;
+
+	/*
+	* Membership listeners hear right away, from inside the call, whenever an
+	* entity gains or loses the component, so cached queries (Query.h) are never
+	* stale. They must not add or remove components of this list.
+	*/
+	using MembershipCallback = void (*)(Entity anEntity, bool aHasComponent, void* aUserData);
+
+	/* Returns the slot to pass to RemoveMembershipListener(), or -1 if all MAX_MEMBERSHIP_LISTENERS are taken. */
+	int AddMembershipListener(MembershipCallback aCallback, void* aUserData);
+	void RemoveMembershipListener(int aSlot);
+
+	/*
+	* Reads or writes the raw storage as snapshot sections under anOwner, see
+	* Snapshot.h. Only the used part of the dense arrays is stored. Loading
+	* stamps everything as changed and reports the old contents as removed and
+	* the loaded ones as added.
+	*/
+	template <class Archive>
+	bool Serialize(Archive& anArchive, uint32_t anOwner);
+
 private:
+	struct RemovedComponent
+	{
+		Entity myEntity;
+		ComponentType myComponent;
+	};
+
+	/* Grows on demand, so lists nobody watches for removals never hold copies. */
+	struct RemovedBuffer
+	{
+		RemovedComponent* myItems = nullptr;
+		uint32_t myCount = 0U;
+		uint32_t myCapacity = 0U;
+	};
+
+	void QueueAdded(Entity anEntity);
+	void QueueRemoved(Entity anEntity, const ComponentType& aComponent);
+	void QueueChanged(Entity anEntity);
+	void NotifyMembership(Entity anEntity, bool aHasComponent);
+	void SwapDense(uint32_t aFirstIndex, uint32_t aSecondIndex);
+	/* Whether the two maps and the membership bitset describe the same set of entities. */
+	bool IsConsistent() const;
+
 	ComponentType myComponents[MAX_ENTITIES];
 	uint32_t myComponentsSize;
 
@@ -46,24 +171,72 @@ private:
 
 	BitArray<MAX_ENTITIES> myEntitiesContainingComponent;
 	BitArray<MAX_ENTITIES> myActiveEntities;
+
+	/* SortStep() state: the element at mySortCursor is being sifted down from mySortPosition. */
+	uint32_t mySortCursor;
+	uint32_t mySortPosition;
+
+	uint32_t myChangeVersions[MAX_ENTITIES];
+	uint32_t myRemoveVersions[MAX_ENTITIES];
+	uint32_t myChunkVersions[CHANGE_CHUNK_COUNT];
+	uint32_t myCurrentVersion;
+
+	/* Pending events; only kept while someone is observing. */
+	Observer myObservers[MAX_COMPONENT_OBSERVERS];
+	uint32_t myObserverCount;
+	BitArray<MAX_ENTITIES> myAddedEntities;
+	BitArray<MAX_ENTITIES> myRemovedEntities;
+	BitArray<MAX_ENTITIES> myChangedEntities;
+	/* Observers with an on-remove callback; removed values are only copied while there are any. */
+	uint32_t myRemoveObserverCount;
+	/* Removed since the last dispatch, at most once per entity. */
+	RemovedBuffer myPendingRemovals;
+	/* What GetRemovedComponent() reads during a dispatch, sorted by entity, emptied after it. */
+	RemovedBuffer myDispatchedRemovals;
+
+	struct MembershipListener
+	{
+		MembershipCallback myCallback = nullptr;
+		void* myUserData = nullptr;
+	};
+	MembershipListener myMembershipListeners[MAX_MEMBERSHIP_LISTENERS];
+	uint32_t myMembershipListenerCount;
 };
 
-template<class ComponentType>
-inline ComponentList<ComponentType>::ComponentList()
+template<class ComponentType, bool IsTag>
+inline ComponentList<ComponentType, IsTag>::ComponentList()
+	: myComponentsSize(0U)
+	, mySortCursor(0U)
+	, mySortPosition(0U)
+	, myCurrentVersion(0U)
+	, myObserverCount(0U)
+	, myRemoveObserverCount(0U)
+	, myMembershipListenerCount(0U)
 {
 	myActiveEntities.SetAll();
+
+	memset(myChangeVersions, 0, sizeof(myChangeVersions));
+	memset(myRemoveVersions, 0, sizeof(myRemoveVersions));
+	memset(myChunkVersions, 0, sizeof(myChunkVersions));
 }
 
-template<class ComponentType>
-inline bool ComponentList<ComponentType>::HasComponent(Entity anEntity)
+template<class ComponentType, bool IsTag>
+inline ComponentList<ComponentType, IsTag>::~ComponentList()
+{
+	free(myPendingRemovals.myItems);
+	free(myDispatchedRemovals.myItems);
+}
+
+template<class ComponentType, bool IsTag>
+inline bool ComponentList<ComponentType, IsTag>::HasComponent(Entity anEntity)
 {
 	assert(anEntity < MAX_ENTITIES && "Entity out of range.");
 
 	return myEntitiesContainingComponent.Test(anEntity);
 }
 
-template<class ComponentType>
-inline ComponentType& ComponentList<ComponentType>::AddComponent(Entity anEntity)
+template<class ComponentType, bool IsTag>
+inline ComponentType& ComponentList<ComponentType, IsTag>::AddComponent(Entity anEntity)
 {
 	assert(anEntity < MAX_ENTITIES && "Entity out of range.");
 	assert(!myEntitiesContainingComponent.Test(anEntity) && "Entity already has component.");
@@ -75,12 +248,15 @@ inline ComponentType& ComponentList<ComponentType>::AddComponent(Entity anEntity
 	myComponents[componentIndex] = ComponentType();
 	myMapEntityToComponent[anEntity] = componentIndex;
 	myMapComponentToEntity[componentIndex] = anEntity;
+	MarkChanged(anEntity);
+	QueueAdded(anEntity);
+	NotifyMembership(anEntity, true);
 
 	return myComponents[componentIndex];
 }
 
-template<class ComponentType>
-inline void ComponentList<ComponentType>::RemoveComponent(Entity anEntity)
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::RemoveComponent(Entity anEntity)
 {
 	assert(anEntity < MAX_ENTITIES && "Entity out of range.");
 
@@ -89,13 +265,18 @@ inline void ComponentList<ComponentType>::RemoveComponent(Entity anEntity)
 
 	--myComponentsSize;
 	const uint32_t componentIndex = myMapEntityToComponent[anEntity];
+	QueueRemoved(anEntity, myComponents[componentIndex]);
 	myComponents[componentIndex] = myComponents[myComponentsSize];
 	myMapEntityToComponent[myMapComponentToEntity[myComponentsSize]] = componentIndex;
 	myMapComponentToEntity[componentIndex] = myMapComponentToEntity[myComponentsSize];
+
+	myRemoveVersions[anEntity] = myCurrentVersion;
+	myChunkVersions[anEntity / CHANGE_CHUNK_SIZE] = myCurrentVersion;
+	NotifyMembership(anEntity, false);
 }
 
-template<class ComponentType>
-inline ComponentType& ComponentList<ComponentType>::GetComponent(Entity anEntity)
+template<class ComponentType, bool IsTag>
+inline ComponentType& ComponentList<ComponentType, IsTag>::GetComponent(Entity anEntity)
 {
 	assert(HasComponent(anEntity) && "This entity does not yet have a component of this type.");
 	assert(anEntity < MAX_ENTITIES && "Entity out of range.");
@@ -103,8 +284,8 @@ inline ComponentType& ComponentList<ComponentType>::GetComponent(Entity anEntity
 	return myComponents[myMapEntityToComponent[anEntity]];
 }
 
-template<class ComponentType>
-inline const ComponentType& ComponentList<ComponentType>::GetComponent(Entity anEntity) const
+template<class ComponentType, bool IsTag>
+inline const ComponentType& ComponentList<ComponentType, IsTag>::GetComponent(Entity anEntity) const
 {
 	assert(HasComponent(anEntity) && "This entity does not yet have a component of this type.");
 	assert(anEntity < MAX_ENTITIES && "Entity out of range.");
@@ -112,52 +293,60 @@ inline const ComponentType& ComponentList<ComponentType>::GetComponent(Entity an
 	return myComponents[myMapEntityToComponent[anEntity]];
 }
 
-template<class ComponentType>
-inline Entity ComponentList<ComponentType>::GetEntityFromComponent(uint32_t componentIndex) const
+template<class ComponentType, bool IsTag>
+inline ComponentType& ComponentList<ComponentType, IsTag>::GetMutableComponent(Entity anEntity)
+{
+	MarkChanged(anEntity);
+
+	return GetComponent(anEntity);
+}
+
+template<class ComponentType, bool IsTag>
+inline Entity ComponentList<ComponentType, IsTag>::GetEntityFromComponent(uint32_t componentIndex) const
 {
 	assert(componentIndex < myComponentsSize && "Index out of bounds.");
 
 	return myMapComponentToEntity[componentIndex];
 }
 
-template<class ComponentType>
-inline ComponentType* ComponentList<ComponentType>::GetDenseComponents()
+template<class ComponentType, bool IsTag>
+inline ComponentType* ComponentList<ComponentType, IsTag>::GetDenseComponents()
 {
 	return myComponents;
 }
 
-template<class ComponentType>
-inline uint32_t ComponentList<ComponentType>::GetSize()
+template<class ComponentType, bool IsTag>
+inline uint32_t ComponentList<ComponentType, IsTag>::GetSize()
 {
 	return myComponentsSize;
 }
 
-template<class ComponentType>
-inline BitArray<MAX_ENTITIES>& ComponentList<ComponentType>::GetEntitiesContainingComponent()
+template<class ComponentType, bool IsTag>
+inline BitArray<MAX_ENTITIES>& ComponentList<ComponentType, IsTag>::GetEntitiesContainingComponent()
 {
 	return myEntitiesContainingComponent;
 }
 
-template<class ComponentType>
-inline bool ComponentList<ComponentType>::IsActive(Entity anEntity)
+template<class ComponentType, bool IsTag>
+inline bool ComponentList<ComponentType, IsTag>::IsActive(Entity anEntity)
 {
 	return myEntitiesContainingComponent[anEntity] && myActiveEntities[anEntity];
 }
 
-template<class ComponentType>
-inline void ComponentList<ComponentType>::Activate(Entity anEntity)
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::Activate(Entity anEntity)
 {
 	myActiveEntities.Set(anEntity);
 }
 
-template<class ComponentType>
-inline void ComponentList<ComponentType>::Deactivate(Entity anEntity)
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::Deactivate(Entity anEntity)
 {
 	myActiveEntities.Reset(anEntity);
 }
 
-template<class ComponentType>
-inline void ComponentList<ComponentType>::SetActive(Entity anEntity, bool aValue)
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::SetActive(Entity anEntity, bool aValue)
 {
 	if (aValue)
 	{
@@ -169,16 +358,683 @@ inline void ComponentList<ComponentType>::SetActive(Entity anEntity, bool aValue
 	}
 }
 
-template<class ComponentType>
-inline void ComponentList<ComponentType>::ActivateAll()
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::ActivateAll()
 {
 	myActiveEntities.SetAll();
 }
 
-template<class ComponentType>
-inline void ComponentList<ComponentType>::SetComponentAsDefaultForAllEntities()
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::SetActiveEntities(const BitArray<MAX_ENTITIES>& someEntities, bool aValue)
+{
+	if (aValue)
+	{
+		myActiveEntities |= someEntities;
+	}
+	else
+	{
+		BitArray<MAX_ENTITIES> kept = someEntities;
+		kept.FlipAll();
+		myActiveEntities &= kept;
+	}
+}
+
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::SetComponentAsDefaultForAllEntities()
 {
 	myEntitiesContainingComponent.SetAll();
 }
 
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::Clear()
+{
+	for (uint32_t componentIndex = 0U; myObserverCount > 0U && componentIndex < myComponentsSize; ++componentIndex)
+	{
+		QueueRemoved(myMapComponentToEntity[componentIndex], myComponents[componentIndex]);
+	}
+
+	myEntitiesContainingComponent.ResetAll();
+	for (uint32_t componentIndex = 0U; myMembershipListenerCount > 0U && componentIndex < myComponentsSize; ++componentIndex)
+	{
+		NotifyMembership(myMapComponentToEntity[componentIndex], false);
+	}
+
+	myComponentsSize = 0U;
+	mySortCursor = 0U;
+	mySortPosition = 0U;
+	myActiveEntities.SetAll();
+	MarkAllChanged();
+}
+
+template<class ComponentType, bool IsTag>
+inline uint32_t ComponentList<ComponentType, IsTag>::SortStep(const uint32_t* someKeys, uint32_t aMaxSwaps)
+{
+	auto key = [&](uint32_t aComponentIndex)
+	{
+		const Entity entity = myMapComponentToEntity[aComponentIndex];
+		return someKeys ? someKeys[entity] : entity;
+	};
+
+	/* Removals may have shrunk the list under the cursor; restarting the pass is always safe. */
+	if (mySortCursor >= myComponentsSize || mySortPosition > mySortCursor)
+	{
+		mySortCursor = 0U;
+		mySortPosition = 0U;
+	}
+
+	uint32_t swaps = 0U;
+	while (swaps < aMaxSwaps)
+	{
+		if (mySortPosition > 0U && key(mySortPosition - 1U) > key(mySortPosition))
+		{
+			SwapDense(mySortPosition - 1U, mySortPosition);
+			--mySortPosition;
+			++swaps;
+			continue;
+		}
+
+		/* In place; move on to the next element, or wrap around for another pass. */
+		if (++mySortCursor >= myComponentsSize)
+		{
+			mySortCursor = 0U;
+			mySortPosition = 0U;
+			break;
+		}
+		mySortPosition = mySortCursor;
+	}
+
+	return swaps;
+}
+
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::SwapDense(uint32_t aFirstIndex, uint32_t aSecondIndex)
+{
+	const Entity firstEntity = myMapComponentToEntity[aFirstIndex];
+	const Entity secondEntity = myMapComponentToEntity[aSecondIndex];
+
+	const ComponentType swap = myComponents[aFirstIndex];
+	myComponents[aFirstIndex] = myComponents[aSecondIndex];
+	myComponents[aSecondIndex] = swap;
+
+	myMapComponentToEntity[aFirstIndex] = secondEntity;
+	myMapComponentToEntity[aSecondIndex] = firstEntity;
+	myMapEntityToComponent[firstEntity] = aSecondIndex;
+	myMapEntityToComponent[secondEntity] = aFirstIndex;
+}
+
+template<class ComponentType, bool IsTag>
+inline bool ComponentList<ComponentType, IsTag>::IsConsistent() const
+{
+	if (myComponentsSize > MAX_ENTITIES || myEntitiesContainingComponent.Count() != myComponentsSize)
+	{
+		return false;
+	}
+
+	/* Each index maps to a distinct member that maps back to it, and there are exactly as many members as indices. */
+	for (uint32_t componentIndex = 0U; componentIndex < myComponentsSize; ++componentIndex)
+	{
+		const Entity entity = myMapComponentToEntity[componentIndex];
+		if (entity >= MAX_ENTITIES || !myEntitiesContainingComponent.Test(entity) || myMapEntityToComponent[entity] != componentIndex)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::SetChangeVersion(uint32_t aVersion)
+{
+	myCurrentVersion = aVersion;
+}
+
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::MarkChanged(Entity anEntity)
+{
+	assert(anEntity < MAX_ENTITIES && "Entity out of range.");
+
+	myChangeVersions[anEntity] = myCurrentVersion;
+	myChunkVersions[anEntity / CHANGE_CHUNK_SIZE] = myCurrentVersion;
+	QueueChanged(anEntity);
+}
+
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::MarkAllChanged()
+{
+	for (Entity e = 0U; e < MAX_ENTITIES; ++e)
+	{
+		myChangeVersions[e] = myCurrentVersion;
+		myRemoveVersions[e] = myCurrentVersion;
+	}
+	for (uint32_t chunk = 0U; chunk < CHANGE_CHUNK_COUNT; ++chunk)
+	{
+		myChunkVersions[chunk] = myCurrentVersion;
+	}
+	for (uint32_t componentIndex = 0U; myObserverCount > 0U && componentIndex < myComponentsSize; ++componentIndex)
+	{
+		QueueAdded(myMapComponentToEntity[componentIndex]);
+	}
+}
+
+template<class ComponentType, bool IsTag>
+inline uint32_t ComponentList<ComponentType, IsTag>::GetChangeVersion(Entity anEntity) const
+{
+	assert(anEntity < MAX_ENTITIES && "Entity out of range.");
+
+	return myChangeVersions[anEntity];
+}
+
+template<class ComponentType, bool IsTag>
+inline uint32_t ComponentList<ComponentType, IsTag>::GetRemoveVersion(Entity anEntity) const
+{
+	assert(anEntity < MAX_ENTITIES && "Entity out of range.");
+
+	return myRemoveVersions[anEntity];
+}
+
+template<class ComponentType, bool IsTag>
+inline uint32_t ComponentList<ComponentType, IsTag>::GetChunkVersion(uint32_t aChunk) const
+{
+	assert(aChunk < CHANGE_CHUNK_COUNT && "Chunk out of range.");
+
+	return myChunkVersions[aChunk];
+}
+
+template<class ComponentType, bool IsTag>
+inline int ComponentList<ComponentType, IsTag>::AddObserver(const Observer& anObserver)
+{
+	assert((anObserver.myOnAdd || anObserver.myOnRemove || anObserver.myOnChange) && "Observer has no callbacks.");
+
+	for (uint32_t slot = 0U; slot < MAX_COMPONENT_OBSERVERS; ++slot)
+	{
+		const Observer& existing = myObservers[slot];
+		if (!existing.myOnAdd && !existing.myOnRemove && !existing.myOnChange)
+		{
+			myObservers[slot] = anObserver;
+			++myObserverCount;
+			myRemoveObserverCount += anObserver.myOnRemove ? 1U : 0U;
+			return (int)slot;
+		}
+	}
+
+	return -1;
+}
+
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::RemoveObserver(int aSlot)
+{
+	assert(aSlot >= 0 && aSlot < (int)MAX_COMPONENT_OBSERVERS && "Observer slot out of range.");
+
+	myRemoveObserverCount -= myObservers[aSlot].myOnRemove ? 1U : 0U;
+	myObservers[aSlot] = Observer();
+	--myObserverCount;
+
+	if (myRemoveObserverCount == 0U)
+	{
+		myPendingRemovals.myCount = 0U;
+	}
+	if (myObserverCount == 0U)
+	{
+		myAddedEntities.ResetAll();
+		myRemovedEntities.ResetAll();
+		myChangedEntities.ResetAll();
+	}
+}
+
+template<class ComponentType, bool IsTag>
+inline int ComponentList<ComponentType, IsTag>::AddMembershipListener(MembershipCallback aCallback, void* aUserData)
+{
+	assert(aCallback && "Membership listener has no callback.");
+
+	for (uint32_t slot = 0U; slot < MAX_MEMBERSHIP_LISTENERS; ++slot)
+	{
+		if (!myMembershipListeners[slot].myCallback)
+		{
+			myMembershipListeners[slot] = { aCallback, aUserData };
+			++myMembershipListenerCount;
+			return (int)slot;
+		}
+	}
+
+	return -1;
+}
+
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::RemoveMembershipListener(int aSlot)
+{
+	assert(aSlot >= 0 && aSlot < (int)MAX_MEMBERSHIP_LISTENERS && "Membership listener slot out of range.");
+
+	myMembershipListeners[aSlot] = MembershipListener();
+	--myMembershipListenerCount;
+}
+
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::DispatchEvents()
+{
+	if (myObserverCount == 0U || (myAddedEntities.None() && myRemovedEntities.None() && myChangedEntities.None()))
+	{
+		return;
+	}
+
+	/* Taken out of the queues first, so callbacks can add, remove and change components freely. */
+	Entity added[MAX_ENTITIES];
+	Entity removed[MAX_ENTITIES];
+	Entity changed[MAX_ENTITIES];
+	uint32_t addedCount = 0U;
+	uint32_t removedCount = 0U;
+	uint32_t changedCount = 0U;
+
+	for (Entity e = 0U; e < MAX_ENTITIES; ++e)
+	{
+		if (myAddedEntities.Test(e))
+		{
+			added[addedCount++] = e;
+		}
+		if (myRemovedEntities.Test(e))
+		{
+			removed[removedCount++] = e;
+		}
+		if (myChangedEntities.Test(e))
+		{
+			changed[changedCount++] = e;
+		}
+	}
+	myAddedEntities.ResetAll();
+	myRemovedEntities.ResetAll();
+	myChangedEntities.ResetAll();
+
+	/* Removals raised by the callbacks queue up in the emptied buffer for the next dispatch. */
+	std::swap(myPendingRemovals, myDispatchedRemovals);
+	myPendingRemovals.myCount = 0U;
+	std::sort(myDispatchedRemovals.myItems, myDispatchedRemovals.myItems + myDispatchedRemovals.myCount,
+		[](const RemovedComponent& aFirst, const RemovedComponent& aSecond) { return aFirst.myEntity < aSecond.myEntity; });
+
+	/* Removals first: an entity that was removed and re-added sees its old component go before the new one arrives. */
+	for (uint32_t slot = 0U; slot < MAX_COMPONENT_OBSERVERS; ++slot)
+	{
+		const Observer observer = myObservers[slot];
+		if (observer.myOnRemove && removedCount > 0U)
+		{
+			observer.myOnRemove(*this, removed, removedCount, observer.myUserData);
+		}
+	}
+	for (uint32_t slot = 0U; slot < MAX_COMPONENT_OBSERVERS; ++slot)
+	{
+		const Observer observer = myObservers[slot];
+		if (observer.myOnAdd && addedCount > 0U)
+		{
+			observer.myOnAdd(*this, added, addedCount, observer.myUserData);
+		}
+	}
+	for (uint32_t slot = 0U; slot < MAX_COMPONENT_OBSERVERS; ++slot)
+	{
+		const Observer observer = myObservers[slot];
+		if (observer.myOnChange && changedCount > 0U)
+		{
+			observer.myOnChange(*this, changed, changedCount, observer.myUserData);
+		}
+	}
+
+	myDispatchedRemovals.myCount = 0U;
+}
+
+template<class ComponentType, bool IsTag>
+inline const ComponentType* ComponentList<ComponentType, IsTag>::GetRemovedComponent(Entity anEntity) const
+{
+	assert(anEntity < MAX_ENTITIES && "Entity out of range.");
+
+	const RemovedComponent* const begin = myDispatchedRemovals.myItems;
+	const RemovedComponent* const end = begin + myDispatchedRemovals.myCount;
+	const RemovedComponent* const removed = std::lower_bound(begin, end, anEntity,
+		[](const RemovedComponent& aRemoved, Entity aValue) { return aRemoved.myEntity < aValue; });
+
+	return removed != end && removed->myEntity == anEntity ? &removed->myComponent : nullptr;
+}
+
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::QueueAdded(Entity anEntity)
+{
+	if (myObserverCount == 0U)
+	{
+		return;
+	}
+
+	myAddedEntities.Set(anEntity);
+	myChangedEntities.Reset(anEntity);
+}
+
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::QueueRemoved(Entity anEntity, const ComponentType& aComponent)
+{
+	if (myObserverCount == 0U)
+	{
+		return;
+	}
+
+	myChangedEntities.Reset(anEntity);
+
+	/* Added since the last dispatch: nobody has seen it, so nobody has to hear it go. */
+	if (myAddedEntities.Test(anEntity))
+	{
+		myAddedEntities.Reset(anEntity);
+		return;
+	}
+
+	myRemovedEntities.Set(anEntity);
+	if (myRemoveObserverCount == 0U)
+	{
+		return;
+	}
+
+	RemovedBuffer& pending = myPendingRemovals;
+	if (pending.myCount == pending.myCapacity)
+	{
+		const uint32_t newCapacity = pending.myCapacity ? pending.myCapacity * 2U : 16U;
+		RemovedComponent* const items = (RemovedComponent*)realloc(pending.myItems, sizeof(RemovedComponent) * newCapacity);
+
+		/* The removal is still reported, only without its value; the values already queued stay where they are. */
+		if (!items)
+		{
+			return;
+		}
+
+		pending.myItems = items;
+		pending.myCapacity = newCapacity;
+	}
+	pending.myItems[pending.myCount++] = { anEntity, aComponent };
+}
+
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::QueueChanged(Entity anEntity)
+{
+	if (myObserverCount == 0U || myAddedEntities.Test(anEntity))
+	{
+		return;
+	}
+
+	myChangedEntities.Set(anEntity);
+}
+
+template<class ComponentType, bool IsTag>
+inline void ComponentList<ComponentType, IsTag>::NotifyMembership(Entity anEntity, bool aHasComponent)
+{
+	for (uint32_t slot = 0U; myMembershipListenerCount > 0U && slot < MAX_MEMBERSHIP_LISTENERS; ++slot)
+	{
+		const MembershipListener& listener = myMembershipListeners[slot];
+		if (listener.myCallback)
+		{
+			listener.myCallback(anEntity, aHasComponent, listener.myUserData);
+		}
+	}
+}
+
+template<class ComponentType, bool IsTag>
+template<class Archive>
+inline bool ComponentList<ComponentType, IsTag>::Serialize(Archive& anArchive, uint32_t anOwner)
+{
+	static_assert(std::is_trivially_copyable<ComponentType>::value, "Snapshots store components as raw bytes.");
+
+	if (Archive::IS_LOADING)
+	{
+		Clear();
+	}
+
+	bool succeeded = anArchive.Section(anOwner, 0U, &myComponentsSize, sizeof(myComponentsSize));
+	succeeded = succeeded && myComponentsSize <= MAX_ENTITIES;
+	succeeded = succeeded && anArchive.Section(anOwner, 1U, myComponents, sizeof(ComponentType) * myComponentsSize);
+	succeeded = succeeded && anArchive.Section(anOwner, 2U, myMapEntityToComponent, sizeof(myMapEntityToComponent));
+	succeeded = succeeded && anArchive.Section(anOwner, 3U, myMapComponentToEntity, sizeof(uint32_t) * myComponentsSize);
+	succeeded = succeeded && anArchive.Section(anOwner, 4U, &myEntitiesContainingComponent, sizeof(myEntitiesContainingComponent));
+	succeeded = succeeded && anArchive.Section(anOwner, 5U, &myActiveEntities, sizeof(myActiveEntities));
+
+	if (Archive::IS_LOADING)
+	{
+		/* Section hashes only catch accidents; a crafted file could still point the maps anywhere. */
+		succeeded = succeeded && IsConsistent();
+
+		if (succeeded)
+		{
+			MarkAllChanged();
+			for (uint32_t componentIndex = 0U; componentIndex < myComponentsSize; ++componentIndex)
+			{
+				NotifyMembership(myMapComponentToEntity[componentIndex], true);
+			}
+		}
+		else
+		{
+			/* Nothing was announced yet, so the partial load is dropped without events. */
+			myComponentsSize = 0U;
+			myEntitiesContainingComponent.ResetAll();
+			myActiveEntities.SetAll();
+		}
+	}
+
+	return succeeded;
+}
+
+/*
+* Tags can be added, removed, tested, iterated, listened to and queried like
+* other components, but have no observers or change tracking: there is no
+* data to report changes in, and replication only covers dense components.
+* Nor do they have activation, so membership is the only state a tag keeps.
+*/
+template <class ComponentType>
+class ComponentList<ComponentType, true>
+{
+public:
+	using MembershipCallback = void (*)(Entity anEntity, bool aHasComponent, void* aUserData);
+
+	ComponentList();
+	~ComponentList() = default;
+
+	ComponentList(const ComponentList&) = delete;
+	ComponentList(ComponentList&&) = delete;
+	ComponentList& operator=(const ComponentList&) = delete;
+	ComponentList& operator=(ComponentList&&) = delete;
+
+	bool HasComponent(Entity anEntity) const;
+	ComponentType& AddComponent(Entity anEntity);
+	void RemoveComponent(Entity anEntity);
+	/* Every tag is the same empty object. */
+	ComponentType& GetComponent(Entity anEntity);
+	const ComponentType& GetComponent(Entity anEntity) const;
+
+	uint32_t GetSize() const;
+	BitArray<MAX_ENTITIES>& GetEntitiesContainingComponent();
+	/* Calls aFunction(entity) for every tagged entity in ascending order, skipping untagged stretches a word at a time. */
+	template <class Function>
+	void ForEachEntity(Function&& aFunction) const;
+
+	void Clear();
+
+	/* Same contract as for dense lists. */
+	int AddMembershipListener(MembershipCallback aCallback, void* aUserData);
+	void RemoveMembershipListener(int aSlot);
+
+	/* Stores the membership bitset as a snapshot section under anOwner, see Snapshot.h. */
+	template <class Archive>
+	bool Serialize(Archive& anArchive, uint32_t anOwner);
+
+private:
+	void NotifyMembership(Entity anEntity, bool aHasComponent);
+
+	static inline ComponentType ourTag;
+
+	BitArray<MAX_ENTITIES> myEntitiesContainingComponent;
+	/* Kept alongside the bitset so GetSize() stays constant time, as it is for dense lists. */
+	uint32_t mySize;
+
+	struct MembershipListener
+	{
+		MembershipCallback myCallback = nullptr;
+		void* myUserData = nullptr;
+	};
+	MembershipListener myMembershipListeners[MAX_MEMBERSHIP_LISTENERS];
+	uint32_t myMembershipListenerCount;
+};
+
+template<class ComponentType>
+inline ComponentList<ComponentType, true>::ComponentList()
+	: mySize(0U)
+	, myMembershipListenerCount(0U)
+{
+}
+
+template<class ComponentType>
+inline bool ComponentList<ComponentType, true>::HasComponent(Entity anEntity) const
+{
+	assert(anEntity < MAX_ENTITIES && "Entity out of range.");
+
+	return myEntitiesContainingComponent.Test(anEntity);
+}
+
+template<class ComponentType>
+inline ComponentType& ComponentList<ComponentType, true>::AddComponent(Entity anEntity)
+{
+	assert(anEntity < MAX_ENTITIES && "Entity out of range.");
+	assert(!myEntitiesContainingComponent.Test(anEntity) && "Entity already has component.");
+
+	myEntitiesContainingComponent.Set(anEntity);
+	++mySize;
+	NotifyMembership(anEntity, true);
+
+	return ourTag;
+}
+
+template<class ComponentType>
+inline void ComponentList<ComponentType, true>::RemoveComponent(Entity anEntity)
+{
+	assert(anEntity < MAX_ENTITIES && "Entity out of range.");
+	assert(myEntitiesContainingComponent.Test(anEntity) && "Entity does not have component.");
+
+	myEntitiesContainingComponent.Reset(anEntity);
+	--mySize;
+	NotifyMembership(anEntity, false);
+}
+
+template<class ComponentType>
+inline ComponentType& ComponentList<ComponentType, true>::GetComponent(Entity anEntity)
+{
+	assert(HasComponent(anEntity) && "This entity does not yet have a component of this type.");
+	(void)anEntity;
+
+	return ourTag;
+}
+
+template<class ComponentType>
+inline const ComponentType& ComponentList<ComponentType, true>::GetComponent(Entity anEntity) const
+{
+	assert(HasComponent(anEntity) && "This entity does not yet have a component of this type.");
+	(void)anEntity;
+
+	return ourTag;
+}
+
+template<class ComponentType>
+inline uint32_t ComponentList<ComponentType, true>::GetSize() const
+{
+	return mySize;
+}
+
+template<class ComponentType>
+inline BitArray<MAX_ENTITIES>& ComponentList<ComponentType, true>::GetEntitiesContainingComponent()
+{
+	return myEntitiesContainingComponent;
+}
+
+template<class ComponentType>
+template<class Function>
+inline void ComponentList<ComponentType, true>::ForEachEntity(Function&& aFunction) const
+{
+	for (size_t e = myEntitiesContainingComponent.FindNext(0U); e < MAX_ENTITIES; e = myEntitiesContainingComponent.FindNext(e + 1U))
+	{
+		aFunction((Entity)e);
+	}
+}
+
+template<class ComponentType>
+inline void ComponentList<ComponentType, true>::Clear()
+{
+	const BitArray<MAX_ENTITIES> cleared = myEntitiesContainingComponent;
+
+	myEntitiesContainingComponent.ResetAll();
+	mySize = 0U;
+
+	for (size_t e = cleared.FindNext(0U); myMembershipListenerCount > 0U && e < MAX_ENTITIES; e = cleared.FindNext(e + 1U))
+	{
+		NotifyMembership((Entity)e, false);
+	}
+}
+
+template<class ComponentType>
+inline int ComponentList<ComponentType, true>::AddMembershipListener(MembershipCallback aCallback, void* aUserData)
+{
+	assert(aCallback && "Membership listener has no callback.");
+
+	for (uint32_t slot = 0U; slot < MAX_MEMBERSHIP_LISTENERS; ++slot)
+	{
+		if (!myMembershipListeners[slot].myCallback)
+		{
+			myMembershipListeners[slot] = { aCallback, aUserData };
+			++myMembershipListenerCount;
+			return (int)slot;
+		}
+	}
+
+	return -1;
+}
+
+template<class ComponentType>
+inline void ComponentList<ComponentType, true>::RemoveMembershipListener(int aSlot)
+{
+	assert(aSlot >= 0 && aSlot < (int)MAX_MEMBERSHIP_LISTENERS && "Membership listener slot out of range.");
+
+	myMembershipListeners[aSlot] = MembershipListener();
+	--myMembershipListenerCount;
+}
+
+template<class ComponentType>
+inline void ComponentList<ComponentType, true>::NotifyMembership(Entity anEntity, bool aHasComponent)
+{
+	for (uint32_t slot = 0U; myMembershipListenerCount > 0U && slot < MAX_MEMBERSHIP_LISTENERS; ++slot)
+	{
+		const MembershipListener& listener = myMembershipListeners[slot];
+		if (listener.myCallback)
+		{
+			listener.myCallback(anEntity, aHasComponent, listener.myUserData);
+		}
+	}
+}
+
+template<class ComponentType>
+template<class Archive>
+inline bool ComponentList<ComponentType, true>::Serialize(Archive& anArchive, uint32_t anOwner)
+{
+	if (Archive::IS_LOADING)
+	{
+		Clear();
+	}
+
+	const bool succeeded = anArchive.Section(anOwner, 0U, &myEntitiesContainingComponent, sizeof(myEntitiesContainingComponent));
+
+	if (Archive::IS_LOADING)
+	{
+		/* Any bit pattern is a valid set, and nothing reads it past MAX_ENTITIES, so there is nothing else to check. */
+		if (!succeeded)
+		{
+			myEntitiesContainingComponent.ResetAll();
+		}
+
+		mySize = 0U;
+		ForEachEntity([this](Entity anEntity)
+		{
+			++mySize;
+			NotifyMembership(anEntity, true);
+		});
+	}
+
+	return succeeded;
+}
+
 #endif // COMPONENTLIST_H_
\ No newline at end of file
@@ -19,6 +19,7 @@ struct MovementComponent
     Vector3 myVelocity = { .0f, .0f, .0f };
 };
 
+/* Change myModel through GetMutableComponent() so the model's reference count follows. */
 struct ModelComponent
 {
     ModelID myModel;
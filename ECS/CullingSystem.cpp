@@ -0,0 +1,167 @@
+#include "CullingSystem.h"
+
+#include "../Utils/Profiler.h"
+
+extern "C"
+{
+#include "../raylib/raymath.h"
+}
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CULLING_USE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Systems
+{
+    constexpr uint32_t CULL_LANES = 8U;
+    /* Must be a multiple of CULL_LANES. */
+    constexpr uint32_t CULL_BATCH_SIZE = 256U;
+
+    static Vector4 MakePlane(Vector3 aNormal, Vector3 aPoint)
+    {
+        const Vector3 n = Vector3Normalize(aNormal);
+
+        return { n.x, n.y, n.z, -Vector3DotProduct(n, aPoint) };
+    }
+
+    /* Writes 1 to someFlagsOut for every sphere touching the frustum, CULL_LANES spheres per call. */
+    static void TestSpheres(const Frustum& aFrustum, const float* someX, const float* someY, const float* someZ, const float* someRadii, uint8_t* someFlagsOut)
+    {
+#if defined(CULLING_USE_SSE)
+        __m128 outsideLow = _mm_setzero_ps();
+        __m128 outsideHigh = _mm_setzero_ps();
+
+        const __m128 xLow = _mm_loadu_ps(someX), xHigh = _mm_loadu_ps(someX + 4);
+        const __m128 yLow = _mm_loadu_ps(someY), yHigh = _mm_loadu_ps(someY + 4);
+        const __m128 zLow = _mm_loadu_ps(someZ), zHigh = _mm_loadu_ps(someZ + 4);
+        const __m128 negRadiusLow = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(someRadii));
+        const __m128 negRadiusHigh = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(someRadii + 4));
+
+        for (int plane = 0; plane < 6; ++plane)
+        {
+            const Vector4& p = aFrustum.myPlanes[plane];
+            const __m128 nx = _mm_set1_ps(p.x), ny = _mm_set1_ps(p.y), nz = _mm_set1_ps(p.z), w = _mm_set1_ps(p.w);
+
+            const __m128 distanceLow = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, xLow), _mm_mul_ps(ny, yLow)), _mm_add_ps(_mm_mul_ps(nz, zLow), w));
+            const __m128 distanceHigh = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, xHigh), _mm_mul_ps(ny, yHigh)), _mm_add_ps(_mm_mul_ps(nz, zHigh), w));
+
+            outsideLow = _mm_or_ps(outsideLow, _mm_cmplt_ps(distanceLow, negRadiusLow));
+            outsideHigh = _mm_or_ps(outsideHigh, _mm_cmplt_ps(distanceHigh, negRadiusHigh));
+        }
+
+        const int outsideMask = _mm_movemask_ps(outsideLow) | (_mm_movemask_ps(outsideHigh) << 4);
+        for (uint32_t lane = 0U; lane < CULL_LANES; ++lane)
+        {
+            someFlagsOut[lane] = (uint8_t)(((outsideMask >> lane) & 1) ^ 1);
+        }
+#else
+        for (uint32_t lane = 0U; lane < CULL_LANES; ++lane)
+        {
+            bool inside = true;
+            for (int plane = 0; plane < 6; ++plane)
+            {
+                const Vector4& p = aFrustum.myPlanes[plane];
+                inside &= p.x * someX[lane] + p.y * someY[lane] + p.z * someZ[lane] + p.w >= -someRadii[lane];
+            }
+            someFlagsOut[lane] = (uint8_t)inside;
+        }
+#endif
+    }
+}
+
+Frustum Systems::MakeFrustum(const Camera3D& aCamera, float anAspect, float aNear, float aFar)
+{
+    const Vector3 position = aCamera.position;
+    const Vector3 forward = Vector3Normalize(Vector3Subtract(aCamera.target, position));
+    const Vector3 right = Vector3Normalize(Vector3CrossProduct(forward, aCamera.up));
+    const Vector3 up = Vector3CrossProduct(right, forward);
+
+    Frustum frustum;
+    frustum.myPlanes[0] = MakePlane(forward, Vector3Add(position, Vector3Scale(forward, aNear)));
+    frustum.myPlanes[1] = MakePlane(Vector3Scale(forward, -1.f), Vector3Add(position, Vector3Scale(forward, aFar)));
+
+    if (aCamera.projection == CAMERA_ORTHOGRAPHIC)
+    {
+        const float halfHeight = aCamera.fovy * 0.5f;
+        const float halfWidth = halfHeight * anAspect;
+
+        frustum.myPlanes[2] = MakePlane(right, Vector3Subtract(position, Vector3Scale(right, halfWidth)));
+        frustum.myPlanes[3] = MakePlane(Vector3Scale(right, -1.f), Vector3Add(position, Vector3Scale(right, halfWidth)));
+        frustum.myPlanes[4] = MakePlane(up, Vector3Subtract(position, Vector3Scale(up, halfHeight)));
+        frustum.myPlanes[5] = MakePlane(Vector3Scale(up, -1.f), Vector3Add(position, Vector3Scale(up, halfHeight)));
+    }
+    else
+    {
+        /* Side planes pass through the eye; each normal is perpendicular to its frustum edge. */
+        const float halfHeight = tanf(aCamera.fovy * 0.5f * DEG2RAD);
+        const float halfWidth = halfHeight * anAspect;
+
+        frustum.myPlanes[2] = MakePlane(Vector3Add(right, Vector3Scale(forward, halfWidth)), position);
+        frustum.myPlanes[3] = MakePlane(Vector3Add(Vector3Scale(right, -1.f), Vector3Scale(forward, halfWidth)), position);
+        frustum.myPlanes[4] = MakePlane(Vector3Add(up, Vector3Scale(forward, halfHeight)), position);
+        frustum.myPlanes[5] = MakePlane(Vector3Add(Vector3Scale(up, -1.f), Vector3Scale(forward, halfHeight)), position);
+    }
+
+    return frustum;
+}
+
+void Systems::Cull(
+    ComponentList<TransformComponent>* someTransformComps,
+    ComponentList<ModelComponent>* someModelComps,
+    const DrawableQuery& aDrawables,
+    const Frustum& aFrustum,
+    VisibleSet* aVisibleSet,
+    JobSystem* aJobSystem)
+{
+    PROFILE_ZONE("Systems::Cull");
+
+    const Entity* entities = aDrawables.GetEntities();
+    const uint32_t count = aDrawables.GetSize();
+
+    aJobSystem->ParallelFor(count, CULL_BATCH_SIZE, [&](uint32_t aBegin, uint32_t anEnd)
+    {
+        /* Gather world-space spheres into SoA lanes; padding lanes get a radius that is never inside. */
+        float x[CULL_LANES], y[CULL_LANES], z[CULL_LANES], radii[CULL_LANES];
+        uint8_t flags[CULL_LANES];
+
+        for (uint32_t first = aBegin; first < anEnd; first += CULL_LANES)
+        {
+            for (uint32_t lane = 0U; lane < CULL_LANES; ++lane)
+            {
+                const uint32_t queryIndex = first + lane;
+                if (queryIndex >= anEnd)
+                {
+                    x[lane] = y[lane] = z[lane] = 0.f;
+                    radii[lane] = -INFINITY;
+                    continue;
+                }
+
+                const ModelComponent& model = someModelComps->GetComponent(entities[queryIndex]);
+                const Vector3& position = someTransformComps->GetComponent(entities[queryIndex]).myPosition;
+                const BoundingSphere bounds = ModelManager::GetBoundingSphere(model.myModel);
+
+                x[lane] = position.x + bounds.myCenter.x * model.myScale;
+                y[lane] = position.y + bounds.myCenter.y * model.myScale;
+                z[lane] = position.z + bounds.myCenter.z * model.myScale;
+                radii[lane] = bounds.myRadius * model.myScale;
+            }
+
+            TestSpheres(aFrustum, x, y, z, radii, flags);
+
+            const uint32_t laneCount = anEnd - first < CULL_LANES ? anEnd - first : CULL_LANES;
+            memcpy(aVisibleSet->myFlags + first, flags, laneCount);
+        }
+    });
+
+    uint32_t visibleCount = 0U;
+    for (uint32_t queryIndex = 0U; queryIndex < count; ++queryIndex)
+    {
+        aVisibleSet->myEntities[visibleCount] = entities[queryIndex];
+        visibleCount += aVisibleSet->myFlags[queryIndex];
+    }
+    aVisibleSet->myCount = visibleCount;
+}
\ No newline at end of file
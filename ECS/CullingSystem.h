@@ -0,0 +1,50 @@
+#if !defined(CULLINGSYSTEM_H_)
+#define CULLINGSYSTEM_H_
+
+#pragma once
+
+#include "ComponentList.h"
+#include "Components.h"
+#include "Query.h"
+
+#include "../Utils/JobSystem.h"
+
+/* Six inward-facing planes: a point p is inside a plane when dot(xyz, p) + w >= 0. */
+struct Frustum
+{
+    Vector4 myPlanes[6];
+};
+
+/* Every entity that can be drawn: a model instance with a position. */
+using DrawableQuery = Query<With<TransformComponent, ModelComponent>>;
+
+/* Drawable entities that passed culling, in query order. */
+struct VisibleSet
+{
+    Entity myEntities[MAX_ENTITIES];
+    uint32_t myCount;
+
+    /* Per query index result, written in parallel before compaction. */
+    uint8_t myFlags[MAX_ENTITIES];
+};
+
+namespace Systems
+{
+    /* Built from the camera alone, so it works without a window. */
+    Frustum MakeFrustum(const Camera3D& aCamera, float anAspect, float aNear, float aFar);
+
+    /*
+    * Tests the scaled model bounding sphere of every entity in aDrawables
+    * against the frustum, eight spheres at a time, and writes the survivors to
+    * aVisibleSet. aDrawables has to be built over the two lists.
+    */
+    void Cull(
+        ComponentList<TransformComponent>* someTransformComps,
+        ComponentList<ModelComponent>* someModelComps,
+        const DrawableQuery& aDrawables,
+        const Frustum& aFrustum,
+        VisibleSet* aVisibleSet,
+        JobSystem* aJobSystem);
+}
+
+#endif // CULLINGSYSTEM_H_
\ No newline at end of file
@@ -0,0 +1,172 @@
+#if !defined(DELTACODEC_H_)
+#define DELTACODEC_H_
+
+#pragma once
+
+#include "ComponentList.h"
+
+#include "../Utils/ByteStream.h"
+
+extern "C"
+{
+#include "../raylib/raylib.h"
+}
+
+/*
+* Delta encoding of a ComponentList, driven by its change versions:
+*   u16 upsert count, then per upsert: u16 entity, component payload
+*   u16 removal count, then per removal: u16 entity
+* An upsert carries the whole component, so applying a delta twice, or one
+* that starts before the receiver's version, is harmless.
+*/
+namespace DeltaCodec
+{
+    static_assert(MAX_ENTITIES <= 0xFFFFU, "Entities are sent as 16-bit values.");
+
+    /* anEncoder(ByteWriter*, const ComponentType&) writes one payload. */
+    template <class ComponentType, class Encoder>
+    void EncodeList(ComponentList<ComponentType>* aList, uint32_t aSinceVersion, ByteWriter* aWriter, const Encoder& anEncoder)
+    {
+        using List = ComponentList<ComponentType>;
+
+        size_t countOffset = aWriter->Size();
+        uint16_t count = 0U;
+        aWriter->WriteU16(count);
+
+        for (uint32_t chunk = 0U; chunk < List::CHANGE_CHUNK_COUNT; ++chunk)
+        {
+            if (aList->GetChunkVersion(chunk) <= aSinceVersion)
+            {
+                continue;
+            }
+
+            const Entity end = (chunk + 1U) * List::CHANGE_CHUNK_SIZE < MAX_ENTITIES ? (chunk + 1U) * List::CHANGE_CHUNK_SIZE : MAX_ENTITIES;
+            for (Entity e = chunk * List::CHANGE_CHUNK_SIZE; e < end; ++e)
+            {
+                if (aList->HasComponent(e) && aList->GetChangeVersion(e) > aSinceVersion)
+                {
+                    aWriter->WriteU16((uint16_t)e);
+                    anEncoder(aWriter, aList->GetComponent(e));
+                    ++count;
+                }
+            }
+        }
+        aWriter->Patch(countOffset, &count, sizeof(count));
+
+        countOffset = aWriter->Size();
+        count = 0U;
+        aWriter->WriteU16(count);
+
+        for (uint32_t chunk = 0U; chunk < List::CHANGE_CHUNK_COUNT; ++chunk)
+        {
+            if (aList->GetChunkVersion(chunk) <= aSinceVersion)
+            {
+                continue;
+            }
+
+            const Entity end = (chunk + 1U) * List::CHANGE_CHUNK_SIZE < MAX_ENTITIES ? (chunk + 1U) * List::CHANGE_CHUNK_SIZE : MAX_ENTITIES;
+            for (Entity e = chunk * List::CHANGE_CHUNK_SIZE; e < end; ++e)
+            {
+                if (!aList->HasComponent(e) && aList->GetRemoveVersion(e) > aSinceVersion)
+                {
+                    aWriter->WriteU16((uint16_t)e);
+                    ++count;
+                }
+            }
+        }
+        aWriter->Patch(countOffset, &count, sizeof(count));
+    }
+
+    /* Reads past one list's worth of delta without applying it. Returns false on malformed input. */
+    template <class ComponentType, class Decoder>
+    bool ValidateList(ByteReader* aReader, const Decoder& aDecoder)
+    {
+        ComponentType scratch{};
+
+        const uint16_t upsertCount = aReader->ReadU16();
+        for (uint16_t i = 0U; i < upsertCount && !aReader->HasFailed(); ++i)
+        {
+            if (aReader->ReadU16() >= MAX_ENTITIES)
+            {
+                return false;
+            }
+
+            aDecoder(aReader, scratch);
+        }
+
+        const uint16_t removeCount = aReader->ReadU16();
+        for (uint16_t i = 0U; i < removeCount && !aReader->HasFailed(); ++i)
+        {
+            if (aReader->ReadU16() >= MAX_ENTITIES)
+            {
+                return false;
+            }
+        }
+
+        return !aReader->HasFailed();
+    }
+
+    /*
+    * aDecoder(ByteReader*, ComponentType&) reads one payload. Applies as it
+    * reads, so a list that turns out malformed halfway has been partly
+    * applied when this returns false; run ValidateList() over the input first.
+    */
+    template <class ComponentType, class Decoder>
+    bool DecodeList(ByteReader* aReader, ComponentList<ComponentType>* aList, const Decoder& aDecoder)
+    {
+        const uint16_t upsertCount = aReader->ReadU16();
+        for (uint16_t i = 0U; i < upsertCount && !aReader->HasFailed(); ++i)
+        {
+            const Entity e = aReader->ReadU16();
+            if (e >= MAX_ENTITIES)
+            {
+                return false;
+            }
+
+            aDecoder(aReader, aList->HasComponent(e) ? aList->GetComponent(e) : aList->AddComponent(e));
+        }
+
+        const uint16_t removeCount = aReader->ReadU16();
+        for (uint16_t i = 0U; i < removeCount && !aReader->HasFailed(); ++i)
+        {
+            const Entity e = aReader->ReadU16();
+            if (e >= MAX_ENTITIES)
+            {
+                return false;
+            }
+
+            if (aList->HasComponent(e))
+            {
+                aList->RemoveComponent(e);
+            }
+        }
+
+        return !aReader->HasFailed();
+    }
+
+    /* 16 bits per axis across [aMin, aMax]; values outside are clamped. */
+    inline void WriteQuantized(ByteWriter* aWriter, const Vector3& aValue, const Vector3& aMin, const Vector3& aMax)
+    {
+        const float values[3] = { aValue.x, aValue.y, aValue.z };
+        const float minimum[3] = { aMin.x, aMin.y, aMin.z };
+        const float maximum[3] = { aMax.x, aMax.y, aMax.z };
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float normalized = (values[axis] - minimum[axis]) / (maximum[axis] - minimum[axis]);
+            normalized = normalized < 0.f ? 0.f : (normalized > 1.f ? 1.f : normalized);
+            aWriter->WriteU16((uint16_t)(normalized * 65535.f + 0.5f));
+        }
+    }
+
+    inline Vector3 ReadQuantized(ByteReader* aReader, const Vector3& aMin, const Vector3& aMax)
+    {
+        const float x = aReader->ReadU16() / 65535.f;
+        const float y = aReader->ReadU16() / 65535.f;
+        const float z = aReader->ReadU16() / 65535.f;
+
+        return { aMin.x + x * (aMax.x - aMin.x), aMin.y + y * (aMax.y - aMin.y), aMin.z + z * (aMax.z - aMin.z) };
+    }
+}
+
+#endif // DELTACODEC_H_
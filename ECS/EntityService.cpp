@@ -1,52 +1,84 @@
 #include "EntityService.h"
 
 #include <assert.h>
+#include <string.h>
 
 EntityService::EntityService()
-	: myFirstAvailableEntity(0)
-	, myAvailableEntitiesLL{(Entity)-1}
+	: myAvailableEntitiesLL{(Entity)-1}
 {
 	for (Entity ent = 0; ent < MAX_ENTITIES; ++ent)
 	{
-		myAvailableEntitiesLL[ent] = ent + 1;
 		myParentLL[ent] = (Entity)-1;
 	}
+
+	ResetFreeEntities();
 }
 
 EntityService::EntityService(const EntityService& ecs)
-	: myFirstAvailableEntity(0)
-	, myAvailableEntitiesLL{ (Entity)-1 }
 {
-	memcpy(this, &ecs, sizeof(EntityService));
+	*this = ecs;
 }
 
 EntityService::EntityService(EntityService&& ecs) noexcept
-	: myFirstAvailableEntity(0)
-	, myAvailableEntitiesLL{ (Entity)-1 }
 {
-	memcpy(this, &ecs, sizeof(EntityService));
+	*this = ecs;
 }
 
+/* Atomics cannot be copied as bytes, so they are loaded and stored one by one. Neither side may be in use by other threads. */
 EntityService& EntityService::operator=(const EntityService& ecs)
 {
-	memcpy(this, &ecs, sizeof(EntityService));
-	
+	memcpy(myParentLL, ecs.myParentLL, sizeof(myParentLL));
+	memcpy(myAvailableEntitiesLL, ecs.myAvailableEntitiesLL, sizeof(myAvailableEntitiesLL));
+	myCache = ecs.myCache;
+
+	for (Entity ent = 0U; ent < MAX_ENTITIES; ++ent)
+	{
+		myNextBlockLL[ent].store(ecs.myNextBlockLL[ent].load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+	myPool.store(ecs.myPool.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	myOccupiedEntities.Store(ecs.myOccupiedEntities.Load());
+
 	return *this;
 }
 
 EntityService& EntityService::operator=(EntityService&& ecs) noexcept
 {
-	memcpy(this, &ecs, sizeof(EntityService));
-
-	return *this;
+	return *this = ecs;
 }
 
 Entity EntityService::GetEntity()
 {
-	assert(myFirstAvailableEntity < MAX_ENTITIES && "There are no available entities.");
+	const Entity newEntity = GetEntity(&myCache);
+	assert(newEntity != INVALID_ENTITY && "There are no available entities.");
+
+	return newEntity;
+}
+
+void EntityService::ReturnEntity(Entity anEntity)
+{
+	ReturnEntity(&myCache, anEntity);
+}
+
+Entity EntityService::GetEntity(Cache* aCache)
+{
+	if (aCache->myCount == 0U)
+	{
+		const Entity block = PopBlock();
+		if (block == ourEndOfList)
+		{
+			return INVALID_ENTITY;
+		}
+
+		aCache->myFirst = block;
+		for (Entity ent = block; ent != ourEndOfList; ent = myAvailableEntitiesLL[ent])
+		{
+			++aCache->myCount;
+		}
+	}
 
-	Entity newEntity = myFirstAvailableEntity;
-	myFirstAvailableEntity = myAvailableEntitiesLL[myFirstAvailableEntity];
+	Entity newEntity = aCache->myFirst;
+	aCache->myFirst = myAvailableEntitiesLL[newEntity];
+	--aCache->myCount;
 	myAvailableEntitiesLL[newEntity] = (Entity)-1;
 	myParentLL[newEntity] = (Entity)-1;
 	myOccupiedEntities.Set(newEntity);
@@ -54,17 +86,45 @@ Entity EntityService::GetEntity()
 	return newEntity;
 }
 
-void EntityService::ReturnEntity(Entity anEntity)
+void EntityService::ReturnEntity(Cache* aCache, Entity anEntity)
 {
 	assert(anEntity < MAX_ENTITIES && "Entity out of range.");
-	assert(myAvailableEntitiesLL[anEntity] >= MAX_ENTITIES && "Attempting to return already available entity.");
+	assert(myAvailableEntitiesLL[anEntity] == (Entity)-1 && "Attempting to return already available entity.");
+
+	if (myAvailableEntitiesLL[anEntity] != (Entity)-1)
+	{
+		return;
+	}
+
+	myOccupiedEntities.Reset(anEntity);
+	myAvailableEntitiesLL[anEntity] = aCache->myFirst;
+	aCache->myFirst = anEntity;
+	++aCache->myCount;
+
+	/* Keep the block returned last, it is the one most likely still in cache, and share the older one. */
+	if (aCache->myCount == ENTITY_BLOCK_SIZE * 2U)
+	{
+		Entity last = aCache->myFirst;
+		for (uint32_t i = 1U; i < ENTITY_BLOCK_SIZE; ++i)
+		{
+			last = myAvailableEntitiesLL[last];
+		}
+
+		const Entity older = myAvailableEntitiesLL[last];
+		myAvailableEntitiesLL[last] = ourEndOfList;
+		aCache->myCount = ENTITY_BLOCK_SIZE;
+		PushBlock(older);
+	}
+}
 
-	if (myAvailableEntitiesLL[anEntity] >= MAX_ENTITIES)
+void EntityService::FlushCache(Cache* aCache)
+{
+	if (aCache->myCount > 0U)
 	{
-		myOccupiedEntities.Reset(anEntity);
-		myAvailableEntitiesLL[anEntity] = myFirstAvailableEntity;
-		myFirstAvailableEntity = anEntity;
+		PushBlock(aCache->myFirst);
 	}
+
+	*aCache = Cache();
 }
 
 Entity EntityService::GetParent(Entity anEntity) const
@@ -120,9 +180,9 @@ void EntityService::AppendChild(Entity aToBeParent, Entity aToBeChild)
 	myParentLL[aToBeChild] = aToBeParent;
 }
 
-const BitArray<MAX_ENTITIES>& EntityService::GetOccupiedEntities() const
+BitArray<MAX_ENTITIES> EntityService::GetOccupiedEntities() const
 {
-	return myOccupiedEntities;
+	return myOccupiedEntities.Load();
 }
 
 size_t EntityService::Count() const
@@ -132,13 +192,119 @@ size_t EntityService::Count() const
 
 void EntityService::Clear()
 {
-	myFirstAvailableEntity = 0;
-
 	for (Entity ent = 0; ent < MAX_ENTITIES; ++ent)
 	{
-		myAvailableEntitiesLL[ent] = ent + 1;
 		myParentLL[ent] = (Entity)-1;
 	}
 
+	ResetFreeEntities();
 	myOccupiedEntities.ResetAll();
+}
+
+void EntityService::ResetFreeEntities()
+{
+	myCache = Cache();
+	myPool.store(ourEndOfList, std::memory_order_relaxed);
+
+	/* Pushed back to front, so the first block handed out starts at entity 0. */
+	for (Entity first = (MAX_ENTITIES - 1U) / ENTITY_BLOCK_SIZE * ENTITY_BLOCK_SIZE; ; first -= ENTITY_BLOCK_SIZE)
+	{
+		const Entity end = first + ENTITY_BLOCK_SIZE < MAX_ENTITIES ? first + ENTITY_BLOCK_SIZE : MAX_ENTITIES;
+		for (Entity ent = first; ent < end; ++ent)
+		{
+			myAvailableEntitiesLL[ent] = ent + 1U < end ? ent + 1U : ourEndOfList;
+		}
+		PushBlock(first);
+
+		if (first == 0U)
+		{
+			break;
+		}
+	}
+}
+
+void EntityService::PushBlock(Entity aFirstEntity)
+{
+	uint64_t top = myPool.load(std::memory_order_relaxed);
+	uint64_t newTop;
+	do
+	{
+		myNextBlockLL[aFirstEntity].store((Entity)top, std::memory_order_relaxed);
+		newTop = ((top >> 32U) + 1U) << 32U | aFirstEntity;
+	} while (!myPool.compare_exchange_weak(top, newTop, std::memory_order_release, std::memory_order_relaxed));
+}
+
+Entity EntityService::PopBlock()
+{
+	uint64_t top = myPool.load(std::memory_order_acquire);
+	while (true)
+	{
+		const Entity first = (Entity)top;
+		if (first == ourEndOfList)
+		{
+			return ourEndOfList;
+		}
+
+		/* May read a block another thread just took; the push count then fails the exchange. */
+		const Entity next = myNextBlockLL[first].load(std::memory_order_relaxed);
+		const uint64_t newTop = ((top >> 32U) + 1U) << 32U | next;
+		if (myPool.compare_exchange_weak(top, newTop, std::memory_order_acquire, std::memory_order_acquire))
+		{
+			return first;
+		}
+	}
+}
+
+bool EntityService::IsConsistent() const
+{
+	for (Entity ent = 0U; ent < MAX_ENTITIES; ++ent)
+	{
+		if (myParentLL[ent] != (Entity)-1 && myParentLL[ent] >= MAX_ENTITIES)
+		{
+			return false;
+		}
+	}
+
+	/* Walks a free chain, refusing entities out of range, occupied or already seen, which also rules out cycles. */
+	BitArray<MAX_ENTITIES> seen;
+	auto walkChain = [&](Entity aFirst, uint32_t* aCountOut)
+	{
+		*aCountOut = 0U;
+		for (Entity ent = aFirst; ent != ourEndOfList; ent = myAvailableEntitiesLL[ent])
+		{
+			if (ent >= MAX_ENTITIES || seen.Test(ent) || myOccupiedEntities.Test(ent))
+			{
+				return false;
+			}
+			seen.Set(ent);
+			++*aCountOut;
+		}
+
+		return true;
+	};
+
+	uint32_t count;
+	if (!walkChain(myCache.myFirst, &count) || count != myCache.myCount)
+	{
+		return false;
+	}
+
+	for (Entity block = (Entity)myPool.load(std::memory_order_relaxed); block != ourEndOfList; block = myNextBlockLL[block].load(std::memory_order_relaxed))
+	{
+		if (block >= MAX_ENTITIES || !walkChain(block, &count) || count == 0U)
+		{
+			return false;
+		}
+	}
+
+	/* Nothing may be lost: every entity is either in use or free, and in-use ones are off the chains. */
+	for (Entity ent = 0U; ent < MAX_ENTITIES; ++ent)
+	{
+		if (myOccupiedEntities.Test(ent) == seen.Test(ent) || (myOccupiedEntities.Test(ent) && myAvailableEntitiesLL[ent] != (Entity)-1))
+		{
+			return false;
+		}
+	}
+
+	return true;
 }
\ No newline at end of file
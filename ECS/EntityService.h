@@ -4,15 +4,39 @@
 #pragma once
 
 #include <stdint.h>
+#include "../Utils/AtomicBitArray.h"
 #include "../Utils/BitArray.h"
 
+#include <atomic>
+
 using Entity = uint32_t;
 constexpr uint32_t MAX_ENTITIES = 768;
 constexpr Entity INVALID_ENTITY = Entity(-1);
+/* Free entities move between caches and the shared pool this many at a time. */
+constexpr uint32_t ENTITY_BLOCK_SIZE = 32U;
 
+/*
+* Free entities live in a lock-free pool of blocks. Each thread that creates
+* entities keeps a Cache of its own and only goes to the pool for a new block
+* when the cache runs dry, or hands a block back once it holds two. GetEntity()
+* and ReturnEntity() without a cache use one the service keeps for the thread
+* that owns it, and hand out IDs in the same order on every run.
+*
+* Any number of threads may call GetEntity(Cache*) and ReturnEntity(Cache*, ...)
+* at once, each with its own cache, for example one per ParallelFor batch.
+* Flush the cache at the end, or its entities stay out of reach of everyone
+* else. Everything else, including the calls without a cache, belongs to one
+* thread at a time, and not while threads allocate.
+*/
 class EntityService
 {
 public:
+	struct Cache
+	{
+		Entity myFirst = MAX_ENTITIES;
+		uint32_t myCount = 0U;
+	};
+
 	EntityService();
 	~EntityService() = default;
 
@@ -24,24 +48,79 @@ public:
 	Entity GetEntity();
 	void ReturnEntity(Entity anEntity);
 
+	/* Returns INVALID_ENTITY when neither the cache nor the pool has one left. */
+	Entity GetEntity(Cache* aCache);
+	void ReturnEntity(Cache* aCache, Entity anEntity);
+	/* Hands every entity in aCache back to the pool. */
+	void FlushCache(Cache* aCache);
+
 	Entity GetParent(Entity anEntity) const;
 	bool HasChildren(Entity anEntity) const;
 	bool IsChild(Entity anEntity) const;
 	BitArray<MAX_ENTITIES> GetChildren(Entity anEntity) const;
 	void AppendChild(Entity aToBeParent, Entity aToBeChild);
 
-	const BitArray<MAX_ENTITIES>& GetOccupiedEntities() const;
+	/* Copies the occupied bits word by word; only exact while no thread creates or removes entities. */
+	BitArray<MAX_ENTITIES> GetOccupiedEntities() const;
 	size_t Count() const;
 
+	/* Also empties the service's own cache. Other caches must be flushed before, or reset after. */
 	void Clear();
 
+	/* Reads or writes the service as snapshot sections under anOwner, see Snapshot.h. Flush other caches first. */
+	template <class Archive>
+	bool Serialize(Archive& anArchive, uint32_t anOwner);
+
 private:
+	/* Ends both free entity chains and the chain of blocks in the pool. */
+	static constexpr Entity ourEndOfList = MAX_ENTITIES;
+
+	void ResetFreeEntities();
+	void PushBlock(Entity aFirstEntity);
+	Entity PopBlock();
+	/* Whether every entity is either occupied or on exactly one free chain, and every link stays in range. */
+	bool IsConsistent() const;
+
 	Entity myParentLL[MAX_ENTITIES];
 
+	/* Next free entity in the same block or cache, or INVALID_ENTITY while the entity is in use. */
 	Entity myAvailableEntitiesLL[MAX_ENTITIES];
-	Entity myFirstAvailableEntity;
+	Cache myCache;
 
-	BitArray<MAX_ENTITIES> myOccupiedEntities;
+	/* Next block in the pool, indexed by the first entity of a block. */
+	std::atomic<Entity> myNextBlockLL[MAX_ENTITIES];
+	/* First entity of the top block in the low half, a push count against ABA in the high half. */
+	std::atomic<uint64_t> myPool;
+
+	/* Set and reset by threads creating and removing entities at once, so every word is atomic. */
+	AtomicBitArray<MAX_ENTITIES> myOccupiedEntities;
 };
 
+static_assert(sizeof(std::atomic<Entity>) == sizeof(Entity) && sizeof(std::atomic<uint64_t>) == sizeof(uint64_t)
+	&& sizeof(AtomicBitArray<MAX_ENTITIES>) == sizeof(BitArray<MAX_ENTITIES>),
+	"EntityService snapshots store its atomics as plain integers.");
+
+template <class Archive>
+inline bool EntityService::Serialize(Archive& anArchive, uint32_t anOwner)
+{
+	bool succeeded = anArchive.Section(anOwner, 0U, myParentLL, sizeof(myParentLL));
+	succeeded = succeeded && anArchive.Section(anOwner, 1U, myAvailableEntitiesLL, sizeof(myAvailableEntitiesLL));
+	succeeded = succeeded && anArchive.Section(anOwner, 2U, &myCache, sizeof(myCache));
+	succeeded = succeeded && anArchive.Section(anOwner, 3U, &myOccupiedEntities, sizeof(myOccupiedEntities));
+	succeeded = succeeded && anArchive.Section(anOwner, 4U, myNextBlockLL, sizeof(myNextBlockLL));
+	succeeded = succeeded && anArchive.Section(anOwner, 5U, &myPool, sizeof(myPool));
+
+	if (Archive::IS_LOADING)
+	{
+		/* Section hashes only catch accidents; a crafted file could still send the free chains anywhere. */
+		succeeded = succeeded && IsConsistent();
+		if (!succeeded)
+		{
+			Clear();
+		}
+	}
+
+	return succeeded;
+}
+
 #endif // ENTITYSERVICE_H_
\ No newline at end of file
@@ -1,21 +1,27 @@
 #include "MovementSystem.h"
 
+#include "../Utils/Profiler.h"
+
 extern "C"
 {
 #include "../raylib/raylib.h"
 #include "../raylib/raymath.h"
 }
 
-void Systems::MovementUpdate(ComponentList<TransformComponent>* someTransformComps, ComponentList<MovementComponent>* someMovementComps)
+void Systems::MovementUpdate(ComponentList<TransformComponent>* someTransformComps, ComponentList<MovementComponent>* someMovementComps, float aDeltaTime)
 {
+    PROFILE_ZONE("Systems::MovementUpdate");
+
     MovementComponent* movList = someMovementComps->GetDenseComponents();
-    const float dt = GetFrameTime();
+    const float dt = aDeltaTime;
 
     const uint32_t movCount = someMovementComps->GetSize();
     for (uint32_t compIndex = 0U; compIndex < movCount; ++compIndex)
     {
+        const Entity entity = someMovementComps->GetEntityFromComponent(compIndex);
         Vector3& vel = movList[compIndex].myVelocity;
-        Vector3& pos = someTransformComps->GetComponent(someMovementComps->GetEntityFromComponent(compIndex)).myPosition;
+        Vector3& pos = someTransformComps->GetComponent(entity).myPosition;
+        const Vector3 oldVel = vel;
 
         pos.x += vel.x * dt;
         pos.y += vel.y * dt;
@@ -36,5 +42,14 @@ void Systems::MovementUpdate(ComponentList<TransformComponent>* someTransformCom
             pos.z = Clamp(pos.z, -25.f, 25.f);
             vel.z *= -1.0f;
         }
+
+        if (oldVel.x != 0.f || oldVel.y != 0.f || oldVel.z != 0.f)
+        {
+            someTransformComps->MarkChanged(entity);
+        }
+        if (vel.x != oldVel.x || vel.y != oldVel.y || vel.z != oldVel.z)
+        {
+            someMovementComps->MarkChanged(entity);
+        }
     }
 }
\ No newline at end of file
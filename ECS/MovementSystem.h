@@ -8,7 +8,8 @@
 
 namespace Systems
 {
-    void MovementUpdate(ComponentList<TransformComponent>* someTransformComps, ComponentList<MovementComponent>* someMovementComps);
+    /* Advances every moving entity by aDeltaTime seconds. */
+    void MovementUpdate(ComponentList<TransformComponent>* someTransformComps, ComponentList<MovementComponent>* someMovementComps, float aDeltaTime);
 }
 
 #endif // MOVEMENTSYSTEM_H_
\ No newline at end of file
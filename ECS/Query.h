@@ -0,0 +1,202 @@
+#if !defined(QUERY_H_)
+#define QUERY_H_
+
+#pragma once
+
+#include "ComponentList.h"
+
+#include <tuple>
+
+/*
+* Query terms. An entity matches when it has every With component and none of
+* the Without ones; Optional components are handed to ForEach() when present
+* and do not affect matching.
+*/
+template <class... ComponentTypes>
+struct With {};
+
+template <class... ComponentTypes>
+struct Without {};
+
+template <class... ComponentTypes>
+struct Optional {};
+
+/*
+* Keeps the list of entities matching its terms, for example
+*
+*     Query<With<TransformComponent, ModelComponent>, Without<MovementComponent>> statics(transforms, models, movements);
+*
+* The lists are passed in any order, one per component type named in the
+* terms, and must outlive the query. The query listens to their membership
+* changes and updates itself as components are added and removed, so looking
+* at it costs nothing beyond walking a dense entity array. Activation state is
+* not part of matching. Tag components work in every term; ForEach() hands
+* them over as references to the shared empty tag.
+*/
+template <class WithTerm, class WithoutTerm = Without<>, class OptionalTerm = Optional<>>
+class Query;
+
+template <class... WithTypes, class... WithoutTypes, class... OptionalTypes>
+class Query<With<WithTypes...>, Without<WithoutTypes...>, Optional<OptionalTypes...>>
+{
+	static_assert(sizeof...(WithTypes) > 0U, "A query needs at least one With component.");
+
+public:
+	template <class... ListTypes>
+	explicit Query(ListTypes&... someLists);
+	~Query();
+
+	Query(const Query&) = delete;
+	Query(Query&&) = delete;
+	Query& operator=(const Query&) = delete;
+	Query& operator=(Query&&) = delete;
+
+	uint32_t GetSize() const;
+	/* In no particular order; the order changes as entities come and go. */
+	const Entity* GetEntities() const;
+	bool Contains(Entity anEntity) const;
+
+	/*
+	* Calls aFunction(entity, WithTypes&..., OptionalTypes*...) for every match,
+	* with nullptr for absent optional components. The callback may remove
+	* components from the entity it is given, but not from other matches.
+	*/
+	template <class Function>
+	void ForEach(Function&& aFunction);
+
+private:
+	static void OnMembershipChanged(Entity anEntity, bool aHasComponent, void* aUserData);
+
+	bool Matches(Entity anEntity);
+	void Refresh(Entity anEntity);
+
+	template <class ComponentType>
+	ComponentList<ComponentType>& GetList();
+
+	std::tuple<ComponentList<WithTypes>*..., ComponentList<WithoutTypes>*..., ComponentList<OptionalTypes>*...> myLists;
+	/* Listener slots, in the order of myLists. */
+	int mySlots[sizeof...(WithTypes) + sizeof...(WithoutTypes)];
+
+	Entity myEntities[MAX_ENTITIES];
+	uint32_t myIndexOfEntity[MAX_ENTITIES];
+	uint32_t mySize;
+	BitArray<MAX_ENTITIES> myMatches;
+};
+
+template <class... WithTypes, class... WithoutTypes, class... OptionalTypes>
+template <class... ListTypes>
+inline Query<With<WithTypes...>, Without<WithoutTypes...>, Optional<OptionalTypes...>>::Query(ListTypes&... someLists)
+	: myLists(std::get<ComponentList<WithTypes>*>(std::make_tuple(&someLists...))...,
+		std::get<ComponentList<WithoutTypes>*>(std::make_tuple(&someLists...))...,
+		std::get<ComponentList<OptionalTypes>*>(std::make_tuple(&someLists...))...)
+	, mySize(0U)
+{
+	static_assert(sizeof...(ListTypes) == sizeof...(WithTypes) + sizeof...(WithoutTypes) + sizeof...(OptionalTypes),
+		"Pass exactly one list per component type in the query.");
+
+	/* Optional lists are only read, so only the others need listening to. */
+	uint32_t slot = 0U;
+	((mySlots[slot++] = GetList<WithTypes>().AddMembershipListener(OnMembershipChanged, this)), ...);
+	((mySlots[slot++] = GetList<WithoutTypes>().AddMembershipListener(OnMembershipChanged, this)), ...);
+	for (int listenerSlot : mySlots)
+	{
+		assert(listenerSlot >= 0 && "Out of membership listener slots.");
+		(void)listenerSlot;
+	}
+
+	/* Every match is in the first With list, so only its entities need checking. */
+	using FirstType = std::tuple_element_t<0U, std::tuple<WithTypes...>>;
+	const BitArray<MAX_ENTITIES>& candidates = GetList<FirstType>().GetEntitiesContainingComponent();
+	for (size_t e = candidates.FindNext(0U); e < MAX_ENTITIES; e = candidates.FindNext(e + 1U))
+	{
+		Refresh((Entity)e);
+	}
+}
+
+template <class... WithTypes, class... WithoutTypes, class... OptionalTypes>
+inline Query<With<WithTypes...>, Without<WithoutTypes...>, Optional<OptionalTypes...>>::~Query()
+{
+	uint32_t slot = 0U;
+	(GetList<WithTypes>().RemoveMembershipListener(mySlots[slot++]), ...);
+	(GetList<WithoutTypes>().RemoveMembershipListener(mySlots[slot++]), ...);
+}
+
+template <class... WithTypes, class... WithoutTypes, class... OptionalTypes>
+inline uint32_t Query<With<WithTypes...>, Without<WithoutTypes...>, Optional<OptionalTypes...>>::GetSize() const
+{
+	return mySize;
+}
+
+template <class... WithTypes, class... WithoutTypes, class... OptionalTypes>
+inline const Entity* Query<With<WithTypes...>, Without<WithoutTypes...>, Optional<OptionalTypes...>>::GetEntities() const
+{
+	return myEntities;
+}
+
+template <class... WithTypes, class... WithoutTypes, class... OptionalTypes>
+inline bool Query<With<WithTypes...>, Without<WithoutTypes...>, Optional<OptionalTypes...>>::Contains(Entity anEntity) const
+{
+	assert(anEntity < MAX_ENTITIES && "Entity out of range.");
+
+	return myMatches.Test(anEntity);
+}
+
+template <class... WithTypes, class... WithoutTypes, class... OptionalTypes>
+template <class Function>
+inline void Query<With<WithTypes...>, Without<WithoutTypes...>, Optional<OptionalTypes...>>::ForEach(Function&& aFunction)
+{
+	/* Backwards, so a removal only swaps in an entity that was already visited. */
+	for (uint32_t index = mySize; index > 0U; --index)
+	{
+		const Entity entity = myEntities[index - 1U];
+		aFunction(entity,
+			GetList<WithTypes>().GetComponent(entity)...,
+			(GetList<OptionalTypes>().HasComponent(entity) ? &GetList<OptionalTypes>().GetComponent(entity) : nullptr)...);
+	}
+}
+
+template <class... WithTypes, class... WithoutTypes, class... OptionalTypes>
+inline void Query<With<WithTypes...>, Without<WithoutTypes...>, Optional<OptionalTypes...>>::OnMembershipChanged(Entity anEntity, bool, void* aUserData)
+{
+	static_cast<Query*>(aUserData)->Refresh(anEntity);
+}
+
+template <class... WithTypes, class... WithoutTypes, class... OptionalTypes>
+inline bool Query<With<WithTypes...>, Without<WithoutTypes...>, Optional<OptionalTypes...>>::Matches(Entity anEntity)
+{
+	return (GetList<WithTypes>().HasComponent(anEntity) && ...) && !(GetList<WithoutTypes>().HasComponent(anEntity) || ...);
+}
+
+template <class... WithTypes, class... WithoutTypes, class... OptionalTypes>
+inline void Query<With<WithTypes...>, Without<WithoutTypes...>, Optional<OptionalTypes...>>::Refresh(Entity anEntity)
+{
+	const bool isMatch = Matches(anEntity);
+	if (isMatch == myMatches.Test(anEntity))
+	{
+		return;
+	}
+
+	if (isMatch)
+	{
+		myMatches.Set(anEntity);
+		myIndexOfEntity[anEntity] = mySize;
+		myEntities[mySize++] = anEntity;
+	}
+	else
+	{
+		myMatches.Reset(anEntity);
+		const uint32_t index = myIndexOfEntity[anEntity];
+		const Entity last = myEntities[--mySize];
+		myEntities[index] = last;
+		myIndexOfEntity[last] = index;
+	}
+}
+
+template <class... WithTypes, class... WithoutTypes, class... OptionalTypes>
+template <class ComponentType>
+inline ComponentList<ComponentType>& Query<With<WithTypes...>, Without<WithoutTypes...>, Optional<OptionalTypes...>>::GetList()
+{
+	return *std::get<ComponentList<ComponentType>*>(myLists);
+}
+
+#endif // QUERY_H_
@@ -0,0 +1,198 @@
+#include "RenderBackend.h"
+
+#include "../Game/ModelManager.h"
+#include "../Utils/Profiler.h"
+
+#include <string.h>
+
+namespace
+{
+    /*
+    * Per-instance data travels in the instance matrix. The bottom row of an affine
+    * transform is always (0, 0, 0, 1), so it carries the tint and the vertex shader
+    * restores it before transforming.
+    */
+#if defined(__EMSCRIPTEN__)
+    static const char* const ourInstancingVS = R"(#version 100
+attribute vec3 vertexPosition;
+attribute vec2 vertexTexCoord;
+attribute mat4 instanceTransform;
+uniform mat4 mvp;
+varying vec2 fragTexCoord;
+varying vec4 fragColor;
+void main()
+{
+    mat4 model = instanceTransform;
+    fragColor = vec4(model[0].w, model[1].w, model[2].w, model[3].w);
+    model[0].w = 0.0; model[1].w = 0.0; model[2].w = 0.0; model[3].w = 1.0;
+    fragTexCoord = vertexTexCoord;
+    gl_Position = mvp*model*vec4(vertexPosition, 1.0);
+})";
+    static const char* const ourInstancingFS = R"(#version 100
+precision mediump float;
+varying vec2 fragTexCoord;
+varying vec4 fragColor;
+uniform sampler2D texture0;
+uniform vec4 colDiffuse;
+void main()
+{
+    gl_FragColor = texture2D(texture0, fragTexCoord)*colDiffuse*fragColor;
+})";
+#else
+    static const char* const ourInstancingVS = R"(#version 330
+in vec3 vertexPosition;
+in vec2 vertexTexCoord;
+in mat4 instanceTransform;
+uniform mat4 mvp;
+out vec2 fragTexCoord;
+out vec4 fragColor;
+void main()
+{
+    mat4 model = instanceTransform;
+    fragColor = vec4(model[0].w, model[1].w, model[2].w, model[3].w);
+    model[0].w = 0.0; model[1].w = 0.0; model[2].w = 0.0; model[3].w = 1.0;
+    fragTexCoord = vertexTexCoord;
+    gl_Position = mvp*model*vec4(vertexPosition, 1.0);
+})";
+    static const char* const ourInstancingFS = R"(#version 330
+in vec2 fragTexCoord;
+in vec4 fragColor;
+uniform sampler2D texture0;
+uniform vec4 colDiffuse;
+out vec4 finalColor;
+void main()
+{
+    finalColor = texture(texture0, fragTexCoord)*colDiffuse*fragColor;
+})";
+#endif
+
+    static Matrix MakeInstanceMatrix(const RenderInstance& anInstance)
+    {
+        const float s = anInstance.myScale;
+        const Vector3& p = anInstance.myPosition;
+        const Color& c = anInstance.myColor;
+
+        Matrix m;
+        m.m0 = s;   m.m4 = 0.f; m.m8 = 0.f;  m.m12 = p.x;
+        m.m1 = 0.f; m.m5 = s;   m.m9 = 0.f;  m.m13 = p.y;
+        m.m2 = 0.f; m.m6 = 0.f; m.m10 = s;   m.m14 = p.z;
+        m.m3 = c.r / 255.f; m.m7 = c.g / 255.f; m.m11 = c.b / 255.f; m.m15 = c.a / 255.f;
+
+        return m;
+    }
+
+    static uint32_t MaterialOf(uint64_t aSortKey)
+    {
+        return (uint32_t)((aSortKey >> RenderKey::MATERIAL_SHIFT) & RenderKey::MATERIAL_MASK);
+    }
+
+    static uint32_t LodOf(uint64_t aSortKey)
+    {
+        return (uint32_t)((aSortKey >> RenderKey::LOD_SHIFT) & RenderKey::LOD_MASK);
+    }
+}
+
+void RaylibRenderBackend::Init()
+{
+    Shader& shader = myInstancingShader;
+    shader = LoadShaderFromMemory(ourInstancingVS, ourInstancingFS);
+    shader.locs[SHADER_LOC_MATRIX_MVP] = GetShaderLocation(shader, "mvp");
+    shader.locs[SHADER_LOC_COLOR_DIFFUSE] = GetShaderLocation(shader, "colDiffuse");
+    shader.locs[SHADER_LOC_MATRIX_MODEL] = GetShaderLocationAttrib(shader, "instanceTransform");
+}
+
+void RaylibRenderBackend::Terminate()
+{
+    UnloadShader(myInstancingShader);
+}
+
+void RaylibRenderBackend::Execute(const RenderCommandList& aCommands)
+{
+    PROFILE_ZONE("RenderBackend::Execute");
+
+    const RenderCommand* commands = aCommands.GetCommands();
+    const RenderInstance* instances = aCommands.GetInstances();
+    const uint32_t count = aCommands.GetSize();
+
+    myDrawCallCount = 0U;
+
+    uint32_t runStart = 0U;
+    while (runStart < count)
+    {
+        /* Commands are sorted by model, material then LOD, so each batch is a contiguous run. */
+        const ModelID model = instances[commands[runStart].myInstanceIndex].myModel;
+        const uint32_t material = MaterialOf(commands[runStart].mySortKey);
+        const uint32_t lod = LodOf(commands[runStart].mySortKey);
+
+        uint32_t runEnd = runStart;
+        for (; runEnd < count; ++runEnd)
+        {
+            const RenderInstance& instance = instances[commands[runEnd].myInstanceIndex];
+            if (instance.myModel != model || MaterialOf(commands[runEnd].mySortKey) != material || LodOf(commands[runEnd].mySortKey) != lod)
+            {
+                break;
+            }
+
+            myInstanceMatrices[runEnd - runStart] = MakeInstanceMatrix(instance);
+        }
+
+        const Model* drawModel = ModelManager::GetModel(model, lod);
+        for (int mesh = 0; drawModel && mesh < drawModel->meshCount; ++mesh)
+        {
+            Material drawMaterial = drawModel->materials[drawModel->meshMaterial[mesh]];
+            drawMaterial.shader = myInstancingShader;
+
+            DrawMeshInstanced(drawModel->meshes[mesh], drawMaterial, myInstanceMatrices, (int)(runEnd - runStart));
+            ++myDrawCallCount;
+        }
+
+        runStart = runEnd;
+    }
+}
+
+uint32_t RaylibRenderBackend::GetDrawCallCount() const
+{
+    return myDrawCallCount;
+}
+
+void NullRenderBackend::Execute(const RenderCommandList& aCommands)
+{
+    const RenderCommand* commands = aCommands.GetCommands();
+    const RenderInstance* instances = aCommands.GetInstances();
+    const uint32_t count = aCommands.GetSize();
+
+    bool seen[MAX_ENTITIES];
+    memset(seen, 0, sizeof(seen));
+
+    myStats = { count, 0U, 0U };
+
+    for (uint32_t i = 0U; i < count; ++i)
+    {
+        const uint32_t instance = commands[i].myInstanceIndex;
+        if (instance >= count || seen[instance])
+        {
+            ++myStats.myErrorCount;
+            continue;
+        }
+        seen[instance] = true;
+
+        if (i > 0U && commands[i].mySortKey < commands[i - 1].mySortKey)
+        {
+            ++myStats.myErrorCount;
+        }
+
+        const uint32_t previous = i > 0U ? commands[i - 1].myInstanceIndex : 0U;
+        if (i == 0U || previous >= count
+            || instances[previous].myModel != instances[instance].myModel
+            || MaterialOf(commands[i - 1].mySortKey) != MaterialOf(commands[i].mySortKey)
+            || LodOf(commands[i - 1].mySortKey) != LodOf(commands[i].mySortKey))
+        {
+            ++myStats.myBatchCount;
+        }
+    }
+}
+
+const NullRenderStats& NullRenderBackend::GetStats() const
+{
+    return myStats;
+}
\ No newline at end of file
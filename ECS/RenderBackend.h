@@ -0,0 +1,59 @@
+#if !defined(RENDERBACKEND_H_)
+#define RENDERBACKEND_H_
+
+#pragma once
+
+#include "RenderCommandList.h"
+
+extern "C"
+{
+#include "../raylib/raylib.h"
+}
+
+/* Consumes a sorted RenderCommandList. Keeps GPU calls out of the ECS passes. */
+class RenderBackend
+{
+public:
+    virtual ~RenderBackend() = default;
+
+    virtual void Execute(const RenderCommandList& aCommands) = 0;
+};
+
+/* Draws every run of commands sharing a model and LOD with one instanced draw per mesh. Needs a GL context. */
+class RaylibRenderBackend : public RenderBackend
+{
+public:
+    void Init();
+    void Terminate();
+
+    void Execute(const RenderCommandList& aCommands) override;
+
+    uint32_t GetDrawCallCount() const;
+
+private:
+    Shader myInstancingShader;
+    Matrix myInstanceMatrices[MAX_ENTITIES];
+    uint32_t myDrawCallCount = 0U;
+};
+
+struct NullRenderStats
+{
+    uint32_t myCommandCount;
+    uint32_t myBatchCount;
+    /* Commands out of sort order, or pointing at missing or repeated instances. */
+    uint32_t myErrorCount;
+};
+
+/* Counts and validates commands without drawing, for headless tests and benchmarks. */
+class NullRenderBackend : public RenderBackend
+{
+public:
+    void Execute(const RenderCommandList& aCommands) override;
+
+    const NullRenderStats& GetStats() const;
+
+private:
+    NullRenderStats myStats = { 0U, 0U, 0U };
+};
+
+#endif // RENDERBACKEND_H_
\ No newline at end of file
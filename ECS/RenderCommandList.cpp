@@ -0,0 +1,94 @@
+#include "RenderCommandList.h"
+
+#include <assert.h>
+#include <string.h>
+
+RenderCommandList::RenderCommandList()
+    : mySize(0U)
+{
+}
+
+void RenderCommandList::Clear()
+{
+    mySize = 0U;
+}
+
+uint32_t RenderCommandList::Reserve(uint32_t aCount)
+{
+    assert(mySize + aCount <= MAX_ENTITIES && "Render command list is full.");
+
+    const uint32_t first = mySize;
+    mySize += aCount;
+
+    return first;
+}
+
+void RenderCommandList::Set(uint32_t aSlot, uint64_t aSortKey, const RenderInstance& anInstance)
+{
+    assert(aSlot < mySize && "Slot was not reserved.");
+
+    myCommands[aSlot].mySortKey = aSortKey;
+    myCommands[aSlot].myInstanceIndex = aSlot;
+    myInstances[aSlot] = anInstance;
+}
+
+void RenderCommandList::Sort()
+{
+    RenderCommand* source = myCommands;
+    RenderCommand* target = mySortScratch;
+
+    for (uint32_t pass = 0U; pass < 8U; ++pass)
+    {
+        const uint32_t shift = pass * 8U;
+
+        uint32_t histogram[256];
+        memset(histogram, 0, sizeof(histogram));
+        for (uint32_t i = 0U; i < mySize; ++i)
+        {
+            ++histogram[(source[i].mySortKey >> shift) & 0xFF];
+        }
+
+        /* Every key has the same byte here, this pass would not move anything. */
+        if (mySize == 0U || histogram[(source[0].mySortKey >> shift) & 0xFF] == mySize)
+        {
+            continue;
+        }
+
+        uint32_t offset = 0U;
+        for (uint32_t bucket = 0U; bucket < 256U; ++bucket)
+        {
+            const uint32_t bucketSize = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketSize;
+        }
+
+        for (uint32_t i = 0U; i < mySize; ++i)
+        {
+            target[histogram[(source[i].mySortKey >> shift) & 0xFF]++] = source[i];
+        }
+
+        RenderCommand* swap = source;
+        source = target;
+        target = swap;
+    }
+
+    if (source != myCommands)
+    {
+        memcpy(myCommands, source, sizeof(RenderCommand) * mySize);
+    }
+}
+
+const RenderCommand* RenderCommandList::GetCommands() const
+{
+    return myCommands;
+}
+
+const RenderInstance* RenderCommandList::GetInstances() const
+{
+    return myInstances;
+}
+
+uint32_t RenderCommandList::GetSize() const
+{
+    return mySize;
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#if !defined(RENDERCOMMANDLIST_H_)
+#define RENDERCOMMANDLIST_H_
+
+#pragma once
+
+#include <stdint.h>
+
+#include "EntityService.h"
+#include "Components.h"
+
+/*
+* Sort key layout, most significant first:
+*   63..40  model     (24 bits, low bits of the ModelID)
+*   39..32  material  (8 bits, material slot of the model)
+*   31..28  lod       (4 bits, level of detail picked for the instance)
+*   27..12  depth     (16 bits, quantized camera distance, front to back)
+*   11..0   unused
+*/
+namespace RenderKey
+{
+    constexpr uint32_t MODEL_SHIFT = 40U;
+    constexpr uint32_t MATERIAL_SHIFT = 32U;
+    constexpr uint32_t LOD_SHIFT = 28U;
+    constexpr uint32_t DEPTH_SHIFT = 12U;
+
+    constexpr uint64_t MODEL_MASK = 0xFFFFFFULL;
+    constexpr uint64_t MATERIAL_MASK = 0xFFULL;
+    constexpr uint64_t LOD_MASK = 0xFULL;
+    constexpr uint64_t DEPTH_MASK = 0xFFFFULL;
+
+    /* Distance mapped to the last depth bucket; anything further is clamped. */
+    constexpr float MAX_DEPTH = 1000.0f;
+
+    inline uint64_t Make(ModelID aModel, uint32_t aMaterial, uint32_t aLod, float aDistance)
+    {
+        float normalized = aDistance / MAX_DEPTH;
+        normalized = normalized < 0.f ? 0.f : (normalized > 1.f ? 1.f : normalized);
+        const uint64_t depth = (uint64_t)(normalized * (float)DEPTH_MASK);
+
+        return (((uint64_t)aModel & MODEL_MASK) << MODEL_SHIFT)
+            | (((uint64_t)aMaterial & MATERIAL_MASK) << MATERIAL_SHIFT)
+            | (((uint64_t)aLod & LOD_MASK) << LOD_SHIFT)
+            | ((depth & DEPTH_MASK) << DEPTH_SHIFT);
+    }
+}
+
+struct RenderCommand
+{
+    uint64_t mySortKey;
+    uint32_t myInstanceIndex;
+};
+
+struct RenderInstance
+{
+    Vector3 myPosition;
+    float myScale;
+    Color myColor;
+    ModelID myModel;
+};
+
+/*
+* Output of Systems::Render: one command per visible model instance, plus the
+* instance data the commands point into. Filled in parallel (each producer owns
+* its slots), sorted, then handed to a RenderBackend.
+*/
+class RenderCommandList
+{
+public:
+    RenderCommandList();
+    ~RenderCommandList() = default;
+
+    RenderCommandList(const RenderCommandList&) = delete;
+    RenderCommandList& operator=(const RenderCommandList&) = delete;
+
+    void Clear();
+    /* Reserves aCount slots for direct writes and returns the first one. Not thread-safe. */
+    uint32_t Reserve(uint32_t aCount);
+    void Set(uint32_t aSlot, uint64_t aSortKey, const RenderInstance& anInstance);
+
+    /* LSD radix sort on the sort key; stable, skips bytes that are identical for every key. */
+    void Sort();
+
+    const RenderCommand* GetCommands() const;
+    const RenderInstance* GetInstances() const;
+    uint32_t GetSize() const;
+
+private:
+    RenderCommand myCommands[MAX_ENTITIES];
+    RenderCommand mySortScratch[MAX_ENTITIES];
+    RenderInstance myInstances[MAX_ENTITIES];
+    uint32_t mySize;
+};
+
+#endif // RENDERCOMMANDLIST_H_
\ No newline at end of file
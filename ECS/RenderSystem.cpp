@@ -1,22 +1,73 @@
 #include "RenderSystem.h"
 
+#include "../Utils/Profiler.h"
+
 extern "C"
 {
-#include "../raylib/raylib.h"
+#include "../raylib/raymath.h"
+}
+
+#include <math.h>
+
+namespace Systems
+{
+    constexpr uint32_t RENDER_BATCH_SIZE = 128U;
+
+    /* Screen height fraction the bounding sphere must cover to stay at each level; below the last, the coarsest level is used. */
+    constexpr float LOD_SCREEN_SIZES[MAX_MODEL_LODS - 1] = { 0.25f, 0.1f, 0.04f };
+
+    static_assert(MAX_MODEL_LODS <= RenderKey::LOD_MASK + 1, "LOD level has to fit its sort key bits.");
+
+    static uint32_t SelectLod(float aScreenSize, uint32_t aLodCount)
+    {
+        uint32_t lod = 0U;
+        while (lod + 1 < aLodCount && aScreenSize < LOD_SCREEN_SIZES[lod])
+        {
+            ++lod;
+        }
+
+        return lod;
+    }
 }
 
 void Systems::Render(
     ComponentList<TransformComponent>* someTransformComps,
-    ComponentList<ModelComponent>* someModelComps)
+    ComponentList<ModelComponent>* someModelComps,
+    const VisibleSet* aVisibleSet,
+    const Camera3D& aCamera,
+    RenderCommandList* aCommandList,
+    JobSystem* aJobSystem)
 {
-    ModelComponent* modelList = someModelComps->GetDenseComponents();
+    PROFILE_ZONE("Systems::Render");
+
+    const uint32_t count = aVisibleSet->myCount;
+
+    aCommandList->Clear();
+    const uint32_t firstSlot = aCommandList->Reserve(count);
+
+    /* Screen height covered per unit of radius, divided by distance for perspective cameras. */
+    const bool isPerspective = aCamera.projection != CAMERA_ORTHOGRAPHIC;
+    const float sizeScale = isPerspective ? 1.f / tanf(aCamera.fovy * 0.5f * DEG2RAD) : 2.f / aCamera.fovy;
 
-    const uint32_t count = someModelComps->GetSize();
-    for (uint32_t compIndex = 0U; compIndex < count; ++compIndex)
+    aJobSystem->ParallelFor(count, RENDER_BATCH_SIZE, [&](uint32_t aBegin, uint32_t anEnd)
     {
-        const TransformComponent& trs = someTransformComps->GetComponent(someModelComps->GetEntityFromComponent(compIndex));
-        const ModelComponent& model = modelList[compIndex];
+        for (uint32_t visibleIndex = aBegin; visibleIndex < anEnd; ++visibleIndex)
+        {
+            const Entity entity = aVisibleSet->myEntities[visibleIndex];
+            const TransformComponent& trs = someTransformComps->GetComponent(entity);
+            const ModelComponent& model = someModelComps->GetComponent(entity);
 
-        DrawModel(*ModelManager::GetModel(model.myModel), trs.myPosition, model.myScale, model.myColor);
-    }
+            const float distance = Vector3Distance(trs.myPosition, aCamera.position);
+            const float radius = ModelManager::GetBoundingSphere(model.myModel).myRadius * model.myScale;
+            const float screenSize = isPerspective ? radius * sizeScale / fmaxf(distance, 1e-4f) : radius * sizeScale;
+            const uint32_t lod = SelectLod(screenSize, ModelManager::GetLodCount(model.myModel));
+
+            const RenderInstance instance = { trs.myPosition, model.myScale, model.myColor, model.myModel };
+            const uint64_t key = RenderKey::Make(model.myModel, 0U, lod, distance);
+
+            aCommandList->Set(firstSlot + visibleIndex, key, instance);
+        }
+    });
+
+    aCommandList->Sort();
 }
\ No newline at end of file
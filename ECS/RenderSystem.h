@@ -5,14 +5,25 @@
 
 #include "ComponentList.h"
 #include "Components.h"
+#include "CullingSystem.h"
+#include "RenderCommandList.h"
 
-#include "../Utils/Dictionary.h"
+#include "../Utils/JobSystem.h"
 
 namespace Systems
 {
+    /*
+    * Emits one sorted render command per visible model instance, with the LOD
+    * level picked from how much of the screen height the instance covers.
+    * Does not touch the GPU.
+    */
     void Render(
         ComponentList<TransformComponent>* someTransformComps,
-        ComponentList<ModelComponent>* someModelComps);
+        ComponentList<ModelComponent>* someModelComps,
+        const VisibleSet* aVisibleSet,
+        const Camera3D& aCamera,
+        RenderCommandList* aCommandList,
+        JobSystem* aJobSystem);
 }
 
 #endif // RENDERSYSTEM_H_
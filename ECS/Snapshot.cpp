@@ -0,0 +1,194 @@
+#include "Snapshot.h"
+
+#include "EntityService.h"
+#include "../Game/Misc.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+    constexpr uint32_t SNAPSHOT_MAGIC = 0x504E5357; // "WSNP"
+    /* Bump whenever a section changes meaning or layout. 2: entity free lists split into cached blocks and a pool. */
+    constexpr uint32_t SNAPSHOT_VERSION = 2U;
+
+    struct SnapshotHeader
+    {
+        uint32_t myMagic;
+        uint32_t myVersion;
+        uint32_t myMaxEntities;
+        uint32_t mySectionCount;
+        uint64_t myFileSize;
+        uint64_t myReserved;
+    };
+    static_assert(sizeof(SnapshotHeader) == 32, "Snapshot header must stay tightly packed.");
+    static_assert(sizeof(SnapshotSectionEntry) == 32, "Snapshot section entries must stay tightly packed.");
+
+    uint32_t MakeTag(uint32_t anOwner, uint32_t aField)
+    {
+        return anOwner << 8 | (aField & 0xFFU);
+    }
+
+    uint64_t Align(uint64_t aSize)
+    {
+        return (aSize + SNAPSHOT_ALIGNMENT - 1U) & ~uint64_t(SNAPSHOT_ALIGNMENT - 1U);
+    }
+
+    bool WritePadding(FILE* aFile, uint64_t aSize)
+    {
+        static const char padding[SNAPSHOT_ALIGNMENT] = { 0 };
+        const size_t count = (size_t)(Align(aSize) - aSize);
+
+        return fwrite(padding, 1, count, aFile) == count;
+    }
+}
+
+SnapshotWriter::SnapshotWriter()
+    : mySectionCount(0U)
+    , myOverflowed(false)
+{
+}
+
+bool SnapshotWriter::Section(uint32_t anOwner, uint32_t aField, const void* aData, uint64_t aSize)
+{
+    if (mySectionCount == MAX_SNAPSHOT_SECTIONS)
+    {
+        myOverflowed = true;
+        return false;
+    }
+
+    mySections[mySectionCount++] = { MakeTag(anOwner, aField), aData, aSize };
+    return true;
+}
+
+bool SnapshotWriter::Save(const char* const aPath) const
+{
+    if (myOverflowed)
+    {
+        return false;
+    }
+
+    SnapshotSectionEntry table[MAX_SNAPSHOT_SECTIONS];
+    uint64_t offset = Align(sizeof(SnapshotHeader) + sizeof(SnapshotSectionEntry) * mySectionCount);
+    for (uint32_t i = 0U; i < mySectionCount; ++i)
+    {
+        table[i] = { mySections[i].myTag, 0U, offset, mySections[i].mySize, HashMemory(mySections[i].myData, (size_t)mySections[i].mySize) };
+        offset += Align(mySections[i].mySize);
+    }
+
+    SnapshotHeader header;
+    header.myMagic = SNAPSHOT_MAGIC;
+    header.myVersion = SNAPSHOT_VERSION;
+    header.myMaxEntities = MAX_ENTITIES;
+    header.mySectionCount = mySectionCount;
+    header.myFileSize = offset;
+    header.myReserved = 0U;
+
+    /* Written under a temporary name and renamed, so a crash mid-save keeps the previous snapshot. */
+    char tempPath[512];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", aPath);
+
+    FILE* file = fopen(tempPath, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    const uint64_t tableBytes = sizeof(SnapshotSectionEntry) * mySectionCount;
+    bool succeeded = fwrite(&header, sizeof(header), 1, file) == 1;
+    succeeded = succeeded && fwrite(table, 1, (size_t)tableBytes, file) == tableBytes;
+    succeeded = succeeded && WritePadding(file, sizeof(header) + tableBytes);
+
+    for (uint32_t i = 0U; succeeded && i < mySectionCount; ++i)
+    {
+        succeeded = fwrite(mySections[i].myData, 1, (size_t)mySections[i].mySize, file) == mySections[i].mySize;
+        succeeded = succeeded && WritePadding(file, mySections[i].mySize);
+    }
+    succeeded = fclose(file) == 0 && succeeded;
+
+    if (!succeeded || rename(tempPath, aPath) != 0)
+    {
+        remove(tempPath);
+        return false;
+    }
+
+    return true;
+}
+
+SnapshotReader::SnapshotReader()
+    : myTable(nullptr)
+    , mySectionCount(0U)
+{
+}
+
+bool SnapshotReader::Open(const char* const aPath)
+{
+    Close();
+
+    if (!myFile.Open(aPath) || myFile.Size() < sizeof(SnapshotHeader))
+    {
+        Close();
+        return false;
+    }
+
+    SnapshotHeader header;
+    memcpy(&header, myFile.Data(), sizeof(header));
+
+    const uint64_t tableEnd = sizeof(SnapshotHeader) + (uint64_t)sizeof(SnapshotSectionEntry) * header.mySectionCount;
+    if (header.myMagic != SNAPSHOT_MAGIC || header.myVersion != SNAPSHOT_VERSION || header.myMaxEntities != MAX_ENTITIES
+        || header.mySectionCount > MAX_SNAPSHOT_SECTIONS || header.myFileSize != myFile.Size() || tableEnd > myFile.Size())
+    {
+        Close();
+        return false;
+    }
+
+    myTable = (const SnapshotSectionEntry*)(myFile.Data() + sizeof(SnapshotHeader));
+    mySectionCount = header.mySectionCount;
+
+    for (uint32_t i = 0U; i < mySectionCount; ++i)
+    {
+        const SnapshotSectionEntry& entry = myTable[i];
+        const bool inBounds = entry.myOffset >= tableEnd && entry.myOffset <= myFile.Size() && entry.mySize <= myFile.Size() - entry.myOffset;
+        if (!inBounds || entry.myOffset % SNAPSHOT_ALIGNMENT != 0U
+            || HashMemory(myFile.Data() + entry.myOffset, (size_t)entry.mySize) != entry.myHash)
+        {
+            Close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void SnapshotReader::Close()
+{
+    myFile.Close();
+    myTable = nullptr;
+    mySectionCount = 0U;
+}
+
+const void* SnapshotReader::Find(uint32_t anOwner, uint32_t aField, uint64_t aSize) const
+{
+    const uint32_t tag = MakeTag(anOwner, aField);
+    for (uint32_t i = 0U; i < mySectionCount; ++i)
+    {
+        if (myTable[i].myTag == tag)
+        {
+            return myTable[i].mySize == aSize ? myFile.Data() + myTable[i].myOffset : nullptr;
+        }
+    }
+
+    return nullptr;
+}
+
+bool SnapshotReader::Section(uint32_t anOwner, uint32_t aField, void* aData, uint64_t aSize) const
+{
+    const void* payload = Find(anOwner, aField, aSize);
+    if (!payload)
+    {
+        return false;
+    }
+
+    memcpy(aData, payload, (size_t)aSize);
+    return true;
+}
@@ -0,0 +1,77 @@
+#if !defined(SNAPSHOT_H_)
+#define SNAPSHOT_H_
+
+#pragma once
+
+#include <stdint.h>
+
+#include "../Utils/MappedFile.h"
+
+/*
+* Binary world snapshots: a header, a section table, then the raw section
+* payloads, each aligned to SNAPSHOT_ALIGNMENT so a mapped file can be read in
+* place. Sections are found by (owner, field) tag and must have exactly the
+* size the reader asks for, so a layout change is rejected instead of misread.
+*
+* SnapshotWriter::Section and SnapshotReader::Section share a signature, so a
+* single Serialize(Archive&) template per class handles both directions.
+*/
+constexpr uint32_t SNAPSHOT_ALIGNMENT = 64U;
+constexpr uint32_t MAX_SNAPSHOT_SECTIONS = 64U;
+
+struct SnapshotSectionEntry
+{
+    uint32_t myTag;
+    uint32_t myReserved;
+    uint64_t myOffset;
+    uint64_t mySize;
+    uint64_t myHash;
+};
+
+class SnapshotWriter
+{
+public:
+    static constexpr bool IS_LOADING = false;
+
+    SnapshotWriter();
+
+    /* Queues a section. aData is not copied and has to stay valid until Save(). */
+    bool Section(uint32_t anOwner, uint32_t aField, const void* aData, uint64_t aSize);
+    bool Save(const char* const aPath) const;
+
+private:
+    struct PendingSection
+    {
+        uint32_t myTag;
+        const void* myData;
+        uint64_t mySize;
+    };
+
+    PendingSection mySections[MAX_SNAPSHOT_SECTIONS];
+    uint32_t mySectionCount;
+    bool myOverflowed;
+};
+
+class SnapshotReader
+{
+public:
+    static constexpr bool IS_LOADING = true;
+
+    SnapshotReader();
+
+    /* Maps the file and validates the header, section table and section hashes. */
+    bool Open(const char* const aPath);
+    void Close();
+
+    /* The mapped payload of a section with exactly aSize bytes, or nullptr. */
+    const void* Find(uint32_t anOwner, uint32_t aField, uint64_t aSize) const;
+    /* Copies a section into aData. Fails if it is missing or has another size. */
+    bool Section(uint32_t anOwner, uint32_t aField, void* aData, uint64_t aSize) const;
+
+private:
+    MappedFile myFile;
+    const SnapshotSectionEntry* myTable;
+    uint32_t mySectionCount;
+};
+
+#endif // SNAPSHOT_H_
@@ -0,0 +1,55 @@
+#include "SortSystem.h"
+
+#include "../Utils/Profiler.h"
+
+extern "C"
+{
+#include "../raylib/raymath.h"
+}
+
+#include <math.h>
+#include <stdint.h>
+
+/* Spreads the low 10 bits of aValue out to every third bit. */
+static uint32_t SpreadBits(uint32_t aValue)
+{
+    aValue &= 0x000003FFU;
+    aValue = (aValue | (aValue << 16U)) & 0x030000FFU;
+    aValue = (aValue | (aValue << 8U)) & 0x0300F00FU;
+    aValue = (aValue | (aValue << 4U)) & 0x030C30C3U;
+    aValue = (aValue | (aValue << 2U)) & 0x09249249U;
+    return aValue;
+}
+
+static uint32_t Quantize(float aValue, float aMin, float aScale)
+{
+    return (uint32_t)Clamp((aValue - aMin) * aScale, 0.f, 1023.f);
+}
+
+void Systems::ComputeMortonKeys(ComponentList<TransformComponent>* someTransformComps, Vector3 aMin, Vector3 aMax, uint32_t* someKeysOut)
+{
+    PROFILE_ZONE("Systems::ComputeMortonKeys");
+
+    for (uint32_t entity = 0U; entity < MAX_ENTITIES; ++entity)
+    {
+        someKeysOut[entity] = UINT32_MAX;
+    }
+
+    const Vector3 scale = {
+        1023.f / fmaxf(aMax.x - aMin.x, 1e-6f),
+        1023.f / fmaxf(aMax.y - aMin.y, 1e-6f),
+        1023.f / fmaxf(aMax.z - aMin.z, 1e-6f),
+    };
+
+    const TransformComponent* transforms = someTransformComps->GetDenseComponents();
+    const uint32_t count = someTransformComps->GetSize();
+    for (uint32_t compIndex = 0U; compIndex < count; ++compIndex)
+    {
+        const Vector3& pos = transforms[compIndex].myPosition;
+        const uint32_t x = Quantize(pos.x, aMin.x, scale.x);
+        const uint32_t y = Quantize(pos.y, aMin.y, scale.y);
+        const uint32_t z = Quantize(pos.z, aMin.z, scale.z);
+
+        someKeysOut[someTransformComps->GetEntityFromComponent(compIndex)] = SpreadBits(x) | (SpreadBits(y) << 1U) | (SpreadBits(z) << 2U);
+    }
+}
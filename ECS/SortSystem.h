@@ -0,0 +1,20 @@
+#if !defined(SORTSYSTEM_H_)
+#define SORTSYSTEM_H_
+
+#pragma once
+
+#include "ComponentList.h"
+#include "Components.h"
+
+namespace Systems
+{
+    /*
+    * Writes a Morton (Z-order) code of every entity's position inside the box
+    * aMin..aMax to someKeysOut[entity], 10 bits per axis, for ComponentList::SortStep().
+    * Entities close in space get close codes. Entities without a transform get
+    * UINT32_MAX so they sort last. someKeysOut holds MAX_ENTITIES keys.
+    */
+    void ComputeMortonKeys(ComponentList<TransformComponent>* someTransformComps, Vector3 aMin, Vector3 aMax, uint32_t* someKeysOut);
+}
+
+#endif // SORTSYSTEM_H_
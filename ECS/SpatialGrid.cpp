@@ -0,0 +1,304 @@
+#include "SpatialGrid.h"
+
+#include "../Utils/Profiler.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+    constexpr uint32_t GRID_BATCH_SIZE = 256U;
+
+    struct Neighbour
+    {
+        float myDistanceSquared;
+        Entity myEntity;
+    };
+
+    float DistanceSquared(Vector3 a, Vector3 b)
+    {
+        const float dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    /* Max-heap on distance, so the farthest of the current k candidates sits at the root. */
+    void SiftDown(Neighbour* aHeap, uint32_t aSize, uint32_t anIndex)
+    {
+        while (true)
+        {
+            uint32_t largest = anIndex;
+            const uint32_t left = anIndex * 2 + 1, right = anIndex * 2 + 2;
+            if (left < aSize && aHeap[left].myDistanceSquared > aHeap[largest].myDistanceSquared) largest = left;
+            if (right < aSize && aHeap[right].myDistanceSquared > aHeap[largest].myDistanceSquared) largest = right;
+            if (largest == anIndex) return;
+
+            const Neighbour swap = aHeap[anIndex];
+            aHeap[anIndex] = aHeap[largest];
+            aHeap[largest] = swap;
+            anIndex = largest;
+        }
+    }
+
+    void SiftUp(Neighbour* aHeap, uint32_t anIndex)
+    {
+        while (anIndex > 0)
+        {
+            const uint32_t parent = (anIndex - 1) / 2;
+            if (aHeap[parent].myDistanceSquared >= aHeap[anIndex].myDistanceSquared) return;
+
+            const Neighbour swap = aHeap[anIndex];
+            aHeap[anIndex] = aHeap[parent];
+            aHeap[parent] = swap;
+            anIndex = parent;
+        }
+    }
+}
+
+SpatialGrid::SpatialGrid()
+    : myMin{ 0.f, 0.f, 0.f }
+    , myCellSize(1.f)
+    , myInverseCellSize(1.f)
+    , myDimensions{ 0, 0, 0 }
+    , myCellCount(0U)
+    , myCellStart(nullptr)
+    , myEntryCount(0U)
+{
+}
+
+SpatialGrid::~SpatialGrid()
+{
+    free(myCellStart);
+}
+
+void SpatialGrid::Init(Vector3 aMin, Vector3 aMax, float aCellSize)
+{
+    assert(aCellSize > 0.f && "Cell size has to be positive.");
+
+    myMin = aMin;
+    myCellSize = aCellSize;
+    myInverseCellSize = 1.f / aCellSize;
+    myDimensions[0] = (int32_t)ceilf((aMax.x - aMin.x) * myInverseCellSize);
+    myDimensions[1] = (int32_t)ceilf((aMax.y - aMin.y) * myInverseCellSize);
+    myDimensions[2] = (int32_t)ceilf((aMax.z - aMin.z) * myInverseCellSize);
+    for (int32_t& dimension : myDimensions)
+    {
+        dimension = dimension > 0 ? dimension : 1;
+    }
+    myCellCount = (uint32_t)(myDimensions[0] * myDimensions[1] * myDimensions[2]);
+
+    free(myCellStart);
+    myCellStart = (uint32_t*)calloc(myCellCount + 1, sizeof(uint32_t));
+    myEntryCount = 0U;
+}
+
+void SpatialGrid::Build(ComponentList<TransformComponent>* someTransformComps, JobSystem* aJobSystem)
+{
+    PROFILE_ZONE("SpatialGrid::Build");
+
+    const TransformComponent* transforms = someTransformComps->GetDenseComponents();
+    myEntryCount = someTransformComps->GetSize();
+
+    /* Cell keys in parallel, then a counting sort; serial so the order inside a cell is stable. */
+    aJobSystem->ParallelFor(myEntryCount, GRID_BATCH_SIZE, [&](uint32_t aBegin, uint32_t anEnd)
+    {
+        for (uint32_t i = aBegin; i < anEnd; ++i)
+        {
+            int32_t coords[3];
+            CellCoords(transforms[i].myPosition, coords);
+            myEntryCells[i] = CellIndex(coords[0], coords[1], coords[2]);
+            myUnsortedEntries[i] = { transforms[i].myPosition, someTransformComps->GetEntityFromComponent(i) };
+        }
+    });
+
+    memset(myCellStart, 0, sizeof(uint32_t) * (myCellCount + 1));
+    for (uint32_t i = 0U; i < myEntryCount; ++i)
+    {
+        ++myCellStart[myEntryCells[i]];
+    }
+    for (uint32_t cell = 1U; cell < myCellCount; ++cell)
+    {
+        myCellStart[cell] += myCellStart[cell - 1];
+    }
+
+    /* Each cell's end is its cursor; filling back to front leaves it at the cell's start. */
+    for (uint32_t i = myEntryCount; i > 0U; --i)
+    {
+        myEntries[--myCellStart[myEntryCells[i - 1]]] = myUnsortedEntries[i - 1];
+    }
+    myCellStart[myCellCount] = myEntryCount;
+}
+
+uint32_t SpatialGrid::QueryRadius(Vector3 aCenter, float aRadius, Entity* someEntitiesOut, uint32_t aMaxCount) const
+{
+    int32_t low[3], high[3];
+    CellCoords({ aCenter.x - aRadius, aCenter.y - aRadius, aCenter.z - aRadius }, low);
+    CellCoords({ aCenter.x + aRadius, aCenter.y + aRadius, aCenter.z + aRadius }, high);
+
+    const float radiusSquared = aRadius * aRadius;
+    uint32_t found = 0U;
+
+    for (int32_t z = low[2]; z <= high[2]; ++z)
+    {
+        for (int32_t y = low[1]; y <= high[1]; ++y)
+        {
+            for (int32_t x = low[0]; x <= high[0]; ++x)
+            {
+                const uint32_t cell = CellIndex(x, y, z);
+                for (uint32_t i = myCellStart[cell]; i < myCellStart[cell + 1]; ++i)
+                {
+                    if (DistanceSquared(myEntries[i].myPosition, aCenter) <= radiusSquared)
+                    {
+                        if (found < aMaxCount) someEntitiesOut[found] = myEntries[i].myEntity;
+                        ++found;
+                    }
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+uint32_t SpatialGrid::QueryAABB(Vector3 aMin, Vector3 aMax, Entity* someEntitiesOut, uint32_t aMaxCount) const
+{
+    int32_t low[3], high[3];
+    CellCoords(aMin, low);
+    CellCoords(aMax, high);
+
+    uint32_t found = 0U;
+
+    for (int32_t z = low[2]; z <= high[2]; ++z)
+    {
+        for (int32_t y = low[1]; y <= high[1]; ++y)
+        {
+            for (int32_t x = low[0]; x <= high[0]; ++x)
+            {
+                const uint32_t cell = CellIndex(x, y, z);
+                for (uint32_t i = myCellStart[cell]; i < myCellStart[cell + 1]; ++i)
+                {
+                    const Vector3& p = myEntries[i].myPosition;
+                    if (p.x >= aMin.x && p.y >= aMin.y && p.z >= aMin.z && p.x <= aMax.x && p.y <= aMax.y && p.z <= aMax.z)
+                    {
+                        if (found < aMaxCount) someEntitiesOut[found] = myEntries[i].myEntity;
+                        ++found;
+                    }
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+uint32_t SpatialGrid::QueryNearest(Vector3 aPoint, uint32_t aCount, Entity* someEntitiesOut) const
+{
+    aCount = aCount < myEntryCount ? aCount : myEntryCount;
+    if (aCount == 0U)
+    {
+        return 0U;
+    }
+
+    Neighbour heap[MAX_ENTITIES];
+    uint32_t heapSize = 0U;
+
+    int32_t center[3];
+    CellCoords(aPoint, center);
+
+    int32_t maxRing = 0;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const int32_t reach = center[axis] > myDimensions[axis] - 1 - center[axis] ? center[axis] : myDimensions[axis] - 1 - center[axis];
+        maxRing = reach > maxRing ? reach : maxRing;
+    }
+
+    /* Visit shells of cells at growing Chebyshev distance until no unvisited cell can be closer. */
+    for (int32_t ring = 0; ring <= maxRing; ++ring)
+    {
+        for (int32_t z = center[2] - ring; z <= center[2] + ring; ++z)
+        {
+            if (z < 0 || z >= myDimensions[2]) continue;
+            for (int32_t y = center[1] - ring; y <= center[1] + ring; ++y)
+            {
+                if (y < 0 || y >= myDimensions[1]) continue;
+                const bool onShellYZ = z == center[2] - ring || z == center[2] + ring || y == center[1] - ring || y == center[1] + ring;
+                const int32_t step = onShellYZ || ring == 0 ? 1 : ring * 2;
+
+                for (int32_t x = center[0] - ring; x <= center[0] + ring; x += step)
+                {
+                    if (x < 0 || x >= myDimensions[0]) continue;
+
+                    const uint32_t cell = CellIndex(x, y, z);
+                    for (uint32_t i = myCellStart[cell]; i < myCellStart[cell + 1]; ++i)
+                    {
+                        const Neighbour candidate = { DistanceSquared(myEntries[i].myPosition, aPoint), myEntries[i].myEntity };
+                        if (heapSize < aCount)
+                        {
+                            heap[heapSize] = candidate;
+                            SiftUp(heap, heapSize++);
+                        }
+                        else if (candidate.myDistanceSquared < heap[0].myDistanceSquared)
+                        {
+                            heap[0] = candidate;
+                            SiftDown(heap, heapSize, 0);
+                        }
+                    }
+                }
+            }
+        }
+
+        /* Cells in the next shell are at least ring * cell size away from any point in the center cell. */
+        const float shellDistance = ring * myCellSize;
+        if (heapSize == aCount && heap[0].myDistanceSquared <= shellDistance * shellDistance)
+        {
+            break;
+        }
+    }
+
+    /* Pop the heap back to front to get the entities sorted closest first. */
+    for (uint32_t i = heapSize; i > 0U; --i)
+    {
+        someEntitiesOut[i - 1] = heap[0].myEntity;
+        heap[0] = heap[i - 1];
+        SiftDown(heap, i - 1, 0);
+    }
+
+    return heapSize;
+}
+
+const SpatialGrid::Entry* SpatialGrid::GetEntries() const
+{
+    return myEntries;
+}
+
+uint32_t SpatialGrid::GetEntryCount() const
+{
+    return myEntryCount;
+}
+
+float SpatialGrid::GetCellSize() const
+{
+    return myCellSize;
+}
+
+void SpatialGrid::CellCoords(Vector3 aPosition, int32_t aCoordsOut[3]) const
+{
+    const float local[3] = {
+        (aPosition.x - myMin.x) * myInverseCellSize,
+        (aPosition.y - myMin.y) * myInverseCellSize,
+        (aPosition.z - myMin.z) * myInverseCellSize,
+    };
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        int32_t coord = (int32_t)floorf(local[axis]);
+        coord = coord < 0 ? 0 : coord;
+        coord = coord >= myDimensions[axis] ? myDimensions[axis] - 1 : coord;
+        aCoordsOut[axis] = coord;
+    }
+}
+
+uint32_t SpatialGrid::CellIndex(int32_t aX, int32_t aY, int32_t aZ) const
+{
+    return (uint32_t)(aX + myDimensions[0] * (aY + myDimensions[1] * aZ));
+}
\ No newline at end of file
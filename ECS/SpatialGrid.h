@@ -0,0 +1,163 @@
+#if !defined(SPATIALGRID_H_)
+#define SPATIALGRID_H_
+
+#pragma once
+
+#include "ComponentList.h"
+#include "Components.h"
+
+#include "../Utils/JobSystem.h"
+
+/*
+* Uniform grid over TransformComponent positions. Build() re-buckets them with
+* a counting sort so each cell's entities are contiguous in memory, and has to
+* run again once the positions change. Positions outside the grid bounds are
+* clamped into the border cells.
+*/
+class SpatialGrid
+{
+public:
+    struct Entry
+    {
+        Vector3 myPosition;
+        Entity myEntity;
+    };
+
+    SpatialGrid();
+    ~SpatialGrid();
+
+    SpatialGrid(const SpatialGrid&) = delete;
+    SpatialGrid& operator=(const SpatialGrid&) = delete;
+
+    void Init(Vector3 aMin, Vector3 aMax, float aCellSize);
+    void Build(ComponentList<TransformComponent>* someTransformComps, JobSystem* aJobSystem);
+
+    /* Queries write up to aMaxCount entities and return how many were found in total. */
+    uint32_t QueryRadius(Vector3 aCenter, float aRadius, Entity* someEntitiesOut, uint32_t aMaxCount) const;
+    uint32_t QueryAABB(Vector3 aMin, Vector3 aMax, Entity* someEntitiesOut, uint32_t aMaxCount) const;
+    /* Writes the aCount nearest entities, closest first. Returns how many were written. */
+    uint32_t QueryNearest(Vector3 aPoint, uint32_t aCount, Entity* someEntitiesOut) const;
+
+    /*
+    * Calls aCallback(const Entry&, const Entry&) once for every pair of entities
+    * closer than aMaxDistance. aMaxDistance must not exceed the cell size.
+    */
+    template <class Callback>
+    void ForEachPair(float aMaxDistance, const Callback& aCallback) const;
+    /* Same, split over cells on the job system. aCallback must be safe to call concurrently. */
+    template <class Callback>
+    void ForEachPairParallel(float aMaxDistance, JobSystem* aJobSystem, const Callback& aCallback) const;
+
+    const Entry* GetEntries() const;
+    uint32_t GetEntryCount() const;
+    float GetCellSize() const;
+
+private:
+    template <class Callback>
+    void VisitCellPairs(uint32_t aCell, float aMaxDistanceSquared, const Callback& aCallback) const;
+
+    void CellCoords(Vector3 aPosition, int32_t aCoordsOut[3]) const;
+    uint32_t CellIndex(int32_t aX, int32_t aY, int32_t aZ) const;
+
+    Vector3 myMin;
+    float myCellSize;
+    float myInverseCellSize;
+    int32_t myDimensions[3];
+    uint32_t myCellCount;
+
+    /* myEntries[myCellStart[c] .. myCellStart[c + 1]) are the entities in cell c. */
+    uint32_t* myCellStart;
+    Entry myEntries[MAX_ENTITIES];
+    Entry myUnsortedEntries[MAX_ENTITIES];
+    uint32_t myEntryCells[MAX_ENTITIES];
+    uint32_t myEntryCount;
+};
+
+template <class Callback>
+inline void SpatialGrid::VisitCellPairs(uint32_t aCell, float aMaxDistanceSquared, const Callback& aCallback) const
+{
+    /* The cell itself plus the 13 "forward" neighbours, so every pair is visited exactly once. */
+    static const int32_t ourForwardOffsets[13][3] = {
+        { 1, 0, 0 }, { -1, 1, 0 }, { 0, 1, 0 }, { 1, 1, 0 },
+        { -1, -1, 1 }, { 0, -1, 1 }, { 1, -1, 1 },
+        { -1, 0, 1 }, { 0, 0, 1 }, { 1, 0, 1 },
+        { -1, 1, 1 }, { 0, 1, 1 }, { 1, 1, 1 },
+    };
+
+    const uint32_t begin = myCellStart[aCell];
+    const uint32_t end = myCellStart[aCell + 1];
+    if (begin == end)
+    {
+        return;
+    }
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        for (uint32_t j = i + 1; j < end; ++j)
+        {
+            const float dx = myEntries[i].myPosition.x - myEntries[j].myPosition.x;
+            const float dy = myEntries[i].myPosition.y - myEntries[j].myPosition.y;
+            const float dz = myEntries[i].myPosition.z - myEntries[j].myPosition.z;
+            if (dx * dx + dy * dy + dz * dz < aMaxDistanceSquared)
+            {
+                aCallback(myEntries[i], myEntries[j]);
+            }
+        }
+    }
+
+    const int32_t x = (int32_t)(aCell % (uint32_t)myDimensions[0]);
+    const int32_t y = (int32_t)((aCell / (uint32_t)myDimensions[0]) % (uint32_t)myDimensions[1]);
+    const int32_t z = (int32_t)(aCell / ((uint32_t)myDimensions[0] * (uint32_t)myDimensions[1]));
+
+    for (const int32_t* offset : ourForwardOffsets)
+    {
+        const int32_t nx = x + offset[0], ny = y + offset[1], nz = z + offset[2];
+        if (nx < 0 || ny < 0 || nz < 0 || nx >= myDimensions[0] || ny >= myDimensions[1] || nz >= myDimensions[2])
+        {
+            continue;
+        }
+
+        const uint32_t neighbour = CellIndex(nx, ny, nz);
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            for (uint32_t j = myCellStart[neighbour]; j < myCellStart[neighbour + 1]; ++j)
+            {
+                const float dx = myEntries[i].myPosition.x - myEntries[j].myPosition.x;
+                const float dy = myEntries[i].myPosition.y - myEntries[j].myPosition.y;
+                const float dz = myEntries[i].myPosition.z - myEntries[j].myPosition.z;
+                if (dx * dx + dy * dy + dz * dz < aMaxDistanceSquared)
+                {
+                    aCallback(myEntries[i], myEntries[j]);
+                }
+            }
+        }
+    }
+}
+
+template <class Callback>
+inline void SpatialGrid::ForEachPair(float aMaxDistance, const Callback& aCallback) const
+{
+    assert(aMaxDistance <= myCellSize && "Pair distance has to fit inside one cell.");
+
+    for (uint32_t cell = 0U; cell < myCellCount; ++cell)
+    {
+        VisitCellPairs(cell, aMaxDistance * aMaxDistance, aCallback);
+    }
+}
+
+template <class Callback>
+inline void SpatialGrid::ForEachPairParallel(float aMaxDistance, JobSystem* aJobSystem, const Callback& aCallback) const
+{
+    assert(aMaxDistance <= myCellSize && "Pair distance has to fit inside one cell.");
+
+    const float maxDistanceSquared = aMaxDistance * aMaxDistance;
+    aJobSystem->ParallelFor(myCellCount, 256U, [&](uint32_t aBegin, uint32_t anEnd)
+    {
+        for (uint32_t cell = aBegin; cell < anEnd; ++cell)
+        {
+            VisitCellPairs(cell, maxDistanceSquared, aCallback);
+        }
+    });
+}
+
+#endif // SPATIALGRID_H_
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 
 extern "C"
 {
@@ -13,100 +14,621 @@ extern "C"
 #include "../ECS/ComponentList.h"
 #include "../ECS/Components.h"
 
+#include "../ECS/CollisionSystem.h"
+#include "../ECS/CullingSystem.h"
 #include "../ECS/MovementSystem.h"
 #include "../ECS/RenderSystem.h"
+#include "../ECS/Snapshot.h"
+#include "../ECS/SortSystem.h"
+#include "../ECS/RenderBackend.h"
+#include "../ECS/RenderCommandList.h"
 
+#include "../Utils/JobSystem.h"
+#include "../Utils/PerfCounters.h"
+#include "../Utils/Profiler.h"
+#include "../Utils/Random.h"
+
+#include "Misc.h"
 #include "ModelManager.h"
+#include "Replication.h"
+
+/* Time each frame may spend uploading streamed-in models to the GPU. */
+constexpr double MODEL_UPLOAD_BUDGET_SECONDS = 0.002;
+/* Idle models are unloaded once loaded ones take more than this. */
+constexpr uint64_t MODEL_MEMORY_BUDGET_BYTES = 256ULL * 1024ULL * 1024ULL;
+
+/* Matches raylib's default projection clip planes. */
+constexpr float CAMERA_NEAR = 0.01f;
+constexpr float CAMERA_FAR = 1000.0f;
 
+/* The box MovementUpdate keeps entities inside. */
+constexpr Vector3 WORLD_MIN = { -25.f, 0.f, -25.f };
+constexpr Vector3 WORLD_MAX = { 25.f, 50.f, 25.f };
 
+/*
+* Components moved back into spatial order per list and tick. Churn and
+* movement undo the order slowly, so a small budget keeps up.
+*/
+constexpr uint32_t COMPONENT_SORT_SWAPS_PER_TICK = 256U;
 
-struct GameState
+/* Snapshot section owners. Append new ones, never renumber. */
+enum SnapshotOwner : uint32_t
+{
+    SnapshotOwner_Game,
+    SnapshotOwner_Entities,
+    SnapshotOwner_Transforms,
+    SnapshotOwner_Movements,
+    SnapshotOwner_Models,
+};
+
+/* ModelIDs only live for one run, so snapshots carry the path of every ID they use. */
+struct SnapshotModel
+{
+    ModelID myId;
+    char myPath[32];
+};
+
+/* Paths AddEntities() picks from, in the order of World::mySpawnModels. */
+constexpr const char* SPAWN_MODEL_PATHS[] = { "assets/banana.obj", "assets/donut.obj" };
+constexpr uint32_t SPAWN_MODEL_COUNT = sizeof(SPAWN_MODEL_PATHS) / sizeof(SPAWN_MODEL_PATHS[0]);
+
+struct Game::World
 {
     EntityService myEntityService;
 
     ComponentList<TransformComponent> myTransformComponents;
     ComponentList<MovementComponent> myMovementComponents;
     ComponentList<ModelComponent> myModelComponents;
+    /* Kept up to date by the lists as components come and go; declared after them so it is destroyed first. */
+    DrawableQuery myDrawables{ myTransformComponents, myModelComponents };
 
     Entity mySpawnedEntities[MAX_ENTITIES];
     Entity mySpawnedEntitiesCount;
-} gGameState;
 
+    /* Morton code of each entity's position, see SortComponents(). */
+    uint32_t mySortKeys[MAX_ENTITIES];
+    CollisionState myCollisionState;
+    /* Only one thread may issue work to a job system at a time, so worlds that tick in parallel each need their own. */
+    JobSystem myJobSystem;
+
+    /* Stamped on every component change; bumped each time a delta is encoded. */
+    uint32_t myVersion;
+
+    Game::WorldSettings mySettings;
+    /* All simulation randomness goes through here, never through raylib's GetRandomValue(). */
+    Random myRandom;
+    uint32_t myTickCount;
+    uint64_t myChecksum;
+
+    /* The model each entity holds a ModelManager reference to, kept by the model list observer. */
+    ModelID myReferencedModels[MAX_ENTITIES];
+    int myModelObserver;
+    /* Referenced for the world's lifetime, so eviction cannot take them away while no entity uses them. */
+    ModelID mySpawnModels[SPAWN_MODEL_COUNT];
+
+#if defined(GAME_REPLICATION_LOOPBACK)
+    /* Rebuilt from a delta every tick to exercise the replication path end to end. */
+    Replication::Replica myLoopbackReplica;
+    ByteWriter myLoopbackBuffer;
+#endif
+};
+
+Game::Settings gSettings;
+RaylibRenderBackend gRenderBackend;
+/* Scratch for Draw(), which only runs on the main thread. */
+VisibleSet gVisibleModels;
+RenderCommandList gRenderCommands;
+/* Mixed into the seed of non-deterministic worlds, so worlds created within the same second differ. */
+uint64_t gCreatedWorldCount;
+
+static void SetChangeVersion(Game::World* aWorld, uint32_t aVersion)
+{
+    aWorld->myVersion = aVersion;
+    aWorld->myTransformComponents.SetChangeVersion(aVersion);
+    aWorld->myMovementComponents.SetChangeVersion(aVersion);
+    aWorld->myModelComponents.SetChangeVersion(aVersion);
+}
+
+/*
+* Visits entities in ID order rather than dense order, so two worlds with the
+* same contents match however their component arrays happen to be laid out.
+*/
+static uint64_t ComputeChecksum(Game::World* aWorld)
+{
+    PROFILE_ZONE("Game::ComputeChecksum");
+
+    /* Only four-byte fields, so there is no padding to leak into the hash. */
+    struct EntityRecord
+    {
+        Entity myEntity;
+        uint32_t myComponentMask;
+        TransformComponent myTransform;
+        MovementComponent myMovement;
+        ModelComponent myModel;
+    };
+
+    constexpr uint64_t multiplier = 0x9E3779B97F4A7C15ULL;
+    uint64_t checksum = HashMemory(aWorld->myRandom.GetState(), sizeof(uint32_t) * 4U) ^ aWorld->myTickCount;
 
+    for (Entity e = 0U; e < MAX_ENTITIES; ++e)
+    {
+        EntityRecord record = {};
+        record.myEntity = e;
+
+        if (aWorld->myTransformComponents.HasComponent(e))
+        {
+            record.myComponentMask |= 1U << 0;
+            record.myTransform = aWorld->myTransformComponents.GetComponent(e);
+        }
+        if (aWorld->myMovementComponents.HasComponent(e))
+        {
+            record.myComponentMask |= 1U << 1;
+            record.myMovement = aWorld->myMovementComponents.GetComponent(e);
+        }
+        if (aWorld->myModelComponents.HasComponent(e))
+        {
+            record.myComponentMask |= 1U << 2;
+            record.myModel = aWorld->myModelComponents.GetComponent(e);
+        }
+
+        if (record.myComponentMask != 0U)
+        {
+            checksum = (checksum ^ HashMemory(&record, sizeof(record))) * multiplier;
+        }
+    }
+
+    return checksum;
+}
 
-void Game::Init()
+static void OnModelsAdded(ComponentList<ModelComponent>& aList, const Entity* someEntities, uint32_t aCount, void* someUserData)
 {
-    gGameState.mySpawnedEntitiesCount = 0;
+    Game::World* world = (Game::World*)someUserData;
 
-    ModelManager::Preload("assets/banana.obj");
-    ModelManager::Preload("assets/donut.obj");
+    for (uint32_t i = 0U; i < aCount; ++i)
+    {
+        const ModelID model = aList.GetComponent(someEntities[i]).myModel;
+        world->myReferencedModels[someEntities[i]] = model;
+        ModelManager::AddRef(model);
+    }
+}
+
+static void OnModelsRemoved(ComponentList<ModelComponent>&, const Entity* someEntities, uint32_t aCount, void* someUserData)
+{
+    const Game::World* world = (const Game::World*)someUserData;
 
-    AddEntities(1);
+    for (uint32_t i = 0U; i < aCount; ++i)
+    {
+        ModelManager::Release(world->myReferencedModels[someEntities[i]]);
+    }
 }
 
-void Game::Update()
+static void OnModelsChanged(ComponentList<ModelComponent>& aList, const Entity* someEntities, uint32_t aCount, void* someUserData)
 {
-    Systems::MovementUpdate(&gGameState.myTransformComponents, &gGameState.myMovementComponents);
-    Systems::Render(&gGameState.myTransformComponents, &gGameState.myModelComponents);
+    Game::World* world = (Game::World*)someUserData;
+
+    for (uint32_t i = 0U; i < aCount; ++i)
+    {
+        const ModelID model = aList.GetComponent(someEntities[i]).myModel;
+        ModelID& referenced = world->myReferencedModels[someEntities[i]];
+        if (model != referenced)
+        {
+            ModelManager::AddRef(model);
+            ModelManager::Release(referenced);
+            referenced = model;
+        }
+    }
+}
+
+/* Whether every entity in someEntities is also in someOthers. */
+static bool IsSubset(const BitArray<MAX_ENTITIES>& someEntities, const BitArray<MAX_ENTITIES>& someOthers)
+{
+    for (size_t e = someEntities.FindNext(0U); e < MAX_ENTITIES; e = someEntities.FindNext(e + 1U))
+    {
+        if (!someOthers.Test(e))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+* The lists check themselves while loading; this checks what the game assumes
+* across them: components only on live entities, every mover and model also
+* placed, and every spawned entity live, listed once and holding all three.
+*/
+static bool IsLoadedWorldConsistent(Game::World* aWorld)
+{
+    const BitArray<MAX_ENTITIES> occupied = aWorld->myEntityService.GetOccupiedEntities();
+    const BitArray<MAX_ENTITIES>& transforms = aWorld->myTransformComponents.GetEntitiesContainingComponent();
+    const BitArray<MAX_ENTITIES>& movements = aWorld->myMovementComponents.GetEntitiesContainingComponent();
+    const BitArray<MAX_ENTITIES>& models = aWorld->myModelComponents.GetEntitiesContainingComponent();
+
+    if (!IsSubset(transforms, occupied) || !IsSubset(movements, transforms) || !IsSubset(models, transforms))
+    {
+        return false;
+    }
+
+    BitArray<MAX_ENTITIES> spawned;
+    for (uint32_t i = 0U; i < aWorld->mySpawnedEntitiesCount; ++i)
+    {
+        const Entity e = aWorld->mySpawnedEntities[i];
+        if (e >= MAX_ENTITIES || spawned.Test(e) || !transforms.Test(e) || !movements.Test(e) || !models.Test(e))
+        {
+            return false;
+        }
+        spawned.Set(e);
+    }
+
+    return true;
+}
+
+void Game::Init(const Settings& someSettings)
+{
+    gSettings = someSettings;
+
+    ModelManager::Init();
+
+    /*
+    * After the model loader threads start, so parsing stays out of the system
+    * totals, but before any world starts its job system, so the workers
+    * inherit the counters.
+    */
+    if (someSettings.myUseHardwareCounters)
+    {
+        PerfCounters::Init();
+    }
+
+    ModelManager::SetMemoryBudget(MODEL_MEMORY_BUDGET_BYTES);
+    gRenderBackend.Init();
+
+    for (const char* path : SPAWN_MODEL_PATHS)
+    {
+        ModelManager::Preload(path);
+    }
 }
 
 void Game::Terminate()
 {
+    PerfCounters::WriteReport(stdout);
+    PerfCounters::Terminate();
+
+    gRenderBackend.Terminate();
     ModelManager::Terminate();
 }
 
-void Game::AddEntities(uint32_t aCount)
+Game::World* Game::CreateWorld(const WorldSettings& someSettings)
+{
+    World* world = new World();
+
+    world->mySpawnedEntitiesCount = 0;
+    world->mySettings = someSettings;
+    world->myRandom.Seed(someSettings.myIsDeterministic ? someSettings.mySeed : (uint64_t)time(nullptr) + gCreatedWorldCount * 0x9E3779B97F4A7C15ULL);
+    world->myTickCount = 0U;
+    ++gCreatedWorldCount;
+    SetChangeVersion(world, 1U);
+
+    world->myJobSystem.Init(someSettings.myWorkerCount);
+
+    for (uint32_t i = 0U; i < SPAWN_MODEL_COUNT; ++i)
+    {
+        world->mySpawnModels[i] = ModelManager::GetModelID(SPAWN_MODEL_PATHS[i]);
+        ModelManager::AddRef(world->mySpawnModels[i]);
+    }
+
+    ComponentList<ModelComponent>::Observer modelObserver;
+    modelObserver.myOnAdd = OnModelsAdded;
+    modelObserver.myOnRemove = OnModelsRemoved;
+    modelObserver.myOnChange = OnModelsChanged;
+    modelObserver.myUserData = world;
+    world->myModelObserver = world->myModelComponents.AddObserver(modelObserver);
+
+    /* Collision reads model bounds, so they may not change with load timing once ticking starts. */
+    if (someSettings.myIsDeterministic)
+    {
+        ModelManager::Flush();
+    }
+
+    AddEntities(world, 1);
+    world->myChecksum = ComputeChecksum(world);
+
+    return world;
+}
+
+void Game::DestroyWorld(World* aWorld)
 {
-    aCount = Clamp(aCount, 0, MAX_ENTITIES - (uint32_t)gGameState.myEntityService.Count());
+    /* Hands back the model reference of every entity the observer has seen. */
+    aWorld->myModelComponents.Clear();
+    aWorld->myModelComponents.DispatchEvents();
+    aWorld->myModelComponents.RemoveObserver(aWorld->myModelObserver);
+
+    for (uint32_t i = 0U; i < SPAWN_MODEL_COUNT; ++i)
+    {
+        ModelManager::Release(aWorld->mySpawnModels[i]);
+    }
+
+    aWorld->myJobSystem.Terminate();
+    delete aWorld;
+}
+
+void Game::UpdateAssets()
+{
+    ModelManager::Update(MODEL_UPLOAD_BUDGET_SECONDS);
+}
+
+void Game::Update(World* aWorld, const Camera3D& aCamera)
+{
+    PROFILE_ZONE("Game::Update");
+
+    UpdateAssets();
+    Tick(aWorld);
+    Draw(aWorld, aCamera);
+}
+
+void Game::Draw(World* aWorld, const Camera3D& aCamera)
+{
+    PROFILE_ZONE("Game::Draw");
+
+    const uint32_t modelCount = aWorld->myDrawables.GetSize();
+    {
+        PERF_COUNTERS_SCOPE("Systems::Cull", modelCount);
+        const float aspect = (float)GetScreenWidth() / (float)GetScreenHeight();
+        const Frustum frustum = Systems::MakeFrustum(aCamera, aspect, CAMERA_NEAR, CAMERA_FAR);
+        Systems::Cull(&aWorld->myTransformComponents, &aWorld->myModelComponents, aWorld->myDrawables,
+            frustum, &gVisibleModels, &aWorld->myJobSystem);
+    }
+    {
+        PERF_COUNTERS_SCOPE("Systems::Render", modelCount);
+        Systems::Render(&aWorld->myTransformComponents, &aWorld->myModelComponents,
+            &gVisibleModels, aCamera, &gRenderCommands, &aWorld->myJobSystem);
+    }
+    {
+        PERF_COUNTERS_SCOPE("RenderBackend::Execute", modelCount);
+        gRenderBackend.Execute(gRenderCommands);
+    }
+}
+
+/*
+* Moves a few components per tick towards Z-order of their positions, so
+* systems walking the dense arrays touch nearby entities together. The lists
+* an entity has components in are sorted by the same keys, so a system that
+* walks one list and looks up another reads both in step. Only depends on the
+* simulated state, so deterministic worlds stay in lockstep.
+*/
+static void SortComponents(Game::World* aWorld)
+{
+    PROFILE_ZONE("Game::SortComponents");
+
+    Systems::ComputeMortonKeys(&aWorld->myTransformComponents, WORLD_MIN, WORLD_MAX, aWorld->mySortKeys);
+    aWorld->myTransformComponents.SortStep(aWorld->mySortKeys, COMPONENT_SORT_SWAPS_PER_TICK);
+    aWorld->myMovementComponents.SortStep(aWorld->mySortKeys, COMPONENT_SORT_SWAPS_PER_TICK);
+    aWorld->myModelComponents.SortStep(aWorld->mySortKeys, COMPONENT_SORT_SWAPS_PER_TICK);
+}
+
+void Game::Tick(World* aWorld)
+{
+    PROFILE_ZONE("Game::Tick");
+
+    const float dt = aWorld->mySettings.myIsDeterministic ? aWorld->mySettings.myFixedDeltaTime : GetFrameTime();
+
+    {
+        PERF_COUNTERS_SCOPE("Systems::MovementUpdate", aWorld->myMovementComponents.GetSize());
+        Systems::MovementUpdate(&aWorld->myTransformComponents, &aWorld->myMovementComponents, dt);
+    }
+    {
+        PERF_COUNTERS_SCOPE("Systems::Collide", aWorld->myModelComponents.GetSize());
+        Systems::Collide(&aWorld->myTransformComponents, &aWorld->myMovementComponents, &aWorld->myModelComponents,
+            &aWorld->myCollisionState, &aWorld->myJobSystem);
+    }
+
+    {
+        PERF_COUNTERS_SCOPE("Game::SortComponents", aWorld->myTransformComponents.GetSize());
+        SortComponents(aWorld);
+    }
+
+    /* Everything observers need to hear about this tick, including calls made since the last one. */
+    {
+        PROFILE_ZONE("Game::DispatchEvents");
+        aWorld->myTransformComponents.DispatchEvents();
+        aWorld->myMovementComponents.DispatchEvents();
+        aWorld->myModelComponents.DispatchEvents();
+    }
+
+    ++aWorld->myTickCount;
+    aWorld->myChecksum = ComputeChecksum(aWorld);
+
+#if defined(GAME_REPLICATION_LOOPBACK)
+    aWorld->myLoopbackBuffer.Clear();
+    EncodeDelta(aWorld, aWorld->myLoopbackReplica.myVersion, &aWorld->myLoopbackBuffer);
+    const bool applied = Replication::ApplyDelta(aWorld->myLoopbackBuffer.Data(), aWorld->myLoopbackBuffer.Size(), &aWorld->myLoopbackReplica);
+
+    assert(applied && "Loopback replica rejected a delta.");
+    assert(aWorld->myLoopbackReplica.myTransformComponents.GetSize() == aWorld->myTransformComponents.GetSize() && "Loopback replica is out of sync.");
+    (void)applied;
+#endif
+}
+
+void Game::AddEntities(World* aWorld, uint32_t aCount)
+{
+    aCount = Clamp(aCount, 0, MAX_ENTITIES - (uint32_t)aWorld->myEntityService.Count());
 
     for (uint32_t i = 0; i < aCount; ++i)
     {
-        const Entity e = gGameState.myEntityService.GetEntity();
-        gGameState.mySpawnedEntities[gGameState.mySpawnedEntitiesCount++] = e;
+        const Entity e = aWorld->myEntityService.GetEntity();
+        aWorld->mySpawnedEntities[aWorld->mySpawnedEntitiesCount++] = e;
+
+        Random& random = aWorld->myRandom;
 
-        const float randomPositionX = (float)GetRandomValue(-25,25);
-        const float randomPositionY = (float)GetRandomValue(0,50);
-        const float randomPositionZ = (float)GetRandomValue(-25,25);
+        const float randomPositionX = (float)random.Range(-25, 25);
+        const float randomPositionY = (float)random.Range(0, 50);
+        const float randomPositionZ = (float)random.Range(-25, 25);
 
-        gGameState.myTransformComponents.AddComponent(e).myPosition = { randomPositionX, randomPositionY, randomPositionZ };
+        aWorld->myTransformComponents.AddComponent(e).myPosition = { randomPositionX, randomPositionY, randomPositionZ };
 
-        const float randomVelocityX = (float)GetRandomValue(0, 10);
-        const float randomVelocityY = (float)GetRandomValue(0, 10);
-        const float randomVelocityZ = (float)GetRandomValue(0, 10);
+        const float randomVelocityX = (float)random.Range(0, 10);
+        const float randomVelocityY = (float)random.Range(0, 10);
+        const float randomVelocityZ = (float)random.Range(0, 10);
 
-        gGameState.myMovementComponents.AddComponent(e).myVelocity = { randomVelocityX, randomVelocityY, randomVelocityZ };
+        aWorld->myMovementComponents.AddComponent(e).myVelocity = { randomVelocityX, randomVelocityY, randomVelocityZ };
 
-        ModelComponent& mdlComp = gGameState.myModelComponents.AddComponent(e);
-        mdlComp.myColor = { (uint8_t)GetRandomValue(0, 255), (uint8_t)GetRandomValue(0, 255), (uint8_t)GetRandomValue(0, 255), 255 };
+        ModelComponent& mdlComp = aWorld->myModelComponents.AddComponent(e);
+        mdlComp.myColor = { (uint8_t)random.Range(0, 255), (uint8_t)random.Range(0, 255), (uint8_t)random.Range(0, 255), 255 };
 
-        int randModel = GetRandomValue(0, 1);
-        mdlComp.myModel = ModelManager::GetModelID(randModel ? "assets/banana.obj" : "assets/donut.obj");
+        int randModel = random.Range(0, 1);
+        mdlComp.myModel = aWorld->mySpawnModels[randModel ? 0 : 1];
         mdlComp.myScale = randModel ? 1.0f : 50.0f;
     }
 }
 
-void Game::RemoveEntities(uint32_t aCount)
+void Game::RemoveEntities(World* aWorld, uint32_t aCount)
 {
-    aCount = Clamp(aCount, 0, gGameState.mySpawnedEntitiesCount);
+    aCount = Clamp(aCount, 0, aWorld->mySpawnedEntitiesCount);
 
     for (uint32_t i = 0; i < aCount; ++i)
     {
-        const Entity e = gGameState.mySpawnedEntities[--gGameState.mySpawnedEntitiesCount];
+        const Entity e = aWorld->mySpawnedEntities[--aWorld->mySpawnedEntitiesCount];
 
-        gGameState.myTransformComponents.RemoveComponent(e);
-        gGameState.myMovementComponents.RemoveComponent(e);
-        gGameState.myModelComponents.RemoveComponent(e);
+        aWorld->myTransformComponents.RemoveComponent(e);
+        aWorld->myMovementComponents.RemoveComponent(e);
+        aWorld->myModelComponents.RemoveComponent(e);
 
-        gGameState.myEntityService.ReturnEntity(e);
+        aWorld->myEntityService.ReturnEntity(e);
     }
 }
 
-bool Game::IsMaxEntitiesReached()
+bool Game::SaveSnapshot(World* aWorld, const char* const aPath)
+{
+    SnapshotModel models[MAX_ENTITIES];
+    uint32_t modelCount = 0U;
+
+    const ModelComponent* modelList = aWorld->myModelComponents.GetDenseComponents();
+    for (uint32_t compIndex = 0U; compIndex < aWorld->myModelComponents.GetSize(); ++compIndex)
+    {
+        const ModelID id = modelList[compIndex].myModel;
+
+        bool isListed = false;
+        for (uint32_t i = 0U; i < modelCount && !isListed; ++i)
+        {
+            isListed = models[i].myId == id;
+        }
+
+        const char* path = ModelManager::GetModelPath(id);
+        if (!isListed && path)
+        {
+            memset(&models[modelCount], 0, sizeof(SnapshotModel));
+            models[modelCount].myId = id;
+            strncpy(models[modelCount].myPath, path, sizeof(models[modelCount].myPath) - 1);
+            ++modelCount;
+        }
+    }
+
+    SnapshotWriter writer;
+    writer.Section(SnapshotOwner_Game, 0U, &aWorld->mySpawnedEntitiesCount, sizeof(aWorld->mySpawnedEntitiesCount));
+    writer.Section(SnapshotOwner_Game, 1U, aWorld->mySpawnedEntities, sizeof(Entity) * aWorld->mySpawnedEntitiesCount);
+    writer.Section(SnapshotOwner_Game, 2U, &modelCount, sizeof(modelCount));
+    writer.Section(SnapshotOwner_Game, 3U, models, sizeof(SnapshotModel) * modelCount);
+    writer.Section(SnapshotOwner_Game, 4U, aWorld->myRandom.GetState(), sizeof(uint32_t) * 4U);
+    writer.Section(SnapshotOwner_Game, 5U, &aWorld->myTickCount, sizeof(aWorld->myTickCount));
+    aWorld->myEntityService.Serialize(writer, SnapshotOwner_Entities);
+    aWorld->myTransformComponents.Serialize(writer, SnapshotOwner_Transforms);
+    aWorld->myMovementComponents.Serialize(writer, SnapshotOwner_Movements);
+    aWorld->myModelComponents.Serialize(writer, SnapshotOwner_Models);
+
+    return writer.Save(aPath);
+}
+
+bool Game::LoadSnapshot(World* aWorld, const char* const aPath)
+{
+    SnapshotReader reader;
+    bool succeeded = reader.Open(aPath);
+
+    uint32_t modelCount = 0U;
+    succeeded = succeeded && reader.Section(SnapshotOwner_Game, 0U, &aWorld->mySpawnedEntitiesCount, sizeof(aWorld->mySpawnedEntitiesCount));
+    succeeded = succeeded && aWorld->mySpawnedEntitiesCount <= MAX_ENTITIES;
+    succeeded = succeeded && reader.Section(SnapshotOwner_Game, 1U, aWorld->mySpawnedEntities, sizeof(Entity) * aWorld->mySpawnedEntitiesCount);
+    succeeded = succeeded && reader.Section(SnapshotOwner_Game, 2U, &modelCount, sizeof(modelCount));
+    succeeded = succeeded && modelCount <= MAX_ENTITIES;
+
+    const SnapshotModel* models = succeeded ? (const SnapshotModel*)reader.Find(SnapshotOwner_Game, 3U, sizeof(SnapshotModel) * modelCount) : nullptr;
+    succeeded = succeeded && (models || modelCount == 0U);
+
+    succeeded = succeeded && aWorld->myEntityService.Serialize(reader, SnapshotOwner_Entities);
+    succeeded = succeeded && aWorld->myTransformComponents.Serialize(reader, SnapshotOwner_Transforms);
+    succeeded = succeeded && aWorld->myMovementComponents.Serialize(reader, SnapshotOwner_Movements);
+    succeeded = succeeded && aWorld->myModelComponents.Serialize(reader, SnapshotOwner_Models);
+    succeeded = succeeded && IsLoadedWorldConsistent(aWorld);
+
+    if (!succeeded)
+    {
+        TraceLog(LOG_WARNING, "GAME: [%s] Failed to load snapshot, clearing the world.", aPath);
+
+        aWorld->myEntityService.Clear();
+        aWorld->myTransformComponents.Clear();
+        aWorld->myMovementComponents.Clear();
+        aWorld->myModelComponents.Clear();
+        aWorld->mySpawnedEntitiesCount = 0;
+        return false;
+    }
+
+    /* Older snapshots have no generator state or tick; they keep running from the current ones. */
+    uint32_t randomState[4];
+    if (reader.Section(SnapshotOwner_Game, 4U, randomState, sizeof(randomState)))
+    {
+        aWorld->myRandom.SetState(randomState);
+    }
+    reader.Section(SnapshotOwner_Game, 5U, &aWorld->myTickCount, sizeof(aWorld->myTickCount));
+
+    /* Swap the saved IDs for this run's, loading any model that is not known yet. */
+    ModelComponent* modelList = aWorld->myModelComponents.GetDenseComponents();
+    for (uint32_t compIndex = 0U; compIndex < aWorld->myModelComponents.GetSize(); ++compIndex)
+    {
+        for (uint32_t i = 0U; i < modelCount; ++i)
+        {
+            if (models[i].myId == modelList[compIndex].myModel)
+            {
+                char path[sizeof(models[i].myPath)];
+                memcpy(path, models[i].myPath, sizeof(path));
+                path[sizeof(path) - 1] = '\0';
+
+                modelList[compIndex].myModel = ModelManager::GetModelID(path);
+                break;
+            }
+        }
+    }
+
+    aWorld->myChecksum = ComputeChecksum(aWorld);
+    return true;
+}
+
+uint32_t Game::EncodeDelta(World* aWorld, uint32_t aSinceVersion, ByteWriter* aWriter)
+{
+    const uint32_t version = aWorld->myVersion;
+    Replication::EncodeDelta(&aWorld->myTransformComponents, &aWorld->myMovementComponents, &aWorld->myModelComponents,
+        aSinceVersion, version, aWriter);
+
+    /* Changes made from here on belong to the next delta. */
+    SetChangeVersion(aWorld, version + 1U);
+
+    return version;
+}
+
+bool Game::IsMaxEntitiesReached(World* aWorld)
+{
+    return aWorld->myEntityService.Count() == MAX_ENTITIES;
+}
+
+uint32_t Game::GetEntityCount(World* aWorld)
+{
+    return (uint32_t)aWorld->myEntityService.Count();
+}
+
+uint32_t Game::GetTickCount(World* aWorld)
 {
-    return gGameState.myEntityService.Count() == MAX_ENTITIES;
+    return aWorld->myTickCount;
 }
 
-uint32_t Game::GetEntityCount()
+uint64_t Game::GetChecksum(World* aWorld)
 {
-    return (uint32_t)gGameState.myEntityService.Count();
+    return aWorld->myChecksum;
 }
\ No newline at end of file
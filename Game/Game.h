@@ -5,17 +5,92 @@
 
 #include <stdint.h>
 
+extern "C"
+{
+#include "../raylib/raylib.h"
+}
+
+class ByteWriter;
+
+/*
+* The process owns what every simulation shares: streamed models, the render
+* backend and the hardware counters. Each World owns one simulation, its
+* entities, components and job system, and shares nothing mutable with other
+* worlds, so a server can run many small matches side by side.
+*
+* Thread rules: Init, Terminate, CreateWorld, DestroyWorld, UpdateAssets,
+* Draw, Update and LoadSnapshot belong to the main thread. Every other call
+* touches only the world it is given, so different worlds may run them on
+* different threads at once, as long as the main thread calls above do not
+* overlap with them.
+*/
 namespace Game
 {
-    void Init();
-    void Update();
+    struct World;
+
+    struct Settings
+    {
+        /* Linux only; per-system counter totals are printed on Terminate(). See Utils/PerfCounters.h. */
+        bool myUseHardwareCounters = false;
+    };
+
+    /*
+    * In deterministic mode every tick advances by myFixedDeltaTime and all
+    * randomness comes from a generator seeded with mySeed, so peers that make
+    * the same calls in the same order stay in lockstep. Compare GetChecksum()
+    * after each tick to catch a desync. Bit-identical results across machines
+    * also need the same compiler flags (no fast-math or FMA contraction).
+    */
+    struct WorldSettings
+    {
+        bool myIsDeterministic = false;
+        uint64_t mySeed = 0U;
+        float myFixedDeltaTime = 1.0f / 30.0f;
+
+        /*
+        * Job system workers besides the calling thread; uint32_t(-1) uses one
+        * per remaining hardware thread. Worlds that tick in parallel usually
+        * want 0.
+        */
+        uint32_t myWorkerCount = uint32_t(-1);
+    };
+
+    void Init(const Settings& someSettings = Settings());
+    /* Destroy every world first. */
     void Terminate();
 
-    void AddEntities(uint32_t aCount);
-    void RemoveEntities(uint32_t aCount);
+    /* Starts with one entity. */
+    World* CreateWorld(const WorldSettings& someSettings = WorldSettings());
+    void DestroyWorld(World* aWorld);
+
+    /* Finishes streamed-in models and evicts idle ones. Once per frame, while no world ticks. */
+    void UpdateAssets();
+    /* Advances the simulation one tick without drawing. */
+    void Tick(World* aWorld);
+    void Draw(World* aWorld, const Camera3D& aCamera);
+    /* UpdateAssets(), Tick() and Draw(), for a client showing a single world. */
+    void Update(World* aWorld, const Camera3D& aCamera);
+
+    void AddEntities(World* aWorld, uint32_t aCount);
+    void RemoveEntities(World* aWorld, uint32_t aCount);
+
+    /* Whole-world snapshots, see ECS/Snapshot.h. A failed load leaves the world empty. */
+    bool SaveSnapshot(World* aWorld, const char* const aPath);
+    bool LoadSnapshot(World* aWorld, const char* const aPath);
+
+    /*
+    * Appends every component change after aSinceVersion to aWriter, see
+    * Replication.h. Returns the version the delta covers; pass it back as
+    * aSinceVersion next time.
+    */
+    uint32_t EncodeDelta(World* aWorld, uint32_t aSinceVersion, ByteWriter* aWriter);
+
+    bool IsMaxEntitiesReached(World* aWorld);
+    uint32_t GetEntityCount(World* aWorld);
 
-    bool IsMaxEntitiesReached();
-    uint32_t GetEntityCount();
+    uint32_t GetTickCount(World* aWorld);
+    /* Fingerprint of the simulated state after the last tick. Independent of component storage order. */
+    uint64_t GetChecksum(World* aWorld);
 }
 
 #endif // GAME_H_
@@ -0,0 +1,264 @@
+#include "MeshCache.h"
+
+#include "../Utils/MappedFile.h"
+#include "Misc.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+namespace MeshCache
+{
+    constexpr uint32_t MAGIC = 0x48534D45; // "EMSH"
+    constexpr uint32_t VERSION = 3U;
+    /* Loads and saves keep the mesh table on the stack. */
+    constexpr uint32_t MAX_MESHES = 16U;
+
+    enum Flags_ : uint32_t
+    {
+        Flags_Texcoords = 1U << 0,
+        Flags_Normals = 1U << 1,
+    };
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t contentHash;
+        uint64_t sourceSize;
+        /* Nanoseconds where the platform has them, seconds otherwise. */
+        int64_t sourceModifiedTime;
+        uint32_t meshCount;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(Header) == 40, "Mesh cache header must stay tightly packed.");
+
+    /* One per mesh, in a table after the header. */
+    struct MeshHeader
+    {
+        uint32_t vertexCount;
+        uint32_t triangleCount;
+        uint32_t indexCount;
+        uint32_t flags;
+    };
+    static_assert(sizeof(MeshHeader) == 16, "Mesh cache mesh headers must stay tightly packed.");
+
+    /* Sections are padded to 16 bytes so the mapped buffers stay aligned. */
+    static size_t Align(size_t aSize)
+    {
+        return (aSize + 15U) & ~size_t(15U);
+    }
+
+    static void GetCachePath(const char* const aSourcePath, char* aPathOut, size_t aPathSize)
+    {
+        snprintf(aPathOut, aPathSize, "%s.meshcache", aSourcePath);
+    }
+
+    /* Reads the size and modification time of aPath without opening it. */
+    static bool GetSourceKey(const char* const aPath, uint64_t* aSizeOut, int64_t* aModifiedTimeOut)
+    {
+#if defined(_WIN32)
+        struct _stat64 info;
+        if (_stat64(aPath, &info) != 0)
+        {
+            return false;
+        }
+        *aModifiedTimeOut = (int64_t)info.st_mtime;
+#else
+        struct stat info;
+        if (stat(aPath, &info) != 0)
+        {
+            return false;
+        }
+#if defined(__APPLE__)
+        *aModifiedTimeOut = (int64_t)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+        *aModifiedTimeOut = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+#endif
+        *aSizeOut = (uint64_t)info.st_size;
+
+        return true;
+    }
+
+    static bool GetContentHash(const char* const aPath, uint64_t* aHashOut)
+    {
+        MappedFile file;
+        if (!file.Open(aPath))
+        {
+            return false;
+        }
+
+        *aHashOut = HashMemory(file.Data(), file.Size());
+        return true;
+    }
+
+    static size_t GetSectionBytes(const MeshHeader& aMesh)
+    {
+        const size_t vertexBytes = sizeof(float) * 3 * aMesh.vertexCount;
+        const size_t texcoordBytes = (aMesh.flags & Flags_Texcoords) ? sizeof(float) * 2 * aMesh.vertexCount : 0U;
+        const size_t normalBytes = (aMesh.flags & Flags_Normals) ? sizeof(float) * 3 * aMesh.vertexCount : 0U;
+        const size_t indexBytes = sizeof(unsigned short) * aMesh.indexCount;
+
+        return Align(vertexBytes) + Align(texcoordBytes) + Align(normalBytes) + Align(indexBytes);
+    }
+
+    static const char* ReadSection(const char* aCursor, void** aTargetOut, size_t aSize)
+    {
+        *aTargetOut = MemAlloc((int)aSize);
+        memcpy(*aTargetOut, aCursor, aSize);
+
+        return aCursor + Align(aSize);
+    }
+
+    static bool WriteSection(FILE* aFile, const void* aData, size_t aSize)
+    {
+        static const char padding[16] = { 0 };
+
+        return fwrite(aData, 1, aSize, aFile) == aSize
+            && fwrite(padding, 1, Align(aSize) - aSize, aFile) == Align(aSize) - aSize;
+    }
+}
+
+bool MeshCache::Load(const char* const aSourcePath, Mesh* someMeshesOut, uint32_t aMaxMeshCount, uint32_t* aMeshCountOut)
+{
+    *aMeshCountOut = 0U;
+
+    uint64_t sourceSize;
+    int64_t sourceModifiedTime;
+    if (!GetSourceKey(aSourcePath, &sourceSize, &sourceModifiedTime))
+    {
+        return false;
+    }
+
+    char cachePath[512];
+    GetCachePath(aSourcePath, cachePath, sizeof(cachePath));
+
+    MappedFile file;
+    if (!file.Open(cachePath) || file.Size() < Align(sizeof(Header)))
+    {
+        return false;
+    }
+
+    Header header;
+    memcpy(&header, file.Data(), sizeof(Header));
+
+    if (header.magic != MAGIC || header.version != VERSION || header.meshCount == 0U || header.meshCount > aMaxMeshCount || header.meshCount > MAX_MESHES)
+    {
+        return false;
+    }
+
+    /* The source changed on disk, or was only touched; its contents decide which. */
+    const bool isKeyCurrent = header.sourceSize == sourceSize && header.sourceModifiedTime == sourceModifiedTime;
+    uint64_t contentHash;
+    if (!isKeyCurrent && (!GetContentHash(aSourcePath, &contentHash) || contentHash != header.contentHash))
+    {
+        return false;
+    }
+
+    const size_t tableBytes = Align(sizeof(MeshHeader) * header.meshCount);
+    if (file.Size() < Align(sizeof(Header)) + tableBytes)
+    {
+        return false;
+    }
+
+    MeshHeader meshes[MAX_MESHES];
+    memcpy(meshes, file.Data() + Align(sizeof(Header)), sizeof(MeshHeader) * header.meshCount);
+
+    size_t expectedSize = Align(sizeof(Header)) + tableBytes;
+    for (uint32_t i = 0U; i < header.meshCount; ++i)
+    {
+        expectedSize += GetSectionBytes(meshes[i]);
+    }
+    if (file.Size() != expectedSize)
+    {
+        return false;
+    }
+
+    const char* cursor = file.Data() + Align(sizeof(Header)) + tableBytes;
+    for (uint32_t i = 0U; i < header.meshCount; ++i)
+    {
+        const MeshHeader& mesh = meshes[i];
+        Mesh& meshOut = someMeshesOut[i];
+
+        memset(&meshOut, 0, sizeof(Mesh));
+        meshOut.vertexCount = (int)mesh.vertexCount;
+        meshOut.triangleCount = (int)mesh.triangleCount;
+
+        cursor = ReadSection(cursor, (void**)&meshOut.vertices, sizeof(float) * 3 * mesh.vertexCount);
+        if (mesh.flags & Flags_Texcoords) cursor = ReadSection(cursor, (void**)&meshOut.texcoords, sizeof(float) * 2 * mesh.vertexCount);
+        if (mesh.flags & Flags_Normals) cursor = ReadSection(cursor, (void**)&meshOut.normals, sizeof(float) * 3 * mesh.vertexCount);
+        if (mesh.indexCount) cursor = ReadSection(cursor, (void**)&meshOut.indices, sizeof(unsigned short) * mesh.indexCount);
+    }
+    *aMeshCountOut = header.meshCount;
+
+    if (!isKeyCurrent)
+    {
+        file.Close();
+        Save(aSourcePath, someMeshesOut, header.meshCount);
+    }
+
+    return true;
+}
+
+bool MeshCache::Save(const char* const aSourcePath, const Mesh* someMeshes, uint32_t aMeshCount)
+{
+    if (aMeshCount == 0U || aMeshCount > MAX_MESHES)
+    {
+        return false;
+    }
+
+    Header header;
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.meshCount = aMeshCount;
+    header.reserved = 0U;
+
+    if (!GetSourceKey(aSourcePath, &header.sourceSize, &header.sourceModifiedTime) || !GetContentHash(aSourcePath, &header.contentHash))
+    {
+        return false;
+    }
+
+    MeshHeader meshes[MAX_MESHES];
+    for (uint32_t i = 0U; i < aMeshCount; ++i)
+    {
+        const Mesh& mesh = someMeshes[i];
+        meshes[i].vertexCount = (uint32_t)mesh.vertexCount;
+        meshes[i].triangleCount = (uint32_t)mesh.triangleCount;
+        meshes[i].indexCount = mesh.indices ? (uint32_t)mesh.triangleCount * 3U : 0U;
+        meshes[i].flags = (mesh.texcoords ? Flags_Texcoords : 0U) | (mesh.normals ? Flags_Normals : 0U);
+    }
+
+    char cachePath[512];
+    GetCachePath(aSourcePath, cachePath, sizeof(cachePath));
+
+    /* Written under a temporary name and renamed, so other loaders never map a half-written cache. */
+    char tempPath[512];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", cachePath);
+
+    FILE* file = fopen(tempPath, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    bool succeeded = WriteSection(file, &header, sizeof(Header));
+    succeeded = succeeded && WriteSection(file, meshes, sizeof(MeshHeader) * aMeshCount);
+    for (uint32_t i = 0U; i < aMeshCount; ++i)
+    {
+        const Mesh& mesh = someMeshes[i];
+        succeeded = succeeded && WriteSection(file, mesh.vertices, sizeof(float) * 3 * meshes[i].vertexCount);
+        if (mesh.texcoords) succeeded = succeeded && WriteSection(file, mesh.texcoords, sizeof(float) * 2 * meshes[i].vertexCount);
+        if (mesh.normals) succeeded = succeeded && WriteSection(file, mesh.normals, sizeof(float) * 3 * meshes[i].vertexCount);
+        if (mesh.indices) succeeded = succeeded && WriteSection(file, mesh.indices, sizeof(unsigned short) * meshes[i].indexCount);
+    }
+    fclose(file);
+
+    if (!succeeded || rename(tempPath, cachePath) != 0)
+    {
+        remove(tempPath);
+        return false;
+    }
+
+    return true;
+}
\ No newline at end of file
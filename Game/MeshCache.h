@@ -0,0 +1,34 @@
+#if !defined(MESHCACHE_H_)
+#define MESHCACHE_H_
+
+#pragma once
+
+#include <stdint.h>
+
+extern "C"
+{
+#include "../raylib/raylib.h"
+}
+
+/*
+* Binary mesh cache. Stores a model's processed meshes, every LOD level, next
+* to the source asset so later loads can copy the buffers straight out of a
+* mapped file instead of parsing text and simplifying again.
+*
+* A cache is keyed on the source's size and modification time, which is all a
+* hit needs to look at. The source's content hash is stored as well and only
+* read when the key no longer matches: a source that was touched but not
+* changed still hits, and its cache is rewritten under the new key.
+*/
+namespace MeshCache
+{
+    /*
+    * Loads up to aMaxMeshCount meshes cached for aSourcePath. Returns false if
+    * the cache is missing, stale, from another format version or holds more
+    * meshes than that.
+    */
+    bool Load(const char* const aSourcePath, Mesh* someMeshesOut, uint32_t aMaxMeshCount, uint32_t* aMeshCountOut);
+    bool Save(const char* const aSourcePath, const Mesh* someMeshes, uint32_t aMeshCount);
+}
+
+#endif // MESHCACHE_H_
\ No newline at end of file
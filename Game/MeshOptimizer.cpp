@@ -0,0 +1,522 @@
+#include "MeshOptimizer.h"
+
+#include "../Utils/Dictionary.h"
+#include "Misc.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace MeshOptimizer
+{
+    constexpr uint32_t MAX_INDEXED_VERTICES = 65535U;
+    constexpr uint32_t ACMR_FIFO_SIZE = 16U;
+
+    /* Forsyth scoring parameters, as published. */
+    constexpr int CACHE_SIZE = 32;
+    constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+    constexpr float CACHE_DECAY_POWER = 1.5f;
+    constexpr float VALENCE_BOOST_SCALE = 2.0f;
+    constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+    struct WeldKey
+    {
+        float myAttributes[8];
+
+        bool operator== (const WeldKey& anotherKey) const
+        {
+            return memcmp(myAttributes, anotherKey.myAttributes, sizeof(myAttributes)) == 0;
+        }
+    };
+
+    struct HashWeldKey
+    {
+        uint64_t operator () (const WeldKey& aKey)
+        {
+            return HashMemory(aKey.myAttributes, sizeof(aKey.myAttributes));
+        }
+    };
+
+    struct VertexState
+    {
+        int myCachePosition;
+        uint32_t myRemainingValence;
+        uint32_t myFirstTriangle;
+        float myScore;
+    };
+
+    static WeldKey MakeKey(const Mesh& aMesh, uint32_t aVertex)
+    {
+        WeldKey key;
+        memset(&key, 0, sizeof(key));
+        memcpy(key.myAttributes, aMesh.vertices + aVertex * 3, sizeof(float) * 3);
+        if (aMesh.texcoords) memcpy(key.myAttributes + 3, aMesh.texcoords + aVertex * 2, sizeof(float) * 2);
+        if (aMesh.normals) memcpy(key.myAttributes + 5, aMesh.normals + aVertex * 3, sizeof(float) * 3);
+        return key;
+    }
+
+    static float ScoreVertex(const VertexState& aVertex)
+    {
+        if (aVertex.myRemainingValence == 0U)
+        {
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+        if (aVertex.myCachePosition >= 0)
+        {
+            if (aVertex.myCachePosition < 3)
+            {
+                score = LAST_TRIANGLE_SCORE;
+            }
+            else
+            {
+                const float scaler = 1.0f / (CACHE_SIZE - 3);
+                score = powf(1.0f - (aVertex.myCachePosition - 3) * scaler, CACHE_DECAY_POWER);
+            }
+        }
+
+        return score + VALENCE_BOOST_SCALE * powf((float)aVertex.myRemainingValence, -VALENCE_BOOST_POWER);
+    }
+
+    /* Returns the number of unique vertices, writing one index per input vertex, or uint32_t(-1) if the lookup table could not grow. */
+    static uint32_t Weld(const Mesh& aMesh, uint32_t* someIndicesOut, uint32_t* someSourceVerticesOut)
+    {
+        const uint32_t vertexCount = (uint32_t)aMesh.vertexCount;
+        Dictionary<WeldKey, uint32_t, HashWeldKey> uniqueVertices(vertexCount * 2U);
+
+        uint32_t uniqueCount = 0U;
+        for (uint32_t v = 0U; v < vertexCount; ++v)
+        {
+            const WeldKey key = MakeKey(aMesh, v);
+            const uint32_t* existing = uniqueVertices.Get(key);
+
+            if (existing)
+            {
+                someIndicesOut[v] = *existing;
+            }
+            else
+            {
+                if (!uniqueVertices.Insert(key, uniqueCount))
+                {
+                    return uint32_t(-1);
+                }
+                someSourceVerticesOut[uniqueCount] = v;
+                someIndicesOut[v] = uniqueCount++;
+            }
+        }
+
+        return uniqueCount;
+    }
+
+    static void ReorderTriangles(uint32_t* someIndices, uint32_t aTriangleCount, uint32_t aVertexCount)
+    {
+        VertexState* vertices = (VertexState*)calloc(aVertexCount, sizeof(VertexState));
+        uint32_t* adjacency = (uint32_t*)malloc(sizeof(uint32_t) * aTriangleCount * 3);
+        float* triangleScores = (float*)malloc(sizeof(float) * aTriangleCount);
+        bool* emitted = (bool*)calloc(aTriangleCount, sizeof(bool));
+        uint32_t* output = (uint32_t*)malloc(sizeof(uint32_t) * aTriangleCount * 3);
+
+        /* Per-vertex triangle lists, packed. Emitted triangles are swapped past myRemainingValence. */
+        for (uint32_t i = 0U; i < aTriangleCount * 3; ++i)
+        {
+            ++vertices[someIndices[i]].myRemainingValence;
+        }
+        uint32_t offset = 0U;
+        for (uint32_t v = 0U; v < aVertexCount; ++v)
+        {
+            vertices[v].myFirstTriangle = offset;
+            vertices[v].myCachePosition = -1;
+            offset += vertices[v].myRemainingValence;
+            vertices[v].myRemainingValence = 0U;
+        }
+        for (uint32_t tri = 0U; tri < aTriangleCount; ++tri)
+        {
+            for (uint32_t corner = 0U; corner < 3U; ++corner)
+            {
+                VertexState& vertex = vertices[someIndices[tri * 3 + corner]];
+                adjacency[vertex.myFirstTriangle + vertex.myRemainingValence++] = tri;
+            }
+        }
+        for (uint32_t v = 0U; v < aVertexCount; ++v)
+        {
+            vertices[v].myScore = ScoreVertex(vertices[v]);
+        }
+
+        int32_t bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (uint32_t tri = 0U; tri < aTriangleCount; ++tri)
+        {
+            const uint32_t* t = someIndices + tri * 3;
+            triangleScores[tri] = vertices[t[0]].myScore + vertices[t[1]].myScore + vertices[t[2]].myScore;
+            if (triangleScores[tri] > bestScore)
+            {
+                bestScore = triangleScores[tri];
+                bestTriangle = (int32_t)tri;
+            }
+        }
+
+        int32_t cache[CACHE_SIZE + 3];
+        int32_t newCache[CACHE_SIZE + 3];
+        int cacheCount = 0;
+        uint32_t scanCursor = 0U;
+
+        for (uint32_t emittedCount = 0U; emittedCount < aTriangleCount; ++emittedCount)
+        {
+            /* Nothing in the cache scored; fall back to the next unused triangle in input order. */
+            if (bestTriangle < 0)
+            {
+                while (emitted[scanCursor]) ++scanCursor;
+                bestTriangle = (int32_t)scanCursor;
+            }
+
+            const uint32_t* t = someIndices + bestTriangle * 3;
+            memcpy(output + emittedCount * 3, t, sizeof(uint32_t) * 3);
+            emitted[bestTriangle] = true;
+
+            for (uint32_t corner = 0U; corner < 3U; ++corner)
+            {
+                VertexState& vertex = vertices[t[corner]];
+                uint32_t* triangles = adjacency + vertex.myFirstTriangle;
+                for (uint32_t i = 0U; i < vertex.myRemainingValence; ++i)
+                {
+                    if (triangles[i] == (uint32_t)bestTriangle)
+                    {
+                        triangles[i] = triangles[--vertex.myRemainingValence];
+                        break;
+                    }
+                }
+            }
+
+            /* New cache: the emitted triangle's vertices first, then the old cache in order. */
+            int newCount = 0;
+            for (uint32_t corner = 0U; corner < 3U; ++corner)
+            {
+                newCache[newCount++] = (int32_t)t[corner];
+            }
+            for (int i = 0; i < cacheCount; ++i)
+            {
+                const int32_t v = cache[i];
+                if (v != (int32_t)t[0] && v != (int32_t)t[1] && v != (int32_t)t[2])
+                {
+                    newCache[newCount++] = v;
+                }
+            }
+
+            for (int i = 0; i < newCount; ++i)
+            {
+                VertexState& vertex = vertices[newCache[i]];
+                vertex.myCachePosition = i < CACHE_SIZE ? i : -1;
+                vertex.myScore = ScoreVertex(vertex);
+            }
+
+            bestTriangle = -1;
+            bestScore = -1.0f;
+            for (int i = 0; i < newCount; ++i)
+            {
+                const VertexState& vertex = vertices[newCache[i]];
+                const uint32_t* triangles = adjacency + vertex.myFirstTriangle;
+                for (uint32_t j = 0U; j < vertex.myRemainingValence; ++j)
+                {
+                    const uint32_t tri = triangles[j];
+                    const uint32_t* other = someIndices + tri * 3;
+                    triangleScores[tri] = vertices[other[0]].myScore + vertices[other[1]].myScore + vertices[other[2]].myScore;
+                    if (triangleScores[tri] > bestScore)
+                    {
+                        bestScore = triangleScores[tri];
+                        bestTriangle = (int32_t)tri;
+                    }
+                }
+            }
+
+            cacheCount = newCount < CACHE_SIZE ? newCount : CACHE_SIZE;
+            memcpy(cache, newCache, sizeof(int32_t) * cacheCount);
+        }
+
+        memcpy(someIndices, output, sizeof(uint32_t) * aTriangleCount * 3);
+
+        free(vertices);
+        free(adjacency);
+        free(triangleScores);
+        free(emitted);
+        free(output);
+    }
+
+    /*
+    * Builds a 16-bit indexed mesh from welded indices, renumbering vertices in
+    * order of first use so vertex fetch walks memory linearly. someSourceVertices
+    * maps each welded vertex to the aSource vertex holding its attributes, and
+    * someIndices is rewritten to the final numbering.
+    */
+    static Mesh EmitIndexedMesh(const Mesh& aSource, const uint32_t* someSourceVertices, uint32_t* someIndices, uint32_t aTriangleCount, uint32_t aVertexCount)
+    {
+        uint32_t* remap = (uint32_t*)malloc(sizeof(uint32_t) * aVertexCount);
+        memset(remap, 0xFF, sizeof(uint32_t) * aVertexCount);
+        uint32_t nextVertex = 0U;
+
+        Mesh mesh = {};
+        mesh.vertexCount = (int)aVertexCount;
+        mesh.triangleCount = (int)aTriangleCount;
+        mesh.indices = (unsigned short*)MemAlloc(sizeof(unsigned short) * aTriangleCount * 3);
+        mesh.vertices = (float*)MemAlloc(sizeof(float) * 3 * aVertexCount);
+        mesh.texcoords = aSource.texcoords ? (float*)MemAlloc(sizeof(float) * 2 * aVertexCount) : nullptr;
+        mesh.normals = aSource.normals ? (float*)MemAlloc(sizeof(float) * 3 * aVertexCount) : nullptr;
+
+        for (uint32_t i = 0U; i < aTriangleCount * 3; ++i)
+        {
+            const uint32_t welded = someIndices[i];
+            if (remap[welded] == uint32_t(-1))
+            {
+                const uint32_t source = someSourceVertices[welded];
+                const uint32_t target = nextVertex++;
+                remap[welded] = target;
+
+                memcpy(mesh.vertices + target * 3, aSource.vertices + source * 3, sizeof(float) * 3);
+                if (mesh.texcoords) memcpy(mesh.texcoords + target * 2, aSource.texcoords + source * 2, sizeof(float) * 2);
+                if (mesh.normals) memcpy(mesh.normals + target * 3, aSource.normals + source * 3, sizeof(float) * 3);
+            }
+
+            someIndices[i] = remap[welded];
+            mesh.indices[i] = (unsigned short)someIndices[i];
+        }
+
+        /* Clustered input can leave welded vertices that no triangle uses. */
+        mesh.vertexCount = (int)nextVertex;
+        free(remap);
+
+        return mesh;
+    }
+
+    struct HashCell
+    {
+        uint64_t operator () (uint64_t aCell)
+        {
+            return HashMemory(&aCell, sizeof(aCell));
+        }
+    };
+
+    static uint32_t CornerVertex(const Mesh& aMesh, uint32_t aCorner)
+    {
+        return aMesh.indices ? aMesh.indices[aCorner] : aCorner;
+    }
+}
+
+float MeshOptimizer::ComputeAcmr(const uint32_t* someIndices, uint32_t anIndexCount, uint32_t aVertexCount)
+{
+    if (anIndexCount < 3U)
+    {
+        return 0.0f;
+    }
+
+    /* Timestamp FIFO: a vertex is cached if it was inserted within the last ACMR_FIFO_SIZE misses. */
+    uint32_t* insertedAt = (uint32_t*)calloc(aVertexCount, sizeof(uint32_t));
+    uint32_t misses = 0U;
+
+    for (uint32_t i = 0U; i < anIndexCount; ++i)
+    {
+        const uint32_t v = someIndices[i];
+        if (insertedAt[v] == 0U || misses + 1U - insertedAt[v] > ACMR_FIFO_SIZE)
+        {
+            insertedAt[v] = ++misses;
+        }
+    }
+
+    free(insertedAt);
+
+    return (float)misses / (float)(anIndexCount / 3U);
+}
+
+bool MeshOptimizer::Optimize(Mesh& aMesh, Stats* aStatsOut)
+{
+    if (aMesh.indices || aMesh.vertexCount <= 0)
+    {
+        return false;
+    }
+
+    const uint32_t vertexCount = (uint32_t)aMesh.vertexCount;
+    const uint32_t triangleCount = (uint32_t)aMesh.triangleCount;
+    uint32_t* indices = (uint32_t*)malloc(sizeof(uint32_t) * vertexCount);
+    uint32_t* sourceVertices = (uint32_t*)malloc(sizeof(uint32_t) * vertexCount);
+
+    const uint32_t uniqueCount = Weld(aMesh, indices, sourceVertices);
+    if (uniqueCount > MAX_INDEXED_VERTICES)
+    {
+        free(indices);
+        free(sourceVertices);
+        return false;
+    }
+
+    const float acmrBefore = ComputeAcmr(indices, triangleCount * 3, uniqueCount);
+    ReorderTriangles(indices, triangleCount, uniqueCount);
+
+    Mesh indexed = EmitIndexedMesh(aMesh, sourceVertices, indices, triangleCount, uniqueCount);
+
+    if (aStatsOut)
+    {
+        aStatsOut->myInputVertexCount = vertexCount;
+        aStatsOut->myOutputVertexCount = uniqueCount;
+        aStatsOut->myAcmrBefore = acmrBefore;
+        aStatsOut->myAcmrAfter = ComputeAcmr(indices, triangleCount * 3, uniqueCount);
+    }
+
+    MemFree(aMesh.vertices);
+    MemFree(aMesh.texcoords);
+    MemFree(aMesh.normals);
+
+    aMesh.vertexCount = indexed.vertexCount;
+    aMesh.vertices = indexed.vertices;
+    aMesh.texcoords = indexed.texcoords;
+    aMesh.normals = indexed.normals;
+    aMesh.indices = indexed.indices;
+
+    free(indices);
+    free(sourceVertices);
+
+    return true;
+}
+
+bool MeshOptimizer::Simplify(const Mesh& aSource, uint32_t aGridResolution, Mesh* aMeshOut)
+{
+    if (aSource.vertexCount <= 0 || aSource.triangleCount <= 0 || aGridResolution == 0U)
+    {
+        return false;
+    }
+
+    const uint32_t vertexCount = (uint32_t)aSource.vertexCount;
+    const uint32_t triangleCount = (uint32_t)aSource.triangleCount;
+
+    float minimum[3] = { INFINITY, INFINITY, INFINITY };
+    float maximum[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (uint32_t v = 0U; v < vertexCount; ++v)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            minimum[axis] = fminf(minimum[axis], aSource.vertices[v * 3 + axis]);
+            maximum[axis] = fmaxf(maximum[axis], aSource.vertices[v * 3 + axis]);
+        }
+    }
+
+    const float extent = fmaxf(maximum[0] - minimum[0], fmaxf(maximum[1] - minimum[1], maximum[2] - minimum[2]));
+    if (!(extent > 0.f))
+    {
+        return false;
+    }
+    const float inverseCellSize = (float)aGridResolution / extent;
+
+    /* Accumulate every vertex into its cell; texcoords come from the first vertex seen. */
+    Dictionary<uint64_t, uint32_t, HashCell> cellToCluster(vertexCount * 2U);
+    uint32_t* clusterOf = (uint32_t*)malloc(sizeof(uint32_t) * vertexCount);
+    uint32_t* clusterSize = (uint32_t*)calloc(vertexCount, sizeof(uint32_t));
+    uint32_t* sourceVertices = (uint32_t*)malloc(sizeof(uint32_t) * vertexCount);
+
+    Mesh clusters = {};
+    clusters.vertices = (float*)calloc(vertexCount * 3, sizeof(float));
+    clusters.texcoords = aSource.texcoords ? (float*)malloc(sizeof(float) * 2 * vertexCount) : nullptr;
+    clusters.normals = aSource.normals ? (float*)calloc(vertexCount * 3, sizeof(float)) : nullptr;
+
+    uint32_t clusterCount = 0U;
+    bool isOutOfMemory = false;
+    for (uint32_t v = 0U; v < vertexCount; ++v)
+    {
+        const float* p = aSource.vertices + v * 3;
+        uint64_t cell = 0U;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const uint64_t coord = (uint64_t)((p[axis] - minimum[axis]) * inverseCellSize);
+            cell = cell << 21 | (coord < aGridResolution ? coord : aGridResolution - 1U);
+        }
+
+        const uint32_t* existing = cellToCluster.Get(cell);
+        const uint32_t cluster = existing ? *existing : clusterCount;
+        if (!existing)
+        {
+            if (!cellToCluster.Insert(cell, clusterCount))
+            {
+                isOutOfMemory = true;
+                break;
+            }
+            sourceVertices[clusterCount] = clusterCount;
+            if (clusters.texcoords) memcpy(clusters.texcoords + cluster * 2, aSource.texcoords + v * 2, sizeof(float) * 2);
+            ++clusterCount;
+        }
+
+        clusterOf[v] = cluster;
+        ++clusterSize[cluster];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            clusters.vertices[cluster * 3 + axis] += p[axis];
+            if (clusters.normals) clusters.normals[cluster * 3 + axis] += aSource.normals[v * 3 + axis];
+        }
+    }
+
+    for (uint32_t c = 0U; c < clusterCount; ++c)
+    {
+        const float inverseSize = 1.f / (float)clusterSize[c];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            clusters.vertices[c * 3 + axis] *= inverseSize;
+        }
+
+        if (clusters.normals)
+        {
+            float* n = clusters.normals + c * 3;
+            const float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            const float inverseLength = length > 0.f ? 1.f / length : 0.f;
+            n[0] *= inverseLength;
+            n[1] *= inverseLength;
+            n[2] *= inverseLength;
+        }
+    }
+
+    /* Keep the triangles whose corners landed in three different cells, once per cell triple. */
+    Dictionary<uint64_t, uint32_t, HashCell> seenTriangles(triangleCount * 2U);
+    uint32_t* indices = (uint32_t*)malloc(sizeof(uint32_t) * triangleCount * 3);
+    uint32_t keptCount = 0U;
+
+    for (uint32_t t = 0U; !isOutOfMemory && t < triangleCount; ++t)
+    {
+        const uint32_t a = clusterOf[CornerVertex(aSource, t * 3)];
+        const uint32_t b = clusterOf[CornerVertex(aSource, t * 3 + 1)];
+        const uint32_t c = clusterOf[CornerVertex(aSource, t * 3 + 2)];
+        if (a == b || b == c || a == c)
+        {
+            continue;
+        }
+
+        const uint32_t low = a < b ? (a < c ? a : c) : (b < c ? b : c);
+        const uint32_t high = a > b ? (a > c ? a : c) : (b > c ? b : c);
+        const uint32_t middle = a ^ b ^ c ^ low ^ high;
+        const uint64_t key = (uint64_t)low << 42 | (uint64_t)middle << 21 | high;
+        if (seenTriangles.Get(key))
+        {
+            continue;
+        }
+        if (!seenTriangles.Insert(key, t))
+        {
+            isOutOfMemory = true;
+            break;
+        }
+
+        indices[keptCount * 3] = a;
+        indices[keptCount * 3 + 1] = b;
+        indices[keptCount * 3 + 2] = c;
+        ++keptCount;
+    }
+
+    const bool succeeded = !isOutOfMemory && keptCount > 0U && clusterCount <= MAX_INDEXED_VERTICES;
+    if (succeeded)
+    {
+        ReorderTriangles(indices, keptCount, clusterCount);
+        *aMeshOut = EmitIndexedMesh(clusters, sourceVertices, indices, keptCount, clusterCount);
+    }
+
+    free(clusters.vertices);
+    free(clusters.texcoords);
+    free(clusters.normals);
+    free(clusterOf);
+    free(clusterSize);
+    free(sourceVertices);
+    free(indices);
+
+    return succeeded;
+}
@@ -0,0 +1,48 @@
+#if !defined(MESHOPTIMIZER_H_)
+#define MESHOPTIMIZER_H_
+
+#pragma once
+
+#include <stdint.h>
+
+extern "C"
+{
+#include "../raylib/raylib.h"
+}
+
+/*
+* Import-time mesh processing. Runs on CPU-side meshes before they are uploaded,
+* so it is safe to call from loader threads and can be tested without a window.
+*/
+namespace MeshOptimizer
+{
+    struct Stats
+    {
+        uint32_t myInputVertexCount;
+        uint32_t myOutputVertexCount;
+        /* Average cache miss ratio: transformed vertices per triangle with a 16 entry FIFO cache. */
+        float myAcmrBefore;
+        float myAcmrAfter;
+    };
+
+    /*
+    * Welds identical vertices into an index buffer and reorders the triangles for
+    * post-transform cache locality (Forsyth's linear-speed algorithm), then the
+    * vertices in order of first use. Returns false and leaves the mesh untouched
+    * if it is already indexed or has more unique vertices than 16-bit indices allow.
+    */
+    bool Optimize(Mesh& aMesh, Stats* aStatsOut = nullptr);
+
+    /*
+    * Vertex clustering: snaps every vertex to a grid with aGridResolution cells
+    * along the longest bounding box axis, merges each cell into one averaged
+    * vertex and drops the triangles that collapse. Writes a new indexed and
+    * cache-optimized mesh to aMeshOut and leaves aSource untouched. Returns
+    * false if nothing is left, or if the result would not fit 16-bit indices.
+    */
+    bool Simplify(const Mesh& aSource, uint32_t aGridResolution, Mesh* aMeshOut);
+
+    float ComputeAcmr(const uint32_t* someIndices, uint32_t anIndexCount, uint32_t aVertexCount);
+}
+
+#endif // MESHOPTIMIZER_H_
\ No newline at end of file
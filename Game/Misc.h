@@ -46,4 +46,29 @@ struct HashInt
     }
 };
 
+/* Hashes a block of memory eight bytes at a time. Used to fingerprint file contents. */
+inline uint64_t HashMemory(const void* aData, size_t aSize)
+{
+	constexpr uint64_t multiplier = 0x9E3779B97F4A7C15ULL;
+
+	const uint8_t* bytes = (const uint8_t*)aData;
+	uint64_t hash = aSize * multiplier;
+
+	size_t i = 0;
+	for (; i + 8 <= aSize; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, bytes + i, sizeof(word));
+		hash = (hash ^ word) * multiplier;
+		hash ^= hash >> 29;
+	}
+	for (; i < aSize; ++i)
+	{
+		hash = (hash ^ bytes[i]) * multiplier;
+	}
+
+	hash ^= hash >> 32;
+	return hash;
+}
+
 #endif // MISC_H_
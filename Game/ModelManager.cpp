@@ -1,27 +1,420 @@
 #include "ModelManager.h"
 
 #include "../Utils/Dictionary.h"
+#include "../Utils/Profiler.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
 #include "Misc.h"
+#include "ObjLoader.h"
 
-#include <limits.h>
+#include <math.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define MODELMANAGER_NO_THREADS
+#endif
 
 namespace ModelManager
 {
+    constexpr uint32_t MAX_LOADER_THREADS = 8U;
+    constexpr float PLACEHOLDER_SIZE = 0.25f;
+
+    /* Clustering grid resolution per LOD level after the first. */
+    constexpr uint32_t LOD_GRID_RESOLUTIONS[MAX_MODEL_LODS - 1] = { 24U, 10U, 4U };
+    /* A level is only kept if it has at most this fraction of the previous level's triangles. */
+    constexpr float LOD_MIN_REDUCTION = 0.75f;
+
+    struct LoadRequest
+    {
+        ModelID myId;
+        StringWrapper32 myPath;
+    };
+
+    struct LoadResult
+    {
+        ModelID myId;
+        Mesh myLods[MAX_MODEL_LODS];
+        uint32_t myLodCount;
+        BoundingSphere myBounds;
+        bool mySucceeded;
+    };
+
+    struct ModelEntry
+    {
+        StringWrapper32 myPath;
+        Model myLods[MAX_MODEL_LODS];
+        uint32_t myLodCount;
+        BoundingSphere myBounds;
+        bool myIsLoaded;
+
+        uint32_t myRefCount;
+        uint64_t myMemoryBytes;
+        /* Update() count when the model was last requested or released, for LRU eviction. */
+        uint64_t myLastUsedFrame;
+    };
+
     struct Globals
     {
         Dictionary<StringWrapper32, ModelID, HashSW32> pathToIdMap;
-        Dictionary<ModelID, Model, HashInt> idToModelMap;
+        Dictionary<ModelID, ModelEntry, HashInt> idToModelMap;
+        Model placeholder;
+        BoundingSphere placeholderBounds;
+        uint32_t pendingCount;
+        /* Handed out in request order, so the same requests give the same IDs on every run. */
+        ModelID nextId;
+
+        uint64_t memoryBytes;
+        uint64_t memoryBudgetBytes;
+        uint64_t evictionCount;
+        uint64_t frame;
+
+        /* Reference counts change from every world's observers, which may tick on different threads. */
+        std::mutex refMutex;
+
+        /* Shared with the loader threads, guarded by queueMutex. */
+        std::mutex queueMutex;
+        std::condition_variable queueCondition;
+        std::deque<LoadRequest> requests;
+        std::deque<LoadResult> results;
+        bool stopLoaders;
+
+        std::thread loaders[MAX_LOADER_THREADS];
+        uint32_t loaderCount;
     } globals;
+
+    /* Sphere around the bounding box center. Not minimal, but cheap and stable. */
+    static BoundingSphere ComputeBounds(const Mesh& aMesh)
+    {
+        Vector3 minimum = { INFINITY, INFINITY, INFINITY };
+        Vector3 maximum = { -INFINITY, -INFINITY, -INFINITY };
+        for (int v = 0; v < aMesh.vertexCount; ++v)
+        {
+            const float* p = aMesh.vertices + v * 3;
+            minimum = { fminf(minimum.x, p[0]), fminf(minimum.y, p[1]), fminf(minimum.z, p[2]) };
+            maximum = { fmaxf(maximum.x, p[0]), fmaxf(maximum.y, p[1]), fmaxf(maximum.z, p[2]) };
+        }
+
+        BoundingSphere sphere;
+        sphere.myCenter = { (minimum.x + maximum.x) * 0.5f, (minimum.y + maximum.y) * 0.5f, (minimum.z + maximum.z) * 0.5f };
+
+        float radiusSquared = 0.f;
+        for (int v = 0; v < aMesh.vertexCount; ++v)
+        {
+            const float* p = aMesh.vertices + v * 3;
+            const float dx = p[0] - sphere.myCenter.x, dy = p[1] - sphere.myCenter.y, dz = p[2] - sphere.myCenter.z;
+            radiusSquared = fmaxf(radiusSquared, dx * dx + dy * dy + dz * dz);
+        }
+        sphere.myRadius = sqrtf(radiusSquared);
+
+        return sphere;
+    }
+
+    /* Appends simplified levels until the grid stops removing enough triangles. */
+    static void BuildLodChain(LoadResult& aResult)
+    {
+        for (uint32_t resolution : LOD_GRID_RESOLUTIONS)
+        {
+            const Mesh& previous = aResult.myLods[aResult.myLodCount - 1];
+
+            Mesh simplified = {};
+            if (!MeshOptimizer::Simplify(previous, resolution, &simplified))
+            {
+                break;
+            }
+            if (simplified.triangleCount > previous.triangleCount * LOD_MIN_REDUCTION)
+            {
+                ObjLoader::UnloadMeshData(simplified);
+                continue;
+            }
+
+            aResult.myLods[aResult.myLodCount++] = simplified;
+        }
+    }
+
+    /* Bytes of CPU-side vertex and index data. The GPU buffers raylib uploads the same arrays to are not counted. */
+    static uint64_t MeshBytes(const Mesh& aMesh)
+    {
+        const uint64_t vertexCount = (uint64_t)aMesh.vertexCount;
+
+        uint64_t bytes = 0U;
+        bytes += aMesh.vertices ? vertexCount * 3U * sizeof(float) : 0U;
+        bytes += aMesh.texcoords ? vertexCount * 2U * sizeof(float) : 0U;
+        bytes += aMesh.texcoords2 ? vertexCount * 2U * sizeof(float) : 0U;
+        bytes += aMesh.normals ? vertexCount * 3U * sizeof(float) : 0U;
+        bytes += aMesh.tangents ? vertexCount * 4U * sizeof(float) : 0U;
+        bytes += aMesh.colors ? vertexCount * 4U * sizeof(unsigned char) : 0U;
+        bytes += aMesh.indices ? (uint64_t)aMesh.triangleCount * 3U * sizeof(unsigned short) : 0U;
+
+        return bytes;
+    }
+
+    static void UnloadResult(LoadResult& aResult)
+    {
+        for (uint32_t lod = 0U; lod < aResult.myLodCount; ++lod)
+        {
+            ObjLoader::UnloadMeshData(aResult.myLods[lod]);
+        }
+        aResult.myLodCount = 0U;
+    }
+
+    static LoadResult ProcessRequest(const LoadRequest& aRequest)
+    {
+        LoadResult result;
+        result.myId = aRequest.myId;
+        result.myLodCount = 0U;
+        result.myBounds = globals.placeholderBounds;
+
+        /* The cache holds every LOD, so a hit skips both parsing and simplification. */
+        result.mySucceeded = MeshCache::Load(aRequest.myPath.str, result.myLods, MAX_MODEL_LODS, &result.myLodCount);
+        if (!result.mySucceeded && ObjLoader::LoadMesh(aRequest.myPath.str, &result.myLods[0]))
+        {
+            result.mySucceeded = true;
+            result.myLodCount = 1U;
+            BuildLodChain(result);
+            MeshCache::Save(aRequest.myPath.str, result.myLods, result.myLodCount);
+        }
+
+        if (result.mySucceeded)
+        {
+            result.myBounds = ComputeBounds(result.myLods[0]);
+        }
+
+        return result;
+    }
+
+    static void LoaderThread()
+    {
+        while (true)
+        {
+            LoadRequest request;
+            {
+                std::unique_lock<std::mutex> lock(globals.queueMutex);
+                globals.queueCondition.wait(lock, [] { return globals.stopLoaders || !globals.requests.empty(); });
+
+                if (globals.stopLoaders)
+                {
+                    return;
+                }
+
+                request = globals.requests.front();
+                globals.requests.pop_front();
+            }
+
+            const LoadResult result = ProcessRequest(request);
+
+            std::lock_guard<std::mutex> lock(globals.queueMutex);
+            globals.results.push_back(result);
+        }
+    }
+
+    static bool PopResult(LoadResult& aResultOut)
+    {
+        std::lock_guard<std::mutex> lock(globals.queueMutex);
+
+        if (!globals.results.empty())
+        {
+            aResultOut = globals.results.front();
+            globals.results.pop_front();
+            return true;
+        }
+
+        /* Without loader threads the requests are parsed on the main thread, inside the budget. */
+        if (globals.loaderCount == 0U && !globals.requests.empty())
+        {
+            const LoadRequest request = globals.requests.front();
+            globals.requests.pop_front();
+            aResultOut = ProcessRequest(request);
+            return true;
+        }
+
+        return false;
+    }
+
+    static void FinishLoad(LoadResult& aResult)
+    {
+        --globals.pendingCount;
+
+        ModelEntry* entry = globals.idToModelMap.Get(aResult.myId);
+        if (!entry || !aResult.mySucceeded)
+        {
+            TraceLog(LOG_WARNING, "MODELMANAGER: Failed to load model %d, keeping placeholder.", aResult.myId);
+            UnloadResult(aResult);
+            return;
+        }
+
+        entry->myMemoryBytes = 0U;
+        for (uint32_t lod = 0U; lod < aResult.myLodCount; ++lod)
+        {
+            UploadMesh(&aResult.myLods[lod], false);
+            entry->myLods[lod] = LoadModelFromMesh(aResult.myLods[lod]);
+            entry->myMemoryBytes += MeshBytes(aResult.myLods[lod]);
+        }
+        entry->myLodCount = aResult.myLodCount;
+        entry->myBounds = aResult.myBounds;
+        entry->myIsLoaded = true;
+        entry->myLastUsedFrame = globals.frame;
+
+        globals.memoryBytes += entry->myMemoryBytes;
+    }
+
+    struct EvictionCandidate
+    {
+        ModelID myId;
+        uint64_t myLastUsedFrame;
+        bool myIsFound;
+    };
+
+    /*
+    * Unloads idle models, least recently used first, until the budget is met.
+    * Models requested since the last Update() are spared, since their first
+    * reference may not have been counted yet. Evicted IDs become unknown; the
+    * next GetModelID() for the path loads it again under a new ID.
+    */
+    static void EvictIdleModels()
+    {
+        while (globals.memoryBudgetBytes > 0U && globals.memoryBytes > globals.memoryBudgetBytes)
+        {
+            /* Held from the idle check to the removal, so no world can add a reference to a model on its way out. */
+            std::lock_guard<std::mutex> lock(globals.refMutex);
+
+            EvictionCandidate candidate = { 0, UINT64_MAX, false };
+            auto callback = [](auto& anId, ModelEntry& anEntry, auto&, void* aData)
+            {
+                EvictionCandidate& oldest = *(EvictionCandidate*)aData;
+                const bool isIdle = anEntry.myIsLoaded && anEntry.myRefCount == 0U && anEntry.myLastUsedFrame < globals.frame;
+                const bool isOlder = anEntry.myLastUsedFrame < oldest.myLastUsedFrame
+                    || (anEntry.myLastUsedFrame == oldest.myLastUsedFrame && anId < oldest.myId);
+
+                if (isIdle && (!oldest.myIsFound || isOlder))
+                {
+                    oldest = { anId, anEntry.myLastUsedFrame, true };
+                }
+            };
+            globals.idToModelMap.ForEach(callback, &candidate);
+
+            if (!candidate.myIsFound)
+            {
+                return;
+            }
+
+            ModelEntry* entry = globals.idToModelMap.Get(candidate.myId);
+            for (uint32_t lod = 0U; lod < entry->myLodCount; ++lod)
+            {
+                UnloadModel(entry->myLods[lod]);
+            }
+            globals.memoryBytes -= entry->myMemoryBytes;
+            ++globals.evictionCount;
+
+            TraceLog(LOG_INFO, "MODELMANAGER: [%s] Evicted idle model %d.", entry->myPath.str, candidate.myId);
+
+            const StringWrapper32 path = entry->myPath;
+            globals.idToModelMap.Remove(candidate.myId);
+            globals.pathToIdMap.Remove(path);
+        }
+    }
+
+    static ModelID RequestLoad(const StringWrapper32& aPath)
+    {
+        const ModelID newId = globals.nextId++;
+        ModelEntry entry;
+        entry.myPath = aPath;
+        entry.myLodCount = 0U;
+        entry.myBounds = globals.placeholderBounds;
+        entry.myIsLoaded = false;
+        entry.myRefCount = 0U;
+        entry.myMemoryBytes = 0U;
+        entry.myLastUsedFrame = globals.frame;
+
+        /* Unknown IDs draw the placeholder, and the path is requested again next time. */
+        if (!globals.idToModelMap.Insert(newId, entry))
+        {
+            TraceLog(LOG_WARNING, "MODELMANAGER: [%s] Out of memory for the model table.", aPath.str);
+            return newId;
+        }
+        if (!globals.pathToIdMap.Insert(aPath, newId))
+        {
+            TraceLog(LOG_WARNING, "MODELMANAGER: [%s] Out of memory for the path table.", aPath.str);
+            globals.idToModelMap.Remove(newId);
+            return newId;
+        }
+        ++globals.pendingCount;
+
+        {
+            std::lock_guard<std::mutex> lock(globals.queueMutex);
+            globals.requests.push_back(LoadRequest{ newId, aPath });
+        }
+        globals.queueCondition.notify_one();
+
+        return newId;
+    }
+}
+
+void ModelManager::Init()
+{
+    /* Small so that it stays reasonable for models drawn at large scales. */
+    globals.placeholder = LoadModelFromMesh(GenMeshCube(PLACEHOLDER_SIZE, PLACEHOLDER_SIZE, PLACEHOLDER_SIZE));
+    globals.placeholderBounds = { { 0.f, 0.f, 0.f }, PLACEHOLDER_SIZE * 0.8660254f };
+    globals.pendingCount = 0U;
+    globals.nextId = 1;
+    globals.memoryBytes = 0U;
+    globals.evictionCount = 0U;
+    globals.frame = 0U;
+    globals.stopLoaders = false;
+    globals.loaderCount = 0U;
+
+    ObjLoader::Init();
+
+#if !defined(MODELMANAGER_NO_THREADS)
+    uint32_t threadCount = std::thread::hardware_concurrency();
+    threadCount = threadCount > 1U ? threadCount - 1U : 1U;
+    threadCount = threadCount < MAX_LOADER_THREADS ? threadCount : MAX_LOADER_THREADS;
+
+    for (; globals.loaderCount < threadCount; ++globals.loaderCount)
+    {
+        globals.loaders[globals.loaderCount] = std::thread(LoaderThread);
+    }
+#endif
+}
+
+void ModelManager::Update(double aBudgetSeconds)
+{
+    PROFILE_ZONE("ModelManager::Update");
+
+    const double startTime = GetTime();
+
+    LoadResult result;
+    while (GetTime() - startTime < aBudgetSeconds && PopResult(result))
+    {
+        FinishLoad(result);
+    }
+
+    EvictIdleModels();
+    ++globals.frame;
+}
+
+void ModelManager::Flush()
+{
+    LoadResult result;
+    while (globals.pendingCount > 0U)
+    {
+        if (PopResult(result))
+        {
+            FinishLoad(result);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
 }
 
 void ModelManager::Preload(const char* const aPath)
 {
-    StringWrapper32 wrapper;
-    strcpy(wrapper.str, aPath);
-    
-    ModelID newId = GetRandomValue(0, INT_MAX);
-    globals.pathToIdMap.Insert(wrapper, newId);
-    globals.idToModelMap.Insert(newId, LoadModel(aPath));
+    GetModelID(aPath);
 }
 
 ModelID ModelManager::GetModelID(const char* const aPath)
@@ -32,31 +425,171 @@ ModelID ModelManager::GetModelID(const char* const aPath)
 
     if (ptr)
     {
+        globals.idToModelMap.Get(*ptr)->myLastUsedFrame = globals.frame;
         return *ptr;
     }
     else
     {
-        ModelID newId = GetRandomValue(0, INT_MAX);
-        globals.pathToIdMap.Insert(wrapper, newId);
-        globals.idToModelMap.Insert(newId, LoadModel(aPath));
-
-        return newId;
+        return RequestLoad(wrapper);
     }
 }
 
 Model* ModelManager::GetModel(ModelID anId)
 {
-    return globals.idToModelMap.Get(anId);
+    return GetModel(anId, 0U);
+}
+
+Model* ModelManager::GetModel(ModelID anId, uint32_t aLod)
+{
+    ModelEntry* entry = globals.idToModelMap.Get(anId);
+    if (!entry)
+    {
+        return nullptr;
+    }
+    if (!entry->myIsLoaded)
+    {
+        return &globals.placeholder;
+    }
+
+    return &entry->myLods[aLod < entry->myLodCount ? aLod : entry->myLodCount - 1];
+}
+
+const char* ModelManager::GetModelPath(ModelID anId)
+{
+    const ModelEntry* entry = globals.idToModelMap.Get(anId);
+
+    return entry ? entry->myPath.str : nullptr;
+}
+
+uint32_t ModelManager::GetLodCount(ModelID anId)
+{
+    const ModelEntry* entry = globals.idToModelMap.Get(anId);
+
+    return entry && entry->myIsLoaded ? entry->myLodCount : 1U;
+}
+
+bool ModelManager::IsLoaded(ModelID anId)
+{
+    const ModelEntry* entry = globals.idToModelMap.Get(anId);
+
+    return entry && entry->myIsLoaded;
+}
+
+BoundingSphere ModelManager::GetBoundingSphere(ModelID anId)
+{
+    const ModelEntry* entry = globals.idToModelMap.Get(anId);
+
+    return entry && entry->myIsLoaded ? entry->myBounds : globals.placeholderBounds;
+}
+
+uint32_t ModelManager::GetPendingCount()
+{
+    return globals.pendingCount;
+}
+
+void ModelManager::AddRef(ModelID anId)
+{
+    std::lock_guard<std::mutex> lock(globals.refMutex);
+    ModelEntry* entry = globals.idToModelMap.Get(anId);
+    if (entry)
+    {
+        ++entry->myRefCount;
+    }
+}
+
+void ModelManager::Release(ModelID anId)
+{
+    std::lock_guard<std::mutex> lock(globals.refMutex);
+    ModelEntry* entry = globals.idToModelMap.Get(anId);
+    if (!entry)
+    {
+        return;
+    }
+
+    assert(entry->myRefCount > 0U && "Releasing a model that has no references.");
+    if (entry->myRefCount > 0U && --entry->myRefCount == 0U)
+    {
+        entry->myLastUsedFrame = globals.frame;
+    }
+}
+
+uint32_t ModelManager::GetRefCount(ModelID anId)
+{
+    std::lock_guard<std::mutex> lock(globals.refMutex);
+    const ModelEntry* entry = globals.idToModelMap.Get(anId);
+
+    return entry ? entry->myRefCount : 0U;
+}
+
+uint64_t ModelManager::GetMemoryUsage(ModelID anId)
+{
+    const ModelEntry* entry = globals.idToModelMap.Get(anId);
+
+    return entry ? entry->myMemoryBytes : 0U;
+}
+
+void ModelManager::SetMemoryBudget(uint64_t aBudgetBytes)
+{
+    globals.memoryBudgetBytes = aBudgetBytes;
+}
+
+ModelManager::Stats ModelManager::GetStats()
+{
+    Stats stats;
+    stats.myModelCount = (uint32_t)globals.idToModelMap.Size();
+    stats.myLoadedCount = 0U;
+    stats.myIdleCount = 0U;
+    stats.myPendingCount = globals.pendingCount;
+    stats.myMemoryBytes = globals.memoryBytes;
+    stats.myMemoryBudgetBytes = globals.memoryBudgetBytes;
+    stats.myEvictionCount = globals.evictionCount;
+
+    auto callback = [](auto&, ModelEntry& anEntry, auto&, void* aData)
+    {
+        Stats& out = *(Stats*)aData;
+        out.myLoadedCount += anEntry.myIsLoaded ? 1U : 0U;
+        out.myIdleCount += anEntry.myIsLoaded && anEntry.myRefCount == 0U ? 1U : 0U;
+    };
+    globals.idToModelMap.ForEach(callback, &stats);
+
+    return stats;
 }
 
 void ModelManager::Terminate()
 {
-    auto callback = [](auto&, Model& m, auto&)
     {
-        UnloadModel(m);
+        std::lock_guard<std::mutex> lock(globals.queueMutex);
+        globals.stopLoaders = true;
+    }
+    globals.queueCondition.notify_all();
+
+    for (uint32_t i = 0U; i < globals.loaderCount; ++i)
+    {
+        globals.loaders[i].join();
+    }
+    globals.loaderCount = 0U;
+
+    ObjLoader::Terminate();
+
+    for (LoadResult& result : globals.results)
+    {
+        UnloadResult(result);
+    }
+    globals.results.clear();
+    globals.requests.clear();
+
+    auto callback = [](auto&, ModelEntry& e, auto&)
+    {
+        for (uint32_t lod = 0U; e.myIsLoaded && lod < e.myLodCount; ++lod)
+        {
+            UnloadModel(e.myLods[lod]);
+        }
     };
     globals.idToModelMap.ForEach(callback);
+    UnloadModel(globals.placeholder);
 
     globals.pathToIdMap.Clear();
     globals.idToModelMap.Clear();
+    globals.pendingCount = 0U;
+    globals.memoryBytes = 0U;
 }
\ No newline at end of file
@@ -3,19 +3,85 @@
 
 #pragma once
 
+#include <stdint.h>
+
 extern "C"
 {
 #include "../raylib/raylib.h"
 }
 
+/*
+* Models are loaded asynchronously. Requesting a path returns its ModelID right
+* away, loader threads parse the file, and Update() finishes the GPU upload on
+* the main thread. Until then GetModel() hands out a placeholder model.
+*
+* Loaded models are kept while referenced. Once a memory budget is set,
+* Update() unloads unreferenced models, least recently used first, whenever
+* the loaded total is over it.
+*
+* Loading, uploading and eviction only happen on the main thread. Between
+* those calls the models are read-only, so lookups by ID may come from any
+* thread, and AddRef()/Release() are safe everywhere; this is what lets
+* several Game worlds tick in parallel over the same models.
+*/
 typedef int ModelID;
+
+/* Level 0 is the imported mesh; each further level is a coarser simplification of it. */
+constexpr uint32_t MAX_MODEL_LODS = 4U;
+
+struct BoundingSphere
+{
+    Vector3 myCenter;
+    float myRadius;
+};
+
 namespace ModelManager
 {
+    struct Stats
+    {
+        uint32_t myModelCount;
+        uint32_t myLoadedCount;
+        uint32_t myPendingCount;
+        /* Loaded but unreferenced, so eligible for eviction. */
+        uint32_t myIdleCount;
+        uint64_t myMemoryBytes;
+        uint64_t myMemoryBudgetBytes;
+        uint64_t myEvictionCount;
+    };
+
+    void Init();
+    /* Uploads finished loads to the GPU until aBudgetSeconds has passed. Main thread only. */
+    void Update(double aBudgetSeconds);
+    /* Blocks until every requested model is loaded and uploaded. Main thread only. */
+    void Flush();
+
     void Preload(const char* const aPath);
     ModelID GetModelID(const char* const aPath);
+    /* IDs are only valid for this run; the path is what identifies a model across runs. */
+    const char* GetModelPath(ModelID anId);
     Model* GetModel(ModelID anId);
+    /* aLod is clamped to the coarsest level the model has. */
+    Model* GetModel(ModelID anId, uint32_t aLod);
+    uint32_t GetLodCount(ModelID anId);
+    bool IsLoaded(ModelID anId);
+    /* Model-space bounds, computed once at load. Unloaded models report the placeholder's bounds. */
+    BoundingSphere GetBoundingSphere(ModelID anId);
+    uint32_t GetPendingCount();
+
+    /* One reference per user, e.g. per ModelComponent. Unknown IDs are ignored. */
+    void AddRef(ModelID anId);
+    void Release(ModelID anId);
+    uint32_t GetRefCount(ModelID anId);
+    /*
+    * CPU-side vertex and index bytes of every LOD; 0 until loaded. The copies
+    * in GPU buffers are not counted, here or against the memory budget.
+    */
+    uint64_t GetMemoryUsage(ModelID anId);
+    /* 0, the default, never evicts. */
+    void SetMemoryBudget(uint64_t aBudgetBytes);
+    Stats GetStats();
 
     void Terminate();
 }
 
-#endif // MODELMANAGER_H_
+#endif // MODELMANAGER_H_
\ No newline at end of file
@@ -0,0 +1,477 @@
+#include "ObjLoader.h"
+
+#include "MeshOptimizer.h"
+#include "../Utils/JobSystem.h"
+#include "../Utils/MappedFile.h"
+
+#include <stdint.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mutex>
+
+namespace ObjLoader
+{
+    /* Files are split into line-aligned chunks of at least this size, each parsed by its own job. */
+    constexpr size_t MIN_CHUNK_BYTES = 256U * 1024U;
+    constexpr uint32_t MAX_CHUNKS = 16U;
+
+    struct Counts
+    {
+        uint32_t positions;
+        uint32_t texcoords;
+        uint32_t normals;
+        uint32_t triangles;
+    };
+
+    struct Chunk
+    {
+        const char* myBegin;
+        const char* myEnd;
+        /* Elements inside this chunk, and in all chunks before it. */
+        Counts myCounts;
+        Counts myOffsets;
+    };
+
+    struct ParseTarget
+    {
+        float* positions;
+        float* texcoords;
+        float* normals;
+        /* Resolved position/texcoord/normal indices, three corners per triangle. */
+        int32_t* corners;
+    };
+
+    /* Loader threads parse files concurrently, but only one of them may drive the pool at a time. */
+    static JobSystem ourJobSystem;
+    static std::mutex ourJobSystemMutex;
+
+    static const double ourPowersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    static bool IsDigit(char aChar)
+    {
+        return (unsigned char)(aChar - '0') < 10U;
+    }
+
+    static const char* SkipSpaces(const char* aCursor, const char* anEnd)
+    {
+        while (aCursor < anEnd && (*aCursor == ' ' || *aCursor == '\t')) ++aCursor;
+        return aCursor;
+    }
+
+    static const char* LineEnd(const char* aCursor, const char* anEnd)
+    {
+        const char* end = (const char*)memchr(aCursor, '\n', anEnd - aCursor);
+        return end ? end : anEnd;
+    }
+
+    static bool IsEndOfLine(const char* aCursor, const char* aLineEnd)
+    {
+        return aCursor >= aLineEnd || *aCursor == '\r' || *aCursor == '#';
+    }
+
+    /* Locale-independent decimal parser, much cheaper than strtof for the plain numbers OBJ exporters write. */
+    static const char* ParseFloat(const char* aCursor, const char* aLineEnd, float& aValueOut)
+    {
+        aCursor = SkipSpaces(aCursor, aLineEnd);
+
+        bool negative = false;
+        if (aCursor < aLineEnd && (*aCursor == '-' || *aCursor == '+'))
+        {
+            negative = *aCursor++ == '-';
+        }
+
+        uint64_t mantissa = 0U;
+        int exponent = 0;
+        int digits = 0;
+        for (; aCursor < aLineEnd && IsDigit(*aCursor); ++aCursor)
+        {
+            if (digits++ < 19) mantissa = mantissa * 10U + (uint64_t)(*aCursor - '0');
+            else ++exponent;
+        }
+        if (aCursor < aLineEnd && *aCursor == '.')
+        {
+            for (++aCursor; aCursor < aLineEnd && IsDigit(*aCursor); ++aCursor)
+            {
+                if (digits++ < 19)
+                {
+                    mantissa = mantissa * 10U + (uint64_t)(*aCursor - '0');
+                    --exponent;
+                }
+            }
+        }
+        if (aCursor < aLineEnd && (*aCursor == 'e' || *aCursor == 'E'))
+        {
+            ++aCursor;
+            bool negativeExponent = false;
+            if (aCursor < aLineEnd && (*aCursor == '-' || *aCursor == '+'))
+            {
+                negativeExponent = *aCursor++ == '-';
+            }
+            int value = 0;
+            for (; aCursor < aLineEnd && IsDigit(*aCursor); ++aCursor)
+            {
+                value = value < 10000 ? value * 10 + (*aCursor - '0') : value;
+            }
+            exponent += negativeExponent ? -value : value;
+        }
+
+        double value = (double)mantissa;
+        if (exponent < 0)
+        {
+            value = exponent >= -22 ? value / ourPowersOfTen[-exponent] : value * pow(10.0, exponent);
+        }
+        else if (exponent > 0)
+        {
+            value = exponent <= 22 ? value * ourPowersOfTen[exponent] : value * pow(10.0, exponent);
+        }
+
+        aValueOut = (float)(negative ? -value : value);
+        return aCursor;
+    }
+
+    static const char* ParseInt(const char* aCursor, const char* aLineEnd, int64_t& aValueOut)
+    {
+        bool negative = false;
+        if (aCursor < aLineEnd && (*aCursor == '-' || *aCursor == '+'))
+        {
+            negative = *aCursor++ == '-';
+        }
+
+        int64_t value = 0;
+        for (; aCursor < aLineEnd && IsDigit(*aCursor); ++aCursor)
+        {
+            value = value * 10 + (*aCursor - '0');
+        }
+
+        aValueOut = negative ? -value : value;
+        return aCursor;
+    }
+
+    /* Converts a 1-based (or negative, relative) OBJ index to a 0-based one. */
+    static int32_t ResolveIndex(int64_t anIndex, uint32_t aCount)
+    {
+        if (anIndex > 0) return (int32_t)(anIndex - 1);
+        if (anIndex < 0) return (int32_t)((int64_t)aCount + anIndex);
+        return -1;
+    }
+
+    static uint32_t CountFaceCorners(const char* aCursor, const char* aLineEnd)
+    {
+        uint32_t corners = 0U;
+        aCursor = SkipSpaces(aCursor, aLineEnd);
+        while (!IsEndOfLine(aCursor, aLineEnd))
+        {
+            ++corners;
+            while (!IsEndOfLine(aCursor, aLineEnd) && *aCursor != ' ' && *aCursor != '\t') ++aCursor;
+            aCursor = SkipSpaces(aCursor, aLineEnd);
+        }
+        return corners;
+    }
+
+    static const char* ParseCorner(const char* aCursor, const char* aLineEnd, const Counts& someSeen, int32_t* aCornerOut)
+    {
+        int64_t index;
+        aCursor = ParseInt(aCursor, aLineEnd, index);
+        aCornerOut[0] = ResolveIndex(index, someSeen.positions);
+        aCornerOut[1] = -1;
+        aCornerOut[2] = -1;
+
+        if (aCursor < aLineEnd && *aCursor == '/')
+        {
+            ++aCursor;
+            if (aCursor < aLineEnd && *aCursor != '/')
+            {
+                aCursor = ParseInt(aCursor, aLineEnd, index);
+                aCornerOut[1] = ResolveIndex(index, someSeen.texcoords);
+            }
+            if (aCursor < aLineEnd && *aCursor == '/')
+            {
+                aCursor = ParseInt(aCursor + 1, aLineEnd, index);
+                aCornerOut[2] = ResolveIndex(index, someSeen.normals);
+            }
+        }
+
+        while (!IsEndOfLine(aCursor, aLineEnd) && *aCursor != ' ' && *aCursor != '\t') ++aCursor;
+        return SkipSpaces(aCursor, aLineEnd);
+    }
+
+    static void CountChunk(Chunk& aChunk)
+    {
+        Counts counts{ 0, 0, 0, 0 };
+
+        for (const char* line = aChunk.myBegin; line < aChunk.myEnd;)
+        {
+            const char* lineEnd = LineEnd(line, aChunk.myEnd);
+            line = SkipSpaces(line, lineEnd);
+
+            if (lineEnd - line > 1)
+            {
+                if (line[0] == 'v' && line[1] == ' ') ++counts.positions;
+                else if (line[0] == 'v' && line[1] == 't') ++counts.texcoords;
+                else if (line[0] == 'v' && line[1] == 'n') ++counts.normals;
+                else if (line[0] == 'f' && line[1] == ' ')
+                {
+                    const uint32_t corners = CountFaceCorners(line + 1, lineEnd);
+                    if (corners >= 3) counts.triangles += corners - 2;
+                }
+            }
+
+            line = lineEnd + 1;
+        }
+
+        aChunk.myCounts = counts;
+    }
+
+    static void ParseChunk(const Chunk& aChunk, const ParseTarget& aTarget)
+    {
+        /* Running totals including all earlier chunks, needed for relative face indices. */
+        Counts seen = aChunk.myOffsets;
+
+        for (const char* line = aChunk.myBegin; line < aChunk.myEnd;)
+        {
+            const char* lineEnd = LineEnd(line, aChunk.myEnd);
+            line = SkipSpaces(line, lineEnd);
+
+            if (lineEnd - line > 1)
+            {
+                if (line[0] == 'v' && line[1] == ' ')
+                {
+                    float* p = aTarget.positions + seen.positions++ * 3;
+                    const char* cursor = ParseFloat(line + 1, lineEnd, p[0]);
+                    cursor = ParseFloat(cursor, lineEnd, p[1]);
+                    ParseFloat(cursor, lineEnd, p[2]);
+                }
+                else if (line[0] == 'v' && line[1] == 't')
+                {
+                    float* t = aTarget.texcoords + seen.texcoords++ * 2;
+                    const char* cursor = ParseFloat(line + 2, lineEnd, t[0]);
+                    ParseFloat(cursor, lineEnd, t[1]);
+                    t[1] = 1.0f - t[1];
+                }
+                else if (line[0] == 'v' && line[1] == 'n')
+                {
+                    float* n = aTarget.normals + seen.normals++ * 3;
+                    const char* cursor = ParseFloat(line + 2, lineEnd, n[0]);
+                    cursor = ParseFloat(cursor, lineEnd, n[1]);
+                    ParseFloat(cursor, lineEnd, n[2]);
+                }
+                else if (line[0] == 'f' && line[1] == ' ')
+                {
+                    /* Triangulate polygons as a fan around the first corner. */
+                    int32_t first[3], previous[3];
+                    const char* cursor = ParseCorner(SkipSpaces(line + 1, lineEnd), lineEnd, seen, first);
+                    if (!IsEndOfLine(cursor, lineEnd))
+                    {
+                        cursor = ParseCorner(cursor, lineEnd, seen, previous);
+                    }
+
+                    while (!IsEndOfLine(cursor, lineEnd))
+                    {
+                        int32_t* triangle = aTarget.corners + seen.triangles++ * 9;
+                        memcpy(triangle, first, sizeof(first));
+                        memcpy(triangle + 3, previous, sizeof(previous));
+                        cursor = ParseCorner(cursor, lineEnd, seen, triangle + 6);
+                        memcpy(previous, triangle + 6, sizeof(previous));
+                    }
+                }
+            }
+
+            line = lineEnd + 1;
+        }
+    }
+
+    static void ComputeFlatNormal(const float* aTriangle, float* aNormalsOut)
+    {
+        const float e0[3] = { aTriangle[3] - aTriangle[0], aTriangle[4] - aTriangle[1], aTriangle[5] - aTriangle[2] };
+        const float e1[3] = { aTriangle[6] - aTriangle[0], aTriangle[7] - aTriangle[1], aTriangle[8] - aTriangle[2] };
+        float n[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+        float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length > 0.f)
+        {
+            n[0] /= length; n[1] /= length; n[2] /= length;
+        }
+
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            memcpy(aNormalsOut + corner * 3, n, sizeof(n));
+        }
+    }
+
+    static void ExpandTriangles(const ParseTarget& aSource, const Counts& someTotals, Mesh& aMesh, uint32_t aFirstTriangle, uint32_t anEndTriangle)
+    {
+        for (uint32_t tri = aFirstTriangle; tri < anEndTriangle; ++tri)
+        {
+            const int32_t* corners = aSource.corners + tri * 9;
+            bool hasNormals = true;
+
+            for (uint32_t corner = 0; corner < 3; ++corner)
+            {
+                const int32_t* c = corners + corner * 3;
+                const uint32_t v = tri * 3 + corner;
+
+                if ((uint32_t)c[0] < someTotals.positions) memcpy(aMesh.vertices + v * 3, aSource.positions + c[0] * 3, sizeof(float) * 3);
+                else memset(aMesh.vertices + v * 3, 0, sizeof(float) * 3);
+                /* Faces without texture coordinates, or files without any, map to the texture origin. */
+                if ((uint32_t)c[1] < someTotals.texcoords) memcpy(aMesh.texcoords + v * 2, aSource.texcoords + c[1] * 2, sizeof(float) * 2);
+                else memset(aMesh.texcoords + v * 2, 0, sizeof(float) * 2);
+                if ((uint32_t)c[2] < someTotals.normals) memcpy(aMesh.normals + v * 3, aSource.normals + c[2] * 3, sizeof(float) * 3);
+                else hasNormals = false;
+            }
+
+            if (!hasNormals)
+            {
+                ComputeFlatNormal(aMesh.vertices + tri * 9, aMesh.normals + tri * 9);
+            }
+        }
+    }
+
+    /* Runs aJob(0..aCount-1) on the pool, or on the calling thread when another file holds it. */
+    template <class Job>
+    static void RunParallel(uint32_t aCount, const Job& aJob)
+    {
+        std::unique_lock<std::mutex> lock(ourJobSystemMutex, std::try_to_lock);
+        if (!lock.owns_lock())
+        {
+            for (uint32_t i = 0; i < aCount; ++i)
+            {
+                aJob(i);
+            }
+            return;
+        }
+
+        ourJobSystem.ParallelFor(aCount, 1U, [&aJob](uint32_t aBegin, uint32_t anEnd)
+        {
+            for (uint32_t i = aBegin; i < anEnd; ++i)
+            {
+                aJob(i);
+            }
+        });
+    }
+
+    static uint32_t SplitIntoChunks(const char* aText, size_t aSize, Chunk* someChunksOut)
+    {
+        uint32_t chunkCount = (uint32_t)(aSize / MIN_CHUNK_BYTES);
+        const uint32_t threadCount = ourJobSystem.GetWorkerCount() + 1U;
+        chunkCount = chunkCount < threadCount ? chunkCount : threadCount;
+        chunkCount = chunkCount < MAX_CHUNKS ? chunkCount : MAX_CHUNKS;
+        chunkCount = chunkCount > 0U ? chunkCount : 1U;
+
+        const char* const end = aText + aSize;
+        const char* begin = aText;
+        for (uint32_t i = 0; i < chunkCount; ++i)
+        {
+            const char* chunkEnd = (i + 1 == chunkCount) ? end : LineEnd(aText + aSize * (i + 1) / chunkCount, end);
+            chunkEnd = chunkEnd < end ? chunkEnd + 1 : end;
+            chunkEnd = chunkEnd > begin ? chunkEnd : begin;
+
+            someChunksOut[i].myBegin = begin;
+            someChunksOut[i].myEnd = chunkEnd;
+            begin = chunkEnd;
+        }
+
+        return chunkCount;
+    }
+
+    static bool ParseObj(const char* aText, size_t aSize, Mesh* aMeshOut)
+    {
+        Chunk chunks[MAX_CHUNKS];
+        const uint32_t chunkCount = SplitIntoChunks(aText, aSize, chunks);
+
+        RunParallel(chunkCount, [&chunks](uint32_t i) { CountChunk(chunks[i]); });
+
+        Counts totals{ 0, 0, 0, 0 };
+        for (uint32_t i = 0; i < chunkCount; ++i)
+        {
+            chunks[i].myOffsets = totals;
+            totals.positions += chunks[i].myCounts.positions;
+            totals.texcoords += chunks[i].myCounts.texcoords;
+            totals.normals += chunks[i].myCounts.normals;
+            totals.triangles += chunks[i].myCounts.triangles;
+        }
+
+        if (totals.triangles == 0U)
+        {
+            return false;
+        }
+
+        ParseTarget target;
+        target.positions = (float*)malloc(sizeof(float) * 3 * (totals.positions + 1));
+        target.texcoords = (float*)malloc(sizeof(float) * 2 * (totals.texcoords + 1));
+        target.normals = (float*)malloc(sizeof(float) * 3 * (totals.normals + 1));
+        target.corners = (int32_t*)malloc(sizeof(int32_t) * 9 * totals.triangles);
+
+        RunParallel(chunkCount, [&chunks, &target](uint32_t i) { ParseChunk(chunks[i], target); });
+
+        const int vertexCount = (int)totals.triangles * 3;
+        aMeshOut->vertexCount = vertexCount;
+        aMeshOut->triangleCount = (int)totals.triangles;
+        aMeshOut->vertices = (float*)MemAlloc(sizeof(float) * 3 * vertexCount);
+        aMeshOut->texcoords = (float*)MemAlloc(sizeof(float) * 2 * vertexCount);
+        aMeshOut->normals = (float*)MemAlloc(sizeof(float) * 3 * vertexCount);
+
+        RunParallel(chunkCount, [&](uint32_t i)
+        {
+            ExpandTriangles(target, totals, *aMeshOut, totals.triangles * i / chunkCount, totals.triangles * (i + 1) / chunkCount);
+        });
+
+        free(target.positions);
+        free(target.texcoords);
+        free(target.normals);
+        free(target.corners);
+
+        return true;
+    }
+}
+
+void ObjLoader::Init()
+{
+    /* Chunks beyond MAX_CHUNKS are never made, so more workers would only idle. */
+    const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    const uint32_t workerCount = hardwareThreads > 1U ? hardwareThreads - 1U : 0U;
+    ourJobSystem.Init(workerCount < MAX_CHUNKS - 1U ? workerCount : MAX_CHUNKS - 1U);
+}
+
+void ObjLoader::Terminate()
+{
+    ourJobSystem.Terminate();
+}
+
+bool ObjLoader::LoadMesh(const char* const aPath, Mesh* aMeshOut)
+{
+    memset(aMeshOut, 0, sizeof(Mesh));
+
+    MappedFile file;
+    if (!file.Open(aPath))
+    {
+        return false;
+    }
+
+    if (!ParseObj(file.Data(), file.Size(), aMeshOut))
+    {
+        return false;
+    }
+
+    MeshOptimizer::Stats stats;
+    if (MeshOptimizer::Optimize(*aMeshOut, &stats))
+    {
+        TraceLog(LOG_INFO, "OBJLOADER: [%s] Welded %u vertices to %u, ACMR %.2f -> %.2f", aPath,
+            stats.myInputVertexCount, stats.myOutputVertexCount, stats.myAcmrBefore, stats.myAcmrAfter);
+    }
+
+    return true;
+}
+
+void ObjLoader::UnloadMeshData(Mesh& aMesh)
+{
+    MemFree(aMesh.vertices);
+    MemFree(aMesh.texcoords);
+    MemFree(aMesh.normals);
+    MemFree(aMesh.indices);
+    memset(&aMesh, 0, sizeof(Mesh));
+}
\ No newline at end of file
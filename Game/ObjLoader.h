@@ -0,0 +1,31 @@
+#if !defined(OBJLOADER_H_)
+#define OBJLOADER_H_
+
+#pragma once
+
+extern "C"
+{
+#include "../raylib/raylib.h"
+}
+
+/*
+* CPU-side Wavefront OBJ parsing. Does not touch the GPU, so it is safe to call
+* from any thread; the resulting mesh has to be uploaded on the main thread.
+*/
+namespace ObjLoader
+{
+    /*
+    * Starts the pool that parses large files in chunks. Without it, or while
+    * another thread is using it, files are parsed on the calling thread.
+    */
+    void Init();
+    void Terminate();
+
+    /* Fills aMeshOut with welded, cache-optimized triangles. Returns false if the file could not be read. */
+    bool LoadMesh(const char* const aPath, Mesh* aMeshOut);
+
+    /* Frees the CPU arrays of a mesh that was never uploaded. */
+    void UnloadMeshData(Mesh& aMesh);
+}
+
+#endif // OBJLOADER_H_
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "Replication.h"
+
+#include "../ECS/DeltaCodec.h"
+
+namespace Replication
+{
+    constexpr uint32_t DELTA_MAGIC = 0x41544C44; // "DLTA"
+
+    static void EncodeTransform(ByteWriter* aWriter, const TransformComponent& aTransform)
+    {
+        DeltaCodec::WriteQuantized(aWriter, aTransform.myPosition, POSITION_MIN, POSITION_MAX);
+    }
+
+    static void DecodeTransform(ByteReader* aReader, TransformComponent& aTransform)
+    {
+        aTransform.myPosition = DeltaCodec::ReadQuantized(aReader, POSITION_MIN, POSITION_MAX);
+    }
+
+    static void EncodeMovement(ByteWriter* aWriter, const MovementComponent& aMovement)
+    {
+        aWriter->WriteFloat(aMovement.myVelocity.x);
+        aWriter->WriteFloat(aMovement.myVelocity.y);
+        aWriter->WriteFloat(aMovement.myVelocity.z);
+    }
+
+    static void DecodeMovement(ByteReader* aReader, MovementComponent& aMovement)
+    {
+        aMovement.myVelocity.x = aReader->ReadFloat();
+        aMovement.myVelocity.y = aReader->ReadFloat();
+        aMovement.myVelocity.z = aReader->ReadFloat();
+    }
+
+    static void EncodeModel(ByteWriter* aWriter, const ModelComponent& aModel)
+    {
+        aWriter->WriteU32((uint32_t)aModel.myModel);
+        aWriter->WriteBytes(&aModel.myColor, sizeof(aModel.myColor));
+        aWriter->WriteFloat(aModel.myScale);
+    }
+
+    static void DecodeModel(ByteReader* aReader, ModelComponent& aModel)
+    {
+        aModel.myModel = (ModelID)aReader->ReadU32();
+        aReader->ReadBytes(&aModel.myColor, sizeof(aModel.myColor));
+        aModel.myScale = aReader->ReadFloat();
+    }
+}
+
+void Replication::EncodeDelta(
+    ComponentList<TransformComponent>* someTransformComps,
+    ComponentList<MovementComponent>* someMovementComps,
+    ComponentList<ModelComponent>* someModelComps,
+    uint32_t aSinceVersion,
+    uint32_t aVersion,
+    ByteWriter* aWriter)
+{
+    aWriter->WriteU32(DELTA_MAGIC);
+    aWriter->WriteU32(aSinceVersion);
+    aWriter->WriteU32(aVersion);
+
+    DeltaCodec::EncodeList(someTransformComps, aSinceVersion, aWriter, EncodeTransform);
+    DeltaCodec::EncodeList(someMovementComps, aSinceVersion, aWriter, EncodeMovement);
+    DeltaCodec::EncodeList(someModelComps, aSinceVersion, aWriter, EncodeModel);
+}
+
+bool Replication::ApplyDelta(const uint8_t* aData, size_t aSize, Replica* aReplica)
+{
+    ByteReader reader(aData, aSize);
+
+    const uint32_t magic = reader.ReadU32();
+    const uint32_t sinceVersion = reader.ReadU32();
+    const uint32_t version = reader.ReadU32();
+    if (reader.HasFailed() || magic != DELTA_MAGIC || sinceVersion > aReplica->myVersion)
+    {
+        return false;
+    }
+
+    /* Read through once before anything is applied, so a malformed or truncated delta leaves the replica as it was. */
+    ByteReader validator = reader;
+    bool succeeded = DeltaCodec::ValidateList<TransformComponent>(&validator, DecodeTransform);
+    succeeded = succeeded && DeltaCodec::ValidateList<MovementComponent>(&validator, DecodeMovement);
+    succeeded = succeeded && DeltaCodec::ValidateList<ModelComponent>(&validator, DecodeModel);
+    if (!succeeded || !validator.IsAtEnd())
+    {
+        return false;
+    }
+
+    succeeded = DeltaCodec::DecodeList(&reader, &aReplica->myTransformComponents, DecodeTransform);
+    succeeded = succeeded && DeltaCodec::DecodeList(&reader, &aReplica->myMovementComponents, DecodeMovement);
+    succeeded = succeeded && DeltaCodec::DecodeList(&reader, &aReplica->myModelComponents, DecodeModel);
+    succeeded = succeeded && reader.IsAtEnd();
+
+    if (succeeded)
+    {
+        aReplica->myVersion = version;
+    }
+
+    return succeeded;
+}
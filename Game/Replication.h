@@ -0,0 +1,54 @@
+#if !defined(REPLICATION_H_)
+#define REPLICATION_H_
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../ECS/ComponentList.h"
+#include "../ECS/Components.h"
+
+#include "../Utils/ByteStream.h"
+
+/*
+* World deltas for network replication and replays. A delta holds every
+* component added, changed or removed after a version, with positions
+* quantized to 16 bits per axis. ApplyDelta() rebuilds the components on the
+* receiving end, e.g. a Replica in the same process for loopback testing.
+*
+* ModelIDs are sent as-is, so both ends need the same ModelManager IDs.
+*/
+namespace Replication
+{
+    /* Quantization range for positions; matches the box MovementUpdate keeps entities in. */
+    constexpr Vector3 POSITION_MIN = { -25.f, 0.f, -25.f };
+    constexpr Vector3 POSITION_MAX = { 25.f, 50.f, 25.f };
+
+    struct Replica
+    {
+        ComponentList<TransformComponent> myTransformComponents;
+        ComponentList<MovementComponent> myMovementComponents;
+        ComponentList<ModelComponent> myModelComponents;
+
+        /* Version covered by the last applied delta; ask for changes after this one. */
+        uint32_t myVersion = 0U;
+    };
+
+    void EncodeDelta(
+        ComponentList<TransformComponent>* someTransformComps,
+        ComponentList<MovementComponent>* someMovementComps,
+        ComponentList<ModelComponent>* someModelComps,
+        uint32_t aSinceVersion,
+        uint32_t aVersion,
+        ByteWriter* aWriter);
+
+    /*
+    * Rejects a delta that starts after aReplica's version, since changes in
+    * between would be missing, and a malformed or truncated one. A rejected
+    * delta leaves aReplica untouched.
+    */
+    bool ApplyDelta(const uint8_t* aData, size_t aSize, Replica* aReplica);
+}
+
+#endif // REPLICATION_H_
@@ -0,0 +1,579 @@
+/*
+* LoadTest
+*
+* Headless load generator. Replays spawn/despawn/frame traces through
+* Game::AddEntities(), Game::RemoveEntities() and Game::Update() in a hidden
+* window, once per entity count and worker count of the sweep, and writes one
+* row per run: frame time percentiles, throughput and peak resident memory.
+*
+* Traces are text, one command per line ('#' starts a comment):
+*
+*     spawn <count>
+*     despawn <count>
+*     frame [<count>]
+*
+* Commands before a frame are timed as part of it. Main.cpp records one with
+* F7. Without --trace every entity count gets a synthetic trace: spawn up to
+* the count, then despawn and respawn --churn entities every frame.
+*
+* Usage: LoadTest [--trace path] [--entities 96,192,...] [--workers 0,1,...]
+*                 [--frames 300] [--warmup 30] [--churn 1] [--tick-only]
+*                 [--format csv|json] [--output path]
+*/
+
+extern "C"
+{
+#include "raylib/raylib.h"
+}
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif !defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+#include "ECS/EntityService.h"
+#include "Game/Game.h"
+#include "Utils/JobSystem.h"
+#include "Utils/Profiler.h"
+
+namespace Config
+{
+    constexpr int screenWidth = 800;
+    constexpr int screenHeight = 450;
+    constexpr const char* title = "Elia ECS Load Test";
+
+    constexpr Vector3 cameraPos = { 30.f, 30.f, 30.f };
+    constexpr float cameraFOV = 45.f;
+
+    constexpr uint64_t seed = 1U;
+    constexpr uint32_t measuredFrames = 300U;
+    constexpr uint32_t warmupFrames = 30U;
+    constexpr uint32_t maxListSize = 32U;
+}
+
+enum CommandType
+{
+    CommandType_Spawn,
+    CommandType_Despawn,
+    CommandType_Frame,
+};
+
+struct Command
+{
+    CommandType myType;
+    uint32_t myCount;
+};
+
+struct Options
+{
+    const char* myTracePath = nullptr;
+    const char* myOutputPath = nullptr;
+    bool myIsJson = false;
+    bool myIsTickOnly = false;
+
+    uint32_t myEntityCounts[Config::maxListSize];
+    uint32_t myEntityCountsSize = 0U;
+    uint32_t myWorkerCounts[Config::maxListSize];
+    uint32_t myWorkerCountsSize = 0U;
+
+    uint32_t myMeasuredFrames = Config::measuredFrames;
+    uint32_t myWarmupFrames = Config::warmupFrames;
+    /* uint32_t(-1) picks 1% of the entity count. */
+    uint32_t myChurn = uint32_t(-1);
+};
+
+struct RunResult
+{
+    uint32_t myRequestedEntities;
+    uint32_t myWorkerCount;
+    uint32_t myFrameCount;
+    double myAverageEntities;
+
+    double myMeanMs;
+    double myP50Ms;
+    double myP90Ms;
+    double myP99Ms;
+    double myMaxMs;
+    double myFramesPerSecond;
+    double myEntityUpdatesPerSecond;
+
+    uint64_t myPeakResidentKB;
+};
+
+static bool ParseList(const char* aText, uint32_t* someValuesOut, uint32_t* aSizeOut)
+{
+    *aSizeOut = 0U;
+    while (*aText && *aSizeOut < Config::maxListSize)
+    {
+        char* end = nullptr;
+        const unsigned long value = strtoul(aText, &end, 10);
+        if (end == aText)
+        {
+            return false;
+        }
+
+        someValuesOut[(*aSizeOut)++] = (uint32_t)value;
+        aText = *end == ',' ? end + 1 : end;
+    }
+
+    return *aSizeOut > 0U && *aText == '\0';
+}
+
+static bool ParseOptions(int argc, char** argv, Options* anOptionsOut)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* const arg = argv[i];
+        const char* const value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        bool isValid = true;
+        if (strcmp(arg, "--tick-only") == 0)
+        {
+            anOptionsOut->myIsTickOnly = true;
+            continue;
+        }
+        else if (!value)
+        {
+            isValid = false;
+        }
+        else if (strcmp(arg, "--trace") == 0)
+        {
+            anOptionsOut->myTracePath = value;
+        }
+        else if (strcmp(arg, "--output") == 0)
+        {
+            anOptionsOut->myOutputPath = value;
+        }
+        else if (strcmp(arg, "--format") == 0)
+        {
+            anOptionsOut->myIsJson = strcmp(value, "json") == 0;
+            isValid = anOptionsOut->myIsJson || strcmp(value, "csv") == 0;
+        }
+        else if (strcmp(arg, "--entities") == 0)
+        {
+            isValid = ParseList(value, anOptionsOut->myEntityCounts, &anOptionsOut->myEntityCountsSize);
+        }
+        else if (strcmp(arg, "--workers") == 0)
+        {
+            isValid = ParseList(value, anOptionsOut->myWorkerCounts, &anOptionsOut->myWorkerCountsSize);
+        }
+        else if (strcmp(arg, "--frames") == 0)
+        {
+            anOptionsOut->myMeasuredFrames = (uint32_t)strtoul(value, nullptr, 10);
+        }
+        else if (strcmp(arg, "--warmup") == 0)
+        {
+            anOptionsOut->myWarmupFrames = (uint32_t)strtoul(value, nullptr, 10);
+        }
+        else if (strcmp(arg, "--churn") == 0)
+        {
+            anOptionsOut->myChurn = (uint32_t)strtoul(value, nullptr, 10);
+        }
+        else
+        {
+            isValid = false;
+        }
+
+        if (!isValid)
+        {
+            fprintf(stderr, "LOADTEST: Bad argument '%s'.\n", arg);
+            return false;
+        }
+        ++i;
+    }
+
+    /* Defaults: halving steps down from the entity limit, and doubling worker counts up to the hardware's. */
+    if (anOptionsOut->myEntityCountsSize == 0U)
+    {
+        for (uint32_t count = MAX_ENTITIES; count >= MAX_ENTITIES / 8U; count /= 2U)
+        {
+            anOptionsOut->myEntityCounts[anOptionsOut->myEntityCountsSize++] = count;
+        }
+        std::reverse(anOptionsOut->myEntityCounts, anOptionsOut->myEntityCounts + anOptionsOut->myEntityCountsSize);
+    }
+    if (anOptionsOut->myWorkerCountsSize == 0U)
+    {
+        const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        const uint32_t maxWorkers = std::min(hardwareThreads > 1U ? hardwareThreads - 1U : 0U, JobSystem::ourMaxWorkers);
+
+        anOptionsOut->myWorkerCounts[anOptionsOut->myWorkerCountsSize++] = 0U;
+        for (uint32_t workers = 1U; workers < maxWorkers; workers *= 2U)
+        {
+            anOptionsOut->myWorkerCounts[anOptionsOut->myWorkerCountsSize++] = workers;
+        }
+        if (maxWorkers > 0U)
+        {
+            anOptionsOut->myWorkerCounts[anOptionsOut->myWorkerCountsSize++] = maxWorkers;
+        }
+    }
+
+    return true;
+}
+
+static bool LoadTrace(const char* const aPath, std::vector<Command>* aTraceOut)
+{
+    FILE* file = fopen(aPath, "r");
+    if (!file)
+    {
+        fprintf(stderr, "LOADTEST: [%s] Failed to open trace.\n", aPath);
+        return false;
+    }
+
+    char line[128];
+    uint32_t lineNumber = 0U;
+    bool succeeded = true;
+    while (succeeded && fgets(line, sizeof(line), file))
+    {
+        ++lineNumber;
+        char* comment = strchr(line, '#');
+        if (comment)
+        {
+            *comment = '\0';
+        }
+
+        char name[16];
+        unsigned int count = 1U;
+        const int fields = sscanf(line, "%15s %u", name, &count);
+        if (fields <= 0)
+        {
+            continue;
+        }
+
+        Command command = { CommandType_Frame, count };
+        if (strcmp(name, "spawn") == 0 && fields == 2)
+        {
+            command.myType = CommandType_Spawn;
+        }
+        else if (strcmp(name, "despawn") == 0 && fields == 2)
+        {
+            command.myType = CommandType_Despawn;
+        }
+        else if (strcmp(name, "frame") != 0)
+        {
+            fprintf(stderr, "LOADTEST: [%s:%u] Unknown trace command '%s'.\n", aPath, lineNumber, name);
+            succeeded = false;
+        }
+
+        aTraceOut->push_back(command);
+    }
+
+    fclose(file);
+    return succeeded;
+}
+
+static void MakeSyntheticTrace(const Options& someOptions, uint32_t anEntityCount, std::vector<Command>* aTraceOut)
+{
+    const uint32_t churn = someOptions.myChurn != uint32_t(-1)
+        ? std::min(someOptions.myChurn, anEntityCount)
+        : (anEntityCount + 99U) / 100U;
+
+    aTraceOut->push_back({ CommandType_Spawn, anEntityCount });
+    aTraceOut->push_back({ CommandType_Frame, someOptions.myWarmupFrames });
+
+    for (uint32_t frame = 0U; frame < someOptions.myMeasuredFrames; ++frame)
+    {
+        aTraceOut->push_back({ CommandType_Despawn, churn });
+        aTraceOut->push_back({ CommandType_Spawn, churn });
+        aTraceOut->push_back({ CommandType_Frame, 1U });
+    }
+}
+
+/* Linux can reset the peak between runs; elsewhere it is the peak of the whole process so far. */
+static void ResetPeakResidentMemory()
+{
+#if defined(__linux__)
+    FILE* file = fopen("/proc/self/clear_refs", "w");
+    if (file)
+    {
+        fputs("5", file);
+        fclose(file);
+    }
+#endif
+}
+
+static uint64_t GetPeakResidentKB()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize / 1024U : 0U;
+#elif defined(__linux__)
+    FILE* file = fopen("/proc/self/status", "r");
+    if (!file)
+    {
+        return 0U;
+    }
+
+    char line[128];
+    unsigned long long peakKB = 0U;
+    while (fgets(line, sizeof(line), file) && sscanf(line, "VmHWM: %llu kB", &peakKB) != 1)
+    {
+    }
+    fclose(file);
+    return peakKB;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return (uint64_t)usage.ru_maxrss / 1024U;
+#else
+    return (uint64_t)usage.ru_maxrss;
+#endif
+#endif
+}
+
+static double Percentile(const std::vector<double>& someSortedValues, uint32_t aPercent)
+{
+    if (someSortedValues.empty())
+    {
+        return 0.0;
+    }
+
+    const size_t index = (someSortedValues.size() * aPercent + 99U) / 100U;
+    return someSortedValues[index > 0U ? index - 1U : 0U];
+}
+
+static RunResult Run(const Options& someOptions, const std::vector<Command>& aTrace, uint32_t anEntityCount, uint32_t aWorkerCount, const Camera3D& aCamera)
+{
+    using Clock = std::chrono::steady_clock;
+
+    Game::WorldSettings settings;
+    settings.myIsDeterministic = true;
+    settings.mySeed = Config::seed;
+    settings.myWorkerCount = aWorkerCount;
+
+    ResetPeakResidentMemory();
+    Game::World* world = Game::CreateWorld(settings);
+    /* Worlds start with an entity of their own; traces start from an empty world. */
+    Game::RemoveEntities(world, Game::GetEntityCount(world));
+
+    std::vector<double> frameMs;
+    uint64_t entityFrames = 0U;
+    uint32_t frameIndex = 0U;
+
+    Clock::time_point frameBegin = Clock::now();
+    for (const Command& command : aTrace)
+    {
+        switch (command.myType)
+        {
+            case CommandType_Spawn: Game::AddEntities(world, command.myCount); break;
+            case CommandType_Despawn: Game::RemoveEntities(world, command.myCount); break;
+            case CommandType_Frame:
+            {
+                for (uint32_t i = 0U; i < command.myCount; ++i, ++frameIndex)
+                {
+                    if (someOptions.myIsTickOnly)
+                    {
+                        Game::Tick(world);
+                    }
+                    else
+                    {
+                        BeginDrawing();
+                        ClearBackground(RAYWHITE);
+                        BeginMode3D(aCamera);
+                        Game::Update(world, aCamera);
+                        EndMode3D();
+                        EndDrawing();
+                    }
+                    PROFILE_FRAME_END();
+
+                    const Clock::time_point frameEnd = Clock::now();
+                    if (frameIndex >= someOptions.myWarmupFrames)
+                    {
+                        frameMs.push_back(std::chrono::duration<double, std::milli>(frameEnd - frameBegin).count());
+                        entityFrames += Game::GetEntityCount(world);
+                    }
+                    frameBegin = frameEnd;
+                }
+                break;
+            }
+        }
+    }
+
+    RunResult result = {};
+    result.myRequestedEntities = anEntityCount;
+    result.myWorkerCount = aWorkerCount;
+    result.myFrameCount = (uint32_t)frameMs.size();
+    result.myPeakResidentKB = GetPeakResidentKB();
+
+    Game::DestroyWorld(world);
+
+    double totalMs = 0.0;
+    for (double ms : frameMs)
+    {
+        totalMs += ms;
+    }
+    std::sort(frameMs.begin(), frameMs.end());
+
+    if (!frameMs.empty())
+    {
+        result.myAverageEntities = (double)entityFrames / frameMs.size();
+        result.myMeanMs = totalMs / frameMs.size();
+        result.myP50Ms = Percentile(frameMs, 50U);
+        result.myP90Ms = Percentile(frameMs, 90U);
+        result.myP99Ms = Percentile(frameMs, 99U);
+        result.myMaxMs = frameMs.back();
+    }
+    if (totalMs > 0.0)
+    {
+        result.myFramesPerSecond = frameMs.size() * 1000.0 / totalMs;
+        result.myEntityUpdatesPerSecond = entityFrames * 1000.0 / totalMs;
+    }
+
+    return result;
+}
+
+static void WriteResults(FILE* aFile, const Options& someOptions, const std::vector<RunResult>& someResults)
+{
+    const char* const trace = someOptions.myTracePath ? someOptions.myTracePath : "synthetic";
+
+    if (someOptions.myIsJson)
+    {
+        fprintf(aFile, "{\"maxEntities\":%u,\"tickOnly\":%s,\"runs\":[", MAX_ENTITIES, someOptions.myIsTickOnly ? "true" : "false");
+    }
+    else
+    {
+        fputs("trace,requested_entities,avg_entities,workers,frames,mean_ms,p50_ms,p90_ms,p99_ms,max_ms,fps,entity_updates_per_s,peak_rss_kb\n", aFile);
+    }
+
+    for (size_t i = 0U; i < someResults.size(); ++i)
+    {
+        const RunResult& r = someResults[i];
+        if (someOptions.myIsJson)
+        {
+            /* The path goes out as is; traces with quotes or backslashes in their path make invalid JSON. */
+            fprintf(aFile, "%s\n{\"trace\":\"%s\",\"requestedEntities\":%u,\"avgEntities\":%.1f,\"workers\":%u,\"frames\":%u,"
+                "\"meanMs\":%.4f,\"p50Ms\":%.4f,\"p90Ms\":%.4f,\"p99Ms\":%.4f,\"maxMs\":%.4f,\"fps\":%.1f,\"entityUpdatesPerSecond\":%.0f,\"peakRssKB\":%llu}",
+                i > 0U ? "," : "", trace, r.myRequestedEntities, r.myAverageEntities, r.myWorkerCount, r.myFrameCount,
+                r.myMeanMs, r.myP50Ms, r.myP90Ms, r.myP99Ms, r.myMaxMs, r.myFramesPerSecond, r.myEntityUpdatesPerSecond,
+                (unsigned long long)r.myPeakResidentKB);
+        }
+        else
+        {
+            fprintf(aFile, "%s,%u,%.1f,%u,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.1f,%.0f,%llu\n",
+                trace, r.myRequestedEntities, r.myAverageEntities, r.myWorkerCount, r.myFrameCount,
+                r.myMeanMs, r.myP50Ms, r.myP90Ms, r.myP99Ms, r.myMaxMs, r.myFramesPerSecond, r.myEntityUpdatesPerSecond,
+                (unsigned long long)r.myPeakResidentKB);
+        }
+    }
+
+    if (someOptions.myIsJson)
+    {
+        fputs("\n]}\n", aFile);
+    }
+}
+
+static bool SaveResults(const Options& someOptions, const std::vector<RunResult>& someResults)
+{
+    if (!someOptions.myOutputPath)
+    {
+        WriteResults(stdout, someOptions, someResults);
+        return true;
+    }
+
+    char tempPath[512];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", someOptions.myOutputPath);
+
+    FILE* file = fopen(tempPath, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    WriteResults(file, someOptions, someResults);
+
+    const bool succeeded = !ferror(file);
+    if (fclose(file) != 0 || !succeeded || rename(tempPath, someOptions.myOutputPath) != 0)
+    {
+        remove(tempPath);
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, &options))
+    {
+        return 1;
+    }
+
+    std::vector<Command> recordedTrace;
+    if (options.myTracePath)
+    {
+        if (!LoadTrace(options.myTracePath, &recordedTrace))
+        {
+            return 1;
+        }
+
+        /* The trace decides the entity count, so there is nothing to sweep over. */
+        options.myEntityCounts[0] = 0U;
+        options.myEntityCountsSize = 1U;
+    }
+
+    for (uint32_t i = 0U; i < options.myEntityCountsSize; ++i)
+    {
+        if (options.myEntityCounts[i] > MAX_ENTITIES)
+        {
+            fprintf(stderr, "LOADTEST: %u entities requested, runs stop at MAX_ENTITIES (%u).\n", options.myEntityCounts[i], MAX_ENTITIES);
+        }
+    }
+
+    /* Rendering needs a GL context even when nothing is shown. */
+    SetTraceLogLevel(LOG_WARNING);
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(Config::screenWidth, Config::screenHeight, Config::title);
+    SetTargetFPS(0);
+    Game::Init();
+
+    Camera camera = {};
+    camera.position = Config::cameraPos;
+    camera.target = { 0.0f, 25.0f, 0.0f };
+    camera.up = { 0.0f, 1.0f, 0.0f };
+    camera.fovy = Config::cameraFOV;
+    camera.projection = CAMERA_PERSPECTIVE;
+
+    std::vector<RunResult> results;
+    std::vector<Command> syntheticTrace;
+    for (uint32_t e = 0U; e < options.myEntityCountsSize; ++e)
+    {
+        const uint32_t entityCount = options.myEntityCounts[e];
+        if (!options.myTracePath)
+        {
+            syntheticTrace.clear();
+            MakeSyntheticTrace(options, std::min(entityCount, (uint32_t)MAX_ENTITIES), &syntheticTrace);
+        }
+
+        for (uint32_t w = 0U; w < options.myWorkerCountsSize; ++w)
+        {
+            fprintf(stderr, "LOADTEST: %u entities, %u workers...\n", entityCount, options.myWorkerCounts[w]);
+            results.push_back(Run(options, options.myTracePath ? recordedTrace : syntheticTrace, entityCount, options.myWorkerCounts[w], camera));
+        }
+    }
+
+    Game::Terminate();
+    CloseWindow();
+
+    if (!SaveResults(options, results))
+    {
+        fprintf(stderr, "LOADTEST: [%s] Failed to write results.\n", options.myOutputPath);
+        return 1;
+    }
+
+    return 0;
+}
@@ -6,6 +6,7 @@ extern "C"
 
 #include <stdio.h>
 #include "Game/Game.h"
+#include "Utils/Profiler.h"
 
 namespace Config
 {
@@ -17,6 +18,14 @@ namespace Config
     constexpr Vector3 cameraPos = { 30.f, 30.f, 30.f };
     constexpr float cameraFOV = 45.f;
     constexpr int cameraProjection = CAMERA_PERSPECTIVE;
+
+    constexpr const char* snapshotPath = "world.snapshot";
+
+    constexpr const char* profilePath = "profile.json";
+    constexpr uint32_t profileCaptureFrames = 120U;
+
+    /* Replayed by LoadTest, see LoadTest.cpp for the format. */
+    constexpr const char* tracePath = "load.trace";
 }
 
 int main()
@@ -52,19 +61,57 @@ int main()
     };
 
     Game::Init();
+    Game::World* world = Game::CreateWorld();
+
+    bool showProfile = false;
+    bool isSavingProfile = false;
+    FILE* traceFile = nullptr;
 
     /* Main Loop */
     while (!WindowShouldClose())
     {
-        UpdateCamera(&camera);
+        {
+            PROFILE_ZONE("Main::UpdateCamera");
+            UpdateCamera(&camera);
+        }
+
+        if (IsKeyPressed(KEY_F5)) Game::SaveSnapshot(world, Config::snapshotPath);
+        if (IsKeyPressed(KEY_F9)) Game::LoadSnapshot(world, Config::snapshotPath);
+        if (IsKeyPressed(KEY_F3)) showProfile = !showProfile;
+        if (IsKeyPressed(KEY_F6) && !Profiler::IsCapturing())
+        {
+            Profiler::StartCapture(Config::profileCaptureFrames);
+            isSavingProfile = true;
+        }
+        if (IsKeyPressed(KEY_F7))
+        {
+            if (traceFile)
+            {
+                fclose(traceFile);
+                traceFile = nullptr;
+            }
+            else
+            {
+                /* Replays start from an empty world. */
+                traceFile = fopen(Config::tracePath, "w");
+                if (traceFile) fprintf(traceFile, "spawn %u\n", Game::GetEntityCount(world));
+            }
+        }
+        if (isSavingProfile && !Profiler::IsCapturing())
+        {
+            Profiler::SaveCapture(Config::profilePath);
+            isSavingProfile = false;
+        }
 
         BeginDrawing();
         {
+            PROFILE_ZONE("Main::Frame");
+
             ClearBackground(RAYWHITE);
 
             BeginMode3D(camera);
 
-            Game::Update();
+            Game::Update(world, camera);
 
             /* Bounds */
             DrawLine3D({ 25.f, 0.f, 25.f }, { 25.f, 50.f, 25.f }, RED);
@@ -82,8 +129,23 @@ int main()
             EndMode3D();
             
             /* HUD */
+            PROFILE_ZONE("Main::DrawHUD");
             DrawFPS(10, 10);
 
+            if (showProfile)
+            {
+                Profiler::ZoneStats zones[Profiler::MAX_ZONES];
+                const uint32_t zoneCount = Profiler::GetZoneStats(zones, Profiler::MAX_ZONES);
+
+                for (uint32_t i = 0U; i < zoneCount; ++i)
+                {
+                    char line[128];
+                    snprintf(line, sizeof(line), "%-24s avg %6.3f  min %6.3f  p99 %6.3f ms",
+                        zones[i].myName, zones[i].myAvgMs, zones[i].myMinMs, zones[i].myP99Ms);
+                    DrawText(line, 10, 40 + 14 * i, 10, DARKGRAY);
+                }
+            }
+
             for (int btn = 0; btn < buttonCount; ++btn)
             {
                 DrawRectangleRec(buttons[btn], BLACK);
@@ -93,33 +155,37 @@ int main()
                 if (CheckCollisionPointRec(GetMousePosition(), buttons[btn])
                     && IsMouseButtonReleased(MOUSE_BUTTON_LEFT))
                 {
-                    switch (btn)
-                    {
-                        case 0: Game::AddEntities(1); break;
-                        case 1: Game::AddEntities(10); break;
-                        case 2: Game::AddEntities(100); break;
-                        case 3: Game::RemoveEntities(1); break;
-                        case 4: Game::RemoveEntities(10); break;
-                        case 5: Game::RemoveEntities(100); break;
-                    }
+                    const uint32_t counts[buttonCount] = { 1U, 10U, 100U, 1U, 10U, 100U };
+                    const bool isSpawn = btn < 3;
+
+                    if (isSpawn) Game::AddEntities(world, counts[btn]);
+                    else Game::RemoveEntities(world, counts[btn]);
+
+                    if (traceFile) fprintf(traceFile, "%s %u\n", isSpawn ? "spawn" : "despawn", counts[btn]);
                 }
             }
 
-            if (Game::IsMaxEntitiesReached())
+            if (Game::IsMaxEntitiesReached(world))
             {
                 constexpr char* value = "Max entities reached.";
                 DrawText(value, Config::screenWidth / 2 - MeasureText(value, fontSize) / 2, 10, fontSize, RED);
             }
 
             char entityCountBuf[32];
-            sprintf(entityCountBuf, "%u", Game::GetEntityCount());
+            sprintf(entityCountBuf, "%u", Game::GetEntityCount(world));
             DrawText(entityCountBuf, Config::screenWidth - 20 - MeasureText(entityCountBuf, fontSize), Config::screenHeight - 40, fontSize, RED);
         }
         EndDrawing();
+
+        PROFILE_FRAME_END();
+
+        if (traceFile) fputs("frame\n", traceFile);
     }
 
     /* Shutdown */
     {
+        if (traceFile) fclose(traceFile);
+        Game::DestroyWorld(world);
         Game::Terminate();
         CloseWindow();
     }
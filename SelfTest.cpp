@@ -0,0 +1,1120 @@
+/*
+* SelfTest
+*
+* Headless checks of the paths that have no window to show their results:
+*
+*     snapshot     save, load into a fresh world, then tick both in lockstep
+*     worlds       worlds ticked on their own threads match serial runs
+*     replication  a loopback replica rebuilt from deltas matches the source, and broken deltas leave it untouched
+*     optimize     welding and cache reordering keep every triangle and lower ACMR
+*     simplify     LOD simplification keeps the mesh bounds and drops triangles
+*     culling      a synthetic camera sees the scene, or nothing when turned away
+*     grid         spatial grid queries and pairs match brute force scans
+*     collide      collision pairs match a brute force scan, and any worker count resolves them alike
+*     bits         threads merging into one AtomicBitArray lose no bits
+*     entities     threads creating and removing entities at once never share one
+*     tags         bit scans stop exactly at word edges and the last entity, and tag lists iterate and query by them
+*     render       render commands reach the null backend sorted and grouped
+*
+* Runs every check, or the ones named on the command line, prints one line
+* per check and exits with 1 if any failed. Models still need a GL context,
+* so a hidden window is opened as in LoadTest.
+*
+* Usage: SelfTest [check...]
+*/
+
+extern "C"
+{
+#include "raylib/raylib.h"
+}
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <numeric>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ECS/CollisionSystem.h"
+#include "ECS/ComponentList.h"
+#include "ECS/Components.h"
+#include "ECS/EntityService.h"
+#include "ECS/CullingSystem.h"
+#include "ECS/Query.h"
+#include "ECS/RenderBackend.h"
+#include "ECS/RenderSystem.h"
+#include "ECS/Snapshot.h"
+#include "ECS/SpatialGrid.h"
+#include "Game/Game.h"
+#include "Game/MeshOptimizer.h"
+#include "Game/ModelManager.h"
+#include "Game/ObjLoader.h"
+#include "Game/Replication.h"
+#include "Utils/AtomicBitArray.h"
+#include "Utils/BitArray.h"
+#include "Utils/ByteStream.h"
+#include "Utils/JobSystem.h"
+#include "Utils/Random.h"
+
+namespace Config
+{
+    constexpr int screenWidth = 800;
+    constexpr int screenHeight = 450;
+    constexpr const char* title = "Elia ECS Self Test";
+
+    constexpr const char* snapshotPath = "selftest.snapshot";
+    constexpr const char* meshPath = "assets/banana.obj";
+
+    constexpr uint32_t ticks = 60U;
+    constexpr uint32_t worldCount = 4U;
+    /* Coarsest LOD grid ModelManager uses; the one that removes the most. */
+    constexpr uint32_t simplifyResolution = 4U;
+    constexpr uint32_t sceneSize = 200U;
+
+    /* The world box and cell size the grid was tuned for; the cloud spills a little past it on every side. */
+    constexpr Vector3 gridMin = { -25.f, 0.f, -25.f };
+    constexpr Vector3 gridMax = { 25.f, 50.f, 25.f };
+    constexpr float gridCellSize = 2.5f;
+    constexpr float coarseCellSize = 10.f;
+    constexpr float cloudMargin = 3.f;
+    constexpr uint32_t cloudSize = 600U;
+    constexpr uint32_t cloudWorkers = 2U;
+
+    /* Entities packed into a small box at mixed scales, so most of them overlap several others. */
+    constexpr float pileSize = 8.f;
+    constexpr uint32_t pileSteps = 4U;
+
+    /* Threads hammering shared words or the entity pool, and how often they start over. */
+    constexpr uint32_t contendingThreads = 4U;
+    constexpr uint32_t contentionRounds = 200U;
+}
+
+/* Prints what failed and passes the result on, so checks read as a chain of conditions. */
+static bool Expect(bool aCondition, const char* aCheck, const char* aWhat)
+{
+    if (!aCondition)
+    {
+        fprintf(stderr, "SELFTEST: [%s] %s\n", aCheck, aWhat);
+    }
+
+    return aCondition;
+}
+
+/* Adds, removes and ticks the same way for every world given the same seed. */
+static void Churn(Game::World* aWorld, uint32_t aTickCount)
+{
+    for (uint32_t tick = 0U; tick < aTickCount; ++tick)
+    {
+        Game::AddEntities(aWorld, 5U);
+        Game::Tick(aWorld);
+        Game::RemoveEntities(aWorld, 3U);
+    }
+}
+
+static Game::WorldSettings MakeSettings(uint64_t aSeed)
+{
+    Game::WorldSettings settings;
+    settings.myIsDeterministic = true;
+    settings.mySeed = aSeed;
+    settings.myWorkerCount = 0U;
+
+    return settings;
+}
+
+static bool CheckSnapshot()
+{
+    Game::World* original = Game::CreateWorld(MakeSettings(1U));
+    Game::World* loaded = Game::CreateWorld(MakeSettings(2U));
+    Churn(original, Config::ticks);
+
+    bool succeeded = Expect(Game::SaveSnapshot(original, Config::snapshotPath), "snapshot", "Saving failed.");
+    succeeded = succeeded && Expect(Game::LoadSnapshot(loaded, Config::snapshotPath), "snapshot", "Loading failed.");
+    succeeded = succeeded && Expect(Game::GetEntityCount(loaded) == Game::GetEntityCount(original), "snapshot", "Entity counts differ after loading.");
+    succeeded = succeeded && Expect(Game::GetTickCount(loaded) == Game::GetTickCount(original), "snapshot", "Tick counts differ after loading.");
+
+    /* The checksum covers the generator state too, so matching ticks after the load means nothing was left behind. */
+    for (uint32_t tick = 0U; succeeded && tick < Config::ticks; ++tick)
+    {
+        Churn(original, 1U);
+        Churn(loaded, 1U);
+        succeeded = Expect(Game::GetChecksum(loaded) == Game::GetChecksum(original), "snapshot", "Checksums diverged after loading.");
+    }
+
+    Game::DestroyWorld(original);
+    Game::DestroyWorld(loaded);
+    remove(Config::snapshotPath);
+
+    return succeeded;
+}
+
+static bool CheckWorlds()
+{
+    uint64_t serialChecksums[Config::worldCount];
+    for (uint32_t i = 0U; i < Config::worldCount; ++i)
+    {
+        Game::World* world = Game::CreateWorld(MakeSettings(i));
+        Churn(world, Config::ticks);
+        serialChecksums[i] = Game::GetChecksum(world);
+        Game::DestroyWorld(world);
+    }
+
+    Game::World* worlds[Config::worldCount];
+    for (uint32_t i = 0U; i < Config::worldCount; ++i)
+    {
+        Game::WorldSettings settings = MakeSettings(i);
+        /* One world also runs its own workers, which must not change its results either. */
+        settings.myWorkerCount = i == 0U ? 2U : 0U;
+        worlds[i] = Game::CreateWorld(settings);
+    }
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0U; i < Config::worldCount; ++i)
+    {
+        threads.emplace_back(Churn, worlds[i], Config::ticks);
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    bool succeeded = true;
+    for (uint32_t i = 0U; i < Config::worldCount; ++i)
+    {
+        succeeded = Expect(Game::GetChecksum(worlds[i]) == serialChecksums[i], "worlds", "A parallel world diverged from its serial run.") && succeeded;
+        Game::DestroyWorld(worlds[i]);
+    }
+
+    return succeeded;
+}
+
+template <class ComponentType, class Compare>
+static bool ListsMatch(ComponentList<ComponentType>& aSource, ComponentList<ComponentType>& aReplica, Compare&& aCompare)
+{
+    if (aSource.GetSize() != aReplica.GetSize())
+    {
+        return false;
+    }
+
+    for (uint32_t compIndex = 0U; compIndex < aSource.GetSize(); ++compIndex)
+    {
+        const Entity entity = aSource.GetEntityFromComponent(compIndex);
+        if (!aReplica.HasComponent(entity) || !aCompare(aSource.GetComponent(entity), aReplica.GetComponent(entity)))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool CheckReplication()
+{
+    Replication::Replica* source = new Replication::Replica();
+    Replication::Replica* replica = new Replication::Replica();
+    /* Only ever sent whole deltas, to compare against after the replica rejects broken ones. */
+    Replication::Replica* reference = new Replication::Replica();
+    ByteWriter delta;
+
+    /* One quantization step of the widest axis of the range. */
+    const float tolerance = 50.f / 65535.f;
+    auto sameTransform = [tolerance](const TransformComponent& aFirst, const TransformComponent& aSecond)
+    {
+        return fabsf(aFirst.myPosition.x - aSecond.myPosition.x) <= tolerance
+            && fabsf(aFirst.myPosition.y - aSecond.myPosition.y) <= tolerance
+            && fabsf(aFirst.myPosition.z - aSecond.myPosition.z) <= tolerance;
+    };
+    auto sameMovement = [](const MovementComponent& aFirst, const MovementComponent& aSecond)
+    {
+        return memcmp(&aFirst, &aSecond, sizeof(aFirst)) == 0;
+    };
+    auto sameModel = [](const ModelComponent& aFirst, const ModelComponent& aSecond)
+    {
+        return aFirst.myModel == aSecond.myModel && memcmp(&aFirst.myColor, &aSecond.myColor, sizeof(Color)) == 0 && aFirst.myScale == aSecond.myScale;
+    };
+
+    bool succeeded = true;
+    uint32_t version = 1U;
+    for (uint32_t round = 0U; succeeded && round < 3U; ++round)
+    {
+        source->myTransformComponents.SetChangeVersion(version);
+        source->myMovementComponents.SetChangeVersion(version);
+        source->myModelComponents.SetChangeVersion(version);
+
+        /* Add a batch, move some of what is there and remove some, so every kind of change goes out. */
+        for (Entity e = round * 40U; e < round * 40U + 60U; ++e)
+        {
+            if (!source->myTransformComponents.HasComponent(e))
+            {
+                source->myTransformComponents.AddComponent(e).myPosition = { (float)(e % 50U) - 25.f, (float)(e % 37U), 25.f - (float)(e % 29U) };
+                source->myMovementComponents.AddComponent(e).myVelocity = { (float)e, -(float)e, 0.5f };
+                source->myModelComponents.AddComponent(e) = { (ModelID)(e % 3U), { (uint8_t)e, 0, 255, 255 }, 1.f + (float)(e % 4U) };
+            }
+            else if (e % 3U == 0U)
+            {
+                source->myTransformComponents.GetMutableComponent(e).myPosition.y += 0.25f;
+            }
+            else if (e % 5U == 0U)
+            {
+                source->myTransformComponents.RemoveComponent(e);
+                source->myMovementComponents.RemoveComponent(e);
+                source->myModelComponents.RemoveComponent(e);
+            }
+        }
+
+        delta.Clear();
+        Replication::EncodeDelta(&source->myTransformComponents, &source->myMovementComponents, &source->myModelComponents, replica->myVersion, version, &delta);
+        ++version;
+
+        /* Cut short anywhere, or with a byte too many, the delta is turned away before any of it lands. */
+        bool isRejected = true;
+        for (size_t size = 0U; size < delta.Size(); ++size)
+        {
+            isRejected = isRejected && !Replication::ApplyDelta(delta.Data(), size, replica);
+        }
+        ByteWriter padded;
+        padded.WriteBytes(delta.Data(), delta.Size());
+        padded.WriteU8(0U);
+        isRejected = isRejected && !Replication::ApplyDelta(padded.Data(), padded.Size(), replica);
+
+        succeeded = Expect(isRejected, "replication", "The replica accepted a truncated or padded delta.");
+        succeeded = succeeded && Expect(replica->myVersion == reference->myVersion
+            && ListsMatch(reference->myTransformComponents, replica->myTransformComponents, sameTransform)
+            && ListsMatch(reference->myMovementComponents, replica->myMovementComponents, sameMovement)
+            && ListsMatch(reference->myModelComponents, replica->myModelComponents, sameModel), "replication", "A rejected delta was partly applied.");
+
+        succeeded = succeeded && Expect(Replication::ApplyDelta(delta.Data(), delta.Size(), reference), "replication", "The reference rejected a delta.");
+        succeeded = succeeded && Expect(Replication::ApplyDelta(delta.Data(), delta.Size(), replica), "replication", "The replica rejected a delta.");
+        succeeded = succeeded && Expect(ListsMatch(source->myTransformComponents, replica->myTransformComponents, sameTransform), "replication", "Transforms differ.");
+        succeeded = succeeded && Expect(ListsMatch(source->myMovementComponents, replica->myMovementComponents, sameMovement), "replication", "Movements differ.");
+        succeeded = succeeded && Expect(ListsMatch(source->myModelComponents, replica->myModelComponents, sameModel), "replication", "Models differ.");
+    }
+
+    delete source;
+    delete replica;
+    delete reference;
+
+    return succeeded;
+}
+
+static void GetBounds(const Mesh& aMesh, Vector3* aMinOut, Vector3* aMaxOut)
+{
+    *aMinOut = { INFINITY, INFINITY, INFINITY };
+    *aMaxOut = { -INFINITY, -INFINITY, -INFINITY };
+    for (int v = 0; v < aMesh.vertexCount; ++v)
+    {
+        const float* p = aMesh.vertices + v * 3;
+        *aMinOut = { fminf(aMinOut->x, p[0]), fminf(aMinOut->y, p[1]), fminf(aMinOut->z, p[2]) };
+        *aMaxOut = { fmaxf(aMaxOut->x, p[0]), fmaxf(aMaxOut->y, p[1]), fmaxf(aMaxOut->z, p[2]) };
+    }
+}
+
+/* One triangle's corner attributes, in a fixed layout so triangle lists can be sorted and compared. */
+struct SoupTriangle
+{
+    float myCorners[3][8];
+
+    bool operator< (const SoupTriangle& anotherTriangle) const
+    {
+        return memcmp(myCorners, anotherTriangle.myCorners, sizeof(myCorners)) < 0;
+    }
+
+    bool operator== (const SoupTriangle& anotherTriangle) const
+    {
+        return memcmp(myCorners, anotherTriangle.myCorners, sizeof(myCorners)) == 0;
+    }
+};
+
+static std::vector<SoupTriangle> GetTriangles(const Mesh& aMesh)
+{
+    std::vector<SoupTriangle> triangles((size_t)aMesh.triangleCount);
+    for (uint32_t t = 0U; t < (uint32_t)aMesh.triangleCount; ++t)
+    {
+        SoupTriangle& triangle = triangles[t];
+        memset(&triangle, 0, sizeof(triangle));
+        for (uint32_t corner = 0U; corner < 3U; ++corner)
+        {
+            const uint32_t v = aMesh.indices ? aMesh.indices[t * 3U + corner] : t * 3U + corner;
+            memcpy(triangle.myCorners[corner], aMesh.vertices + v * 3U, sizeof(float) * 3U);
+            if (aMesh.texcoords) memcpy(triangle.myCorners[corner] + 3, aMesh.texcoords + v * 2U, sizeof(float) * 2U);
+            if (aMesh.normals) memcpy(triangle.myCorners[corner] + 5, aMesh.normals + v * 3U, sizeof(float) * 3U);
+        }
+    }
+
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+/* Expands an indexed mesh into a triangle soup, visiting the triangles in a strided order so the cache has something to fix. */
+static Mesh MakeTriangleSoup(const Mesh& anIndexed)
+{
+    const uint32_t triangleCount = (uint32_t)anIndexed.triangleCount;
+    uint32_t stride = 7919U;
+    while (std::gcd(stride, triangleCount) != 1U) ++stride;
+
+    Mesh soup = {};
+    soup.vertexCount = (int)(triangleCount * 3U);
+    soup.triangleCount = (int)triangleCount;
+    soup.vertices = (float*)MemAlloc(sizeof(float) * 3U * soup.vertexCount);
+    soup.texcoords = anIndexed.texcoords ? (float*)MemAlloc(sizeof(float) * 2U * soup.vertexCount) : nullptr;
+    soup.normals = anIndexed.normals ? (float*)MemAlloc(sizeof(float) * 3U * soup.vertexCount) : nullptr;
+
+    for (uint32_t t = 0U; t < triangleCount; ++t)
+    {
+        const uint32_t source = (uint32_t)(((uint64_t)t * stride) % triangleCount);
+        for (uint32_t corner = 0U; corner < 3U; ++corner)
+        {
+            const uint32_t from = anIndexed.indices[source * 3U + corner];
+            const uint32_t to = t * 3U + corner;
+            memcpy(soup.vertices + to * 3U, anIndexed.vertices + from * 3U, sizeof(float) * 3U);
+            if (soup.texcoords) memcpy(soup.texcoords + to * 2U, anIndexed.texcoords + from * 2U, sizeof(float) * 2U);
+            if (soup.normals) memcpy(soup.normals + to * 3U, anIndexed.normals + from * 3U, sizeof(float) * 3U);
+        }
+    }
+
+    return soup;
+}
+
+static bool CheckOptimize()
+{
+    Mesh source = {};
+    if (!Expect(ObjLoader::LoadMesh(Config::meshPath, &source), "optimize", "Could not load the test mesh."))
+    {
+        return false;
+    }
+
+    bool succeeded = Expect(source.indices != nullptr && source.triangleCount > 0, "optimize", "The loader did not index the test mesh.");
+
+    Mesh optimized = {};
+    MeshOptimizer::Stats stats = {};
+    if (succeeded)
+    {
+        optimized = MakeTriangleSoup(source);
+        succeeded = Expect(MeshOptimizer::Optimize(optimized, &stats), "optimize", "Optimize refused a triangle soup.");
+    }
+
+    if (succeeded)
+    {
+        /* Welding is exact, so the soup collapses back to the loader's vertex set. */
+        succeeded = Expect(stats.myInputVertexCount == (uint32_t)source.triangleCount * 3U, "optimize", "Stats report the wrong input vertex count.");
+        succeeded = Expect(stats.myOutputVertexCount == (uint32_t)optimized.vertexCount && optimized.vertexCount == source.vertexCount,
+            "optimize", "Welding did not merge the shared vertices.") && succeeded;
+        succeeded = Expect(optimized.triangleCount == source.triangleCount && GetTriangles(optimized) == GetTriangles(source),
+            "optimize", "Optimized triangles do not match the source.") && succeeded;
+        succeeded = Expect(stats.myAcmrAfter < stats.myAcmrBefore, "optimize", "Cache reordering did not lower the ACMR.") && succeeded;
+    }
+
+    ObjLoader::UnloadMeshData(optimized);
+    ObjLoader::UnloadMeshData(source);
+
+    return succeeded;
+}
+
+static bool CheckSimplify()
+{
+    Mesh source = {};
+    if (!Expect(ObjLoader::LoadMesh(Config::meshPath, &source), "simplify", "Could not load the test mesh."))
+    {
+        return false;
+    }
+    MeshOptimizer::Optimize(source);
+
+    Mesh simplified = {};
+    bool succeeded = Expect(MeshOptimizer::Simplify(source, Config::simplifyResolution, &simplified), "simplify", "Simplification left nothing.");
+    succeeded = succeeded && Expect(simplified.triangleCount < source.triangleCount, "simplify", "Simplification did not lower the triangle count.");
+
+    if (succeeded)
+    {
+        Vector3 sourceMin, sourceMax, simplifiedMin, simplifiedMax;
+        GetBounds(source, &sourceMin, &sourceMax);
+        GetBounds(simplified, &simplifiedMin, &simplifiedMax);
+
+        /* Merged vertices are cell averages, so they stay inside the source box and move in by less than a cell. */
+        const float extent = fmaxf(sourceMax.x - sourceMin.x, fmaxf(sourceMax.y - sourceMin.y, sourceMax.z - sourceMin.z));
+        const float cellSize = extent / (float)Config::simplifyResolution;
+        const float epsilon = extent * 1e-5f;
+
+        const bool isInside = simplifiedMin.x >= sourceMin.x - epsilon && simplifiedMin.y >= sourceMin.y - epsilon && simplifiedMin.z >= sourceMin.z - epsilon
+            && simplifiedMax.x <= sourceMax.x + epsilon && simplifiedMax.y <= sourceMax.y + epsilon && simplifiedMax.z <= sourceMax.z + epsilon;
+        const bool isClose = simplifiedMin.x - sourceMin.x <= cellSize && simplifiedMin.y - sourceMin.y <= cellSize && simplifiedMin.z - sourceMin.z <= cellSize
+            && sourceMax.x - simplifiedMax.x <= cellSize && sourceMax.y - simplifiedMax.y <= cellSize && sourceMax.z - simplifiedMax.z <= cellSize;
+
+        succeeded = Expect(isInside, "simplify", "Simplified mesh grew past the source bounds.");
+        succeeded = Expect(isClose, "simplify", "Simplified mesh shrank by more than a grid cell.") && succeeded;
+    }
+
+    ObjLoader::UnloadMeshData(simplified);
+    ObjLoader::UnloadMeshData(source);
+
+    return succeeded;
+}
+
+/* A ring of instances around the origin, alternating between two models that are not loaded, so both use placeholder bounds. */
+struct Scene
+{
+    ComponentList<TransformComponent> myTransformComponents;
+    ComponentList<ModelComponent> myModelComponents;
+    DrawableQuery myDrawables{ myTransformComponents, myModelComponents };
+    VisibleSet myVisibleSet;
+    RenderCommandList myCommands;
+    JobSystem myJobSystem;
+
+    Scene()
+    {
+        for (Entity e = 0U; e < Config::sceneSize; ++e)
+        {
+            const float angle = (float)e * 2.f * PI / (float)Config::sceneSize;
+            myTransformComponents.AddComponent(e).myPosition = { cosf(angle) * 10.f, (float)(e % 5U), sinf(angle) * 10.f };
+            myModelComponents.AddComponent(e) = { (ModelID)(1000 + e % 2U), WHITE, 1.f };
+        }
+    }
+};
+
+static Camera3D MakeCamera(Vector3 aTarget)
+{
+    Camera3D camera = {};
+    camera.position = { 0.f, 50.f, 80.f };
+    camera.target = aTarget;
+    camera.up = { 0.f, 1.f, 0.f };
+    camera.fovy = 45.f;
+    camera.projection = CAMERA_PERSPECTIVE;
+
+    return camera;
+}
+
+static bool CheckCulling()
+{
+    Scene* scene = new Scene();
+    const float aspect = (float)Config::screenWidth / (float)Config::screenHeight;
+
+    const Camera3D facing = MakeCamera({ 0.f, 0.f, 0.f });
+    Systems::Cull(&scene->myTransformComponents, &scene->myModelComponents, scene->myDrawables, Systems::MakeFrustum(facing, aspect, 0.1f, 1000.f), &scene->myVisibleSet, &scene->myJobSystem);
+    bool succeeded = Expect(scene->myVisibleSet.myCount == Config::sceneSize, "culling", "Instances in front of the camera were culled.");
+
+    const Camera3D away = MakeCamera({ 0.f, 100.f, 160.f });
+    Systems::Cull(&scene->myTransformComponents, &scene->myModelComponents, scene->myDrawables, Systems::MakeFrustum(away, aspect, 0.1f, 1000.f), &scene->myVisibleSet, &scene->myJobSystem);
+    succeeded = Expect(scene->myVisibleSet.myCount == 0U, "culling", "Instances behind the camera were kept.") && succeeded;
+
+    delete scene;
+
+    return succeeded;
+}
+
+static bool CheckRender()
+{
+    Scene* scene = new Scene();
+    NullRenderBackend backend;
+    const float aspect = (float)Config::screenWidth / (float)Config::screenHeight;
+
+    const Camera3D camera = MakeCamera({ 0.f, 0.f, 0.f });
+    Systems::Cull(&scene->myTransformComponents, &scene->myModelComponents, scene->myDrawables, Systems::MakeFrustum(camera, aspect, 0.1f, 1000.f), &scene->myVisibleSet, &scene->myJobSystem);
+    Systems::Render(&scene->myTransformComponents, &scene->myModelComponents, &scene->myVisibleSet, camera, &scene->myCommands, &scene->myJobSystem);
+    backend.Execute(scene->myCommands);
+
+    /* Everything but depth is the batch; each one has to come as a single run. */
+    const uint64_t batchMask = ~(RenderKey::DEPTH_MASK << RenderKey::DEPTH_SHIFT);
+    const RenderCommand* commands = scene->myCommands.GetCommands();
+    uint64_t batches[MAX_ENTITIES];
+    uint32_t batchCount = 0U;
+    bool isGrouped = true;
+    for (uint32_t i = 0U; i < scene->myCommands.GetSize(); ++i)
+    {
+        const uint64_t batch = commands[i].mySortKey & batchMask;
+        if (batchCount > 0U && batches[batchCount - 1U] == batch)
+        {
+            continue;
+        }
+
+        for (uint32_t b = 0U; b < batchCount; ++b)
+        {
+            isGrouped = isGrouped && batches[b] != batch;
+        }
+        batches[batchCount++] = batch;
+    }
+
+    const NullRenderStats& stats = backend.GetStats();
+    bool succeeded = Expect(stats.myCommandCount == Config::sceneSize, "render", "Not every visible instance got a command.");
+    succeeded = Expect(stats.myErrorCount == 0U, "render", "The null backend found unsorted or broken commands.") && succeeded;
+    succeeded = Expect(isGrouped, "render", "A batch was split into several runs.") && succeeded;
+    succeeded = Expect(stats.myBatchCount == batchCount, "render", "The null backend counted another number of batches.") && succeeded;
+    succeeded = Expect(batchCount >= 2U, "render", "Two models ended up in one batch.") && succeeded;
+
+    delete scene;
+
+    return succeeded;
+}
+
+/* Random positions in and around the grid box, indexed on a job system with workers so Build runs in parallel. */
+struct Cloud
+{
+    ComponentList<TransformComponent> myTransformComponents;
+    SpatialGrid myGrid;
+    JobSystem myJobSystem;
+
+    Cloud()
+    {
+        Random random(Config::cloudSize);
+        const Vector3 low = { Config::gridMin.x - Config::cloudMargin, Config::gridMin.y - Config::cloudMargin, Config::gridMin.z - Config::cloudMargin };
+        const Vector3 high = { Config::gridMax.x + Config::cloudMargin, Config::gridMax.y + Config::cloudMargin, Config::gridMax.z + Config::cloudMargin };
+
+        for (Entity e = 0U; e < Config::cloudSize; ++e)
+        {
+            myTransformComponents.AddComponent(e).myPosition = {
+                low.x + random.NextFloat() * (high.x - low.x),
+                low.y + random.NextFloat() * (high.y - low.y),
+                low.z + random.NextFloat() * (high.z - low.z),
+            };
+        }
+
+        myJobSystem.Init(Config::cloudWorkers);
+        myGrid.Init(Config::gridMin, Config::gridMax, Config::gridCellSize);
+        myGrid.Build(&myTransformComponents, &myJobSystem);
+    }
+};
+
+/* Same arithmetic as the grid, so distances compare exactly. */
+static float DistanceSquared(Vector3 a, Vector3 b)
+{
+    const float dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+    return dx * dx + dy * dy + dz * dz;
+}
+
+static std::vector<Entity> SortedEntities(const Entity* someEntities, uint32_t aCount)
+{
+    std::vector<Entity> entities(someEntities, someEntities + aCount);
+    std::sort(entities.begin(), entities.end());
+    return entities;
+}
+
+static uint64_t PairKey(Entity aFirst, Entity aSecond)
+{
+    return aFirst < aSecond ? (uint64_t)aFirst << 32 | aSecond : (uint64_t)aSecond << 32 | aFirst;
+}
+
+static bool CheckGrid()
+{
+    Cloud* cloud = new Cloud();
+    ComponentList<TransformComponent>& transforms = cloud->myTransformComponents;
+    const SpatialGrid& grid = cloud->myGrid;
+
+    /* The middle, the corners, and points outside the box whose cells are clamped. */
+    const Vector3 points[] = {
+        { 0.f, 25.f, 0.f }, { -25.f, 0.f, -25.f }, { 24.9f, 49.9f, 24.9f }, { 3.7f, 11.2f, -17.4f },
+        { -40.f, 10.f, 0.f }, { 10.f, 70.f, -10.f }, { 60.f, -20.f, 60.f },
+    };
+    const float radii[] = { 0.5f, Config::gridCellSize, 7.f, 30.f };
+    const uint32_t nearestCounts[] = { 1U, 8U, 50U, Config::cloudSize };
+
+    bool isRadiusExact = true, isAABBExact = true, isNearestExact = true;
+    Entity found[MAX_ENTITIES];
+    Entity expected[MAX_ENTITIES];
+
+    for (const Vector3& point : points)
+    {
+        for (const float radius : radii)
+        {
+            uint32_t expectedCount = 0U;
+            for (uint32_t i = 0U; i < transforms.GetSize(); ++i)
+            {
+                if (DistanceSquared(transforms.GetDenseComponents()[i].myPosition, point) <= radius * radius)
+                {
+                    expected[expectedCount++] = transforms.GetEntityFromComponent(i);
+                }
+            }
+
+            const uint32_t foundCount = grid.QueryRadius(point, radius, found, MAX_ENTITIES);
+            isRadiusExact = isRadiusExact && foundCount == expectedCount && SortedEntities(found, foundCount) == SortedEntities(expected, expectedCount);
+
+            /* A box as wide as the sphere, but longer along y. */
+            const Vector3 boxMin = { point.x - radius, point.y - radius * 2.f, point.z - radius };
+            const Vector3 boxMax = { point.x + radius, point.y + radius * 2.f, point.z + radius };
+            expectedCount = 0U;
+            for (uint32_t i = 0U; i < transforms.GetSize(); ++i)
+            {
+                const Vector3& p = transforms.GetDenseComponents()[i].myPosition;
+                if (p.x >= boxMin.x && p.y >= boxMin.y && p.z >= boxMin.z && p.x <= boxMax.x && p.y <= boxMax.y && p.z <= boxMax.z)
+                {
+                    expected[expectedCount++] = transforms.GetEntityFromComponent(i);
+                }
+            }
+
+            const uint32_t boxCount = grid.QueryAABB(boxMin, boxMax, found, MAX_ENTITIES);
+            isAABBExact = isAABBExact && boxCount == expectedCount && SortedEntities(found, boxCount) == SortedEntities(expected, expectedCount);
+        }
+
+        /* Ties may come back in any order, so compare the distances rather than the entities. */
+        std::vector<float> distances;
+        for (uint32_t i = 0U; i < transforms.GetSize(); ++i)
+        {
+            distances.push_back(DistanceSquared(transforms.GetDenseComponents()[i].myPosition, point));
+        }
+        std::sort(distances.begin(), distances.end());
+
+        for (const uint32_t count : nearestCounts)
+        {
+            const uint32_t foundCount = grid.QueryNearest(point, count, found);
+            isNearestExact = isNearestExact && foundCount == count;
+            for (uint32_t i = 0U; isNearestExact && i < foundCount; ++i)
+            {
+                isNearestExact = DistanceSquared(transforms.GetComponent(found[i]).myPosition, point) == distances[i];
+            }
+        }
+    }
+
+    bool succeeded = Expect(isRadiusExact, "grid", "Radius queries differ from a brute force scan.");
+    succeeded = Expect(isAABBExact, "grid", "AABB queries differ from a brute force scan.") && succeeded;
+    succeeded = Expect(isNearestExact, "grid", "Nearest queries differ from a brute force scan.") && succeeded;
+
+    /* Pairs up to a full cell apart, the most the 13 neighbour offsets have to reach. The coarse grid has enough pairs to hit every offset. */
+    for (const float cellSize : { Config::gridCellSize, Config::coarseCellSize })
+    {
+        cloud->myGrid.Init(Config::gridMin, Config::gridMax, cellSize);
+        cloud->myGrid.Build(&transforms, &cloud->myJobSystem);
+
+        std::vector<uint64_t> expectedPairs;
+        for (uint32_t i = 0U; i < transforms.GetSize(); ++i)
+        {
+            for (uint32_t j = i + 1U; j < transforms.GetSize(); ++j)
+            {
+                if (DistanceSquared(transforms.GetDenseComponents()[i].myPosition, transforms.GetDenseComponents()[j].myPosition) < cellSize * cellSize)
+                {
+                    expectedPairs.push_back(PairKey(transforms.GetEntityFromComponent(i), transforms.GetEntityFromComponent(j)));
+                }
+            }
+        }
+        std::sort(expectedPairs.begin(), expectedPairs.end());
+
+        std::vector<uint64_t> pairs;
+        grid.ForEachPair(cellSize, [&](const SpatialGrid::Entry& aFirst, const SpatialGrid::Entry& aSecond)
+        {
+            pairs.push_back(PairKey(aFirst.myEntity, aSecond.myEntity));
+        });
+        std::sort(pairs.begin(), pairs.end());
+
+        std::vector<uint64_t> parallelPairs;
+        std::mutex parallelPairsMutex;
+        grid.ForEachPairParallel(cellSize, &cloud->myJobSystem, [&](const SpatialGrid::Entry& aFirst, const SpatialGrid::Entry& aSecond)
+        {
+            std::lock_guard<std::mutex> lock(parallelPairsMutex);
+            parallelPairs.push_back(PairKey(aFirst.myEntity, aSecond.myEntity));
+        });
+        std::sort(parallelPairs.begin(), parallelPairs.end());
+
+        succeeded = Expect(!expectedPairs.empty(), "grid", "The cloud is too sparse to have close pairs.") && succeeded;
+        succeeded = Expect(pairs == expectedPairs, "grid", "Pairs differ from a brute force scan.") && succeeded;
+        succeeded = Expect(parallelPairs == expectedPairs, "grid", "Parallel pairs differ from a brute force scan.") && succeeded;
+    }
+
+    delete cloud;
+
+    return succeeded;
+}
+
+/* The cloud's entities with models of mixed scale, most of them moving. Models are not loaded, so all use placeholder bounds. */
+struct Pile
+{
+    ComponentList<TransformComponent> myTransformComponents;
+    ComponentList<MovementComponent> myMovementComponents;
+    ComponentList<ModelComponent> myModelComponents;
+    CollisionState myCollisionState;
+    JobSystem myJobSystem;
+
+    explicit Pile(uint32_t aWorkerCount)
+    {
+        Random random(Config::cloudSize);
+        for (Entity e = 0U; e < Config::cloudSize; ++e)
+        {
+            myTransformComponents.AddComponent(e).myPosition = {
+                random.NextFloat() * Config::pileSize, random.NextFloat() * Config::pileSize, random.NextFloat() * Config::pileSize,
+            };
+            myModelComponents.AddComponent(e) = { (ModelID)1000, WHITE, 0.5f + random.NextFloat() * 2.5f };
+            if (e % 4U != 0U)
+            {
+                myMovementComponents.AddComponent(e).myVelocity = { random.NextFloat() - 0.5f, random.NextFloat() - 0.5f, random.NextFloat() - 0.5f };
+            }
+        }
+
+        myJobSystem.Init(aWorkerCount);
+    }
+
+    void Collide()
+    {
+        Systems::Collide(&myTransformComponents, &myMovementComponents, &myModelComponents, &myCollisionState, &myJobSystem);
+    }
+};
+
+static bool CheckCollide()
+{
+    Pile* serial = new Pile(0U);
+    Pile* parallel = new Pile(Config::cloudWorkers);
+
+    /* Same sums in the same order as the sweep, so the overlap tests agree exactly. */
+    std::vector<uint64_t> expectedPairs;
+    Vector4 spheres[Config::cloudSize];
+    for (Entity e = 0U; e < Config::cloudSize; ++e)
+    {
+        const Vector3& position = serial->myTransformComponents.GetComponent(e).myPosition;
+        const ModelComponent& model = serial->myModelComponents.GetComponent(e);
+        const BoundingSphere bounds = ModelManager::GetBoundingSphere(model.myModel);
+        spheres[e] = {
+            position.x + bounds.myCenter.x * model.myScale,
+            position.y + bounds.myCenter.y * model.myScale,
+            position.z + bounds.myCenter.z * model.myScale,
+            bounds.myRadius * model.myScale,
+        };
+    }
+    for (Entity a = 0U; a < Config::cloudSize; ++a)
+    {
+        for (Entity b = a + 1U; b < Config::cloudSize; ++b)
+        {
+            const float dx = spheres[b].x - spheres[a].x, dy = spheres[b].y - spheres[a].y, dz = spheres[b].z - spheres[a].z;
+            const float radiusSum = spheres[b].w + spheres[a].w;
+            if (dx * dx + dy * dy + dz * dz < radiusSum * radiusSum)
+            {
+                expectedPairs.push_back(PairKey(a, b));
+            }
+        }
+    }
+    std::sort(expectedPairs.begin(), expectedPairs.end());
+
+    serial->Collide();
+
+    const CollisionState& state = serial->myCollisionState;
+    std::vector<uint64_t> pairs;
+    for (uint32_t p = 0U; p < state.myPairCount.load(); ++p)
+    {
+        pairs.push_back(PairKey(state.myEntities[(state.myPairs[p] >> 16) & 0xFFFFU], state.myEntities[state.myPairs[p] & 0xFFFFU]));
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    bool succeeded = Expect(!expectedPairs.empty(), "collide", "The pile is too sparse to have overlaps.");
+    succeeded = Expect(pairs == expectedPairs, "collide", "Pairs differ from a brute force scan.") && succeeded;
+
+    /* Batches run on the workers now; positions and velocities have to come out bit for bit the same. */
+    parallel->Collide();
+    for (uint32_t step = 1U; step < Config::pileSteps; ++step)
+    {
+        serial->Collide();
+        parallel->Collide();
+    }
+
+    bool isSame = true;
+    for (Entity e = 0U; e < Config::cloudSize; ++e)
+    {
+        isSame = isSame && memcmp(&serial->myTransformComponents.GetComponent(e), &parallel->myTransformComponents.GetComponent(e), sizeof(TransformComponent)) == 0;
+        isSame = isSame && serial->myMovementComponents.HasComponent(e) == parallel->myMovementComponents.HasComponent(e);
+        isSame = isSame && (!serial->myMovementComponents.HasComponent(e)
+            || memcmp(&serial->myMovementComponents.GetComponent(e), &parallel->myMovementComponents.GetComponent(e), sizeof(MovementComponent)) == 0);
+    }
+    succeeded = Expect(isSame, "collide", "Resolving on workers gave another result than resolving serially.") && succeeded;
+
+    delete parallel;
+    delete serial;
+
+    return succeeded;
+}
+
+/* Runs aFunction(thread) on Config::contendingThreads threads at once and waits for all of them. */
+template <class Function>
+static void RunContending(const Function& aFunction)
+{
+    std::thread threads[Config::contendingThreads];
+    for (uint32_t t = 0U; t < Config::contendingThreads; ++t)
+    {
+        threads[t] = std::thread(aFunction, t);
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+static bool CheckBits()
+{
+    AtomicBitArray<MAX_ENTITIES>* shared = new AtomicBitArray<MAX_ENTITIES>();
+    bool isMergeSetExact = true, isMergeResetExact = true;
+
+    for (uint32_t round = 0U; round < Config::contentionRounds; ++round)
+    {
+        /* Bits are dealt out round robin, so every thread writes to every word. Each keeps every other bit it got. */
+        BitArray<MAX_ENTITIES> expected;
+        for (size_t bit = 0U; bit < MAX_ENTITIES; ++bit)
+        {
+            expected.Set(bit, (bit / Config::contendingThreads) % 2U == round % 2U);
+        }
+
+        shared->ResetAll();
+        RunContending([&](uint32_t aThread)
+        {
+            BitArray<MAX_ENTITIES> mine;
+            for (size_t bit = aThread; bit < MAX_ENTITIES; bit += Config::contendingThreads)
+            {
+                mine.Set(bit);
+            }
+            shared->MergeSet(mine);
+        });
+        isMergeSetExact = isMergeSetExact && shared->Count() == MAX_ENTITIES;
+
+        RunContending([&](uint32_t aThread)
+        {
+            BitArray<MAX_ENTITIES> dropped;
+            for (size_t bit = aThread; bit < MAX_ENTITIES; bit += Config::contendingThreads)
+            {
+                dropped.Set(bit, !expected.Test(bit));
+            }
+            shared->MergeReset(dropped);
+        });
+        isMergeResetExact = isMergeResetExact && shared->Load() == expected && shared->Count() == MAX_ENTITIES / 2U;
+    }
+
+    delete shared;
+
+    bool succeeded = Expect(isMergeSetExact, "bits", "Concurrent MergeSet lost bits.");
+    succeeded = Expect(isMergeResetExact, "bits", "Concurrent MergeReset lost or kept the wrong bits.") && succeeded;
+
+    return succeeded;
+}
+
+static bool CheckEntities()
+{
+    EntityService* service = new EntityService();
+    bool isDisjoint = true, isCountExact = true, isOccupiedExact = true, isDrained = true;
+
+    for (uint32_t round = 0U; round < Config::contentionRounds; ++round)
+    {
+        /* Each thread takes a share of the pool through its own cache, then hands every other entity back. */
+        std::vector<Entity> kept[Config::contendingThreads];
+        RunContending([&](uint32_t aThread)
+        {
+            EntityService::Cache cache;
+            std::vector<Entity> taken;
+            for (uint32_t i = 0U; i < MAX_ENTITIES / Config::contendingThreads; ++i)
+            {
+                const Entity entity = service->GetEntity(&cache);
+                if (entity != INVALID_ENTITY)
+                {
+                    taken.push_back(entity);
+                }
+            }
+
+            for (size_t i = 0U; i < taken.size(); ++i)
+            {
+                if (i % 2U == 0U)
+                {
+                    service->ReturnEntity(&cache, taken[i]);
+                }
+                else
+                {
+                    kept[aThread].push_back(taken[i]);
+                }
+            }
+            service->FlushCache(&cache);
+        });
+
+        BitArray<MAX_ENTITIES> expected;
+        size_t keptCount = 0U;
+        for (const std::vector<Entity>& entities : kept)
+        {
+            for (const Entity entity : entities)
+            {
+                isDisjoint = isDisjoint && !expected.Test(entity);
+                expected.Set(entity);
+                ++keptCount;
+            }
+        }
+        isCountExact = isCountExact && service->Count() == keptCount && keptCount > 0U;
+        isOccupiedExact = isOccupiedExact && service->GetOccupiedEntities() == expected;
+
+        RunContending([&](uint32_t aThread)
+        {
+            EntityService::Cache cache;
+            for (const Entity entity : kept[aThread])
+            {
+                service->ReturnEntity(&cache, entity);
+            }
+            service->FlushCache(&cache);
+        });
+        isDrained = isDrained && service->Count() == 0U;
+    }
+
+    /* Nothing may have leaked out of the pool: every entity can still be created once. */
+    BitArray<MAX_ENTITIES> created;
+    for (uint32_t i = 0U; i < MAX_ENTITIES; ++i)
+    {
+        EntityService::Cache cache;
+        const Entity entity = service->GetEntity(&cache);
+        isDrained = isDrained && entity != INVALID_ENTITY && !created.Test(entity);
+        if (entity != INVALID_ENTITY)
+        {
+            created.Set(entity);
+        }
+        service->FlushCache(&cache);
+    }
+
+    delete service;
+
+    bool succeeded = Expect(isDisjoint, "entities", "Two threads were handed the same entity.");
+    succeeded = Expect(isCountExact, "entities", "Count() differs from the entities threads kept.") && succeeded;
+    succeeded = Expect(isOccupiedExact, "entities", "Occupied entities differ from the ones threads kept.") && succeeded;
+    succeeded = Expect(isDrained, "entities", "Entities were lost after every thread handed its own back.") && succeeded;
+
+    return succeeded;
+}
+
+struct SelfTestTag
+{
+};
+
+static bool CheckTags()
+{
+    /* Both sides of every word edge the scans cross, and the last entity. */
+    const size_t edges[] = { 0U, 1U, 62U, 63U, 64U, 65U, 127U, 128U, 703U, 704U, MAX_ENTITIES - 2U, MAX_ENTITIES - 1U };
+
+    bool isFindNextExact = true;
+    for (const size_t bit : edges)
+    {
+        BitArray<MAX_ENTITIES> bits;
+        bits.Set(bit);
+        for (const size_t from : edges)
+        {
+            isFindNextExact = isFindNextExact && bits.FindNext(from) == (from <= bit ? bit : MAX_ENTITIES);
+        }
+        isFindNextExact = isFindNextExact && bits.FindNext(MAX_ENTITIES) == MAX_ENTITIES;
+    }
+    isFindNextExact = isFindNextExact && BitArray<MAX_ENTITIES>().FindNext(0U) == MAX_ENTITIES;
+
+    /* SetAll() fills the unused bits of a partial last word, which a scan must never report. */
+    BitArray<100> partial;
+    partial.SetAll();
+    isFindNextExact = isFindNextExact && partial.FindNext(64U) == 64U && partial.FindNext(99U) == 99U;
+    partial.Reset(99U);
+    isFindNextExact = isFindNextExact && partial.FindNext(99U) == partial.Size();
+
+    ComponentList<SelfTestTag>* tags = new ComponentList<SelfTestTag>();
+    ComponentList<TransformComponent>* transforms = new ComponentList<TransformComponent>();
+    Query<With<SelfTestTag, TransformComponent>>* tagged = new Query<With<SelfTestTag, TransformComponent>>(*tags, *transforms);
+
+    /* Every edge is tagged; every other one also has a transform. */
+    std::vector<Entity> expectedTagged, expectedQueried;
+    for (size_t i = 0U; i < sizeof(edges) / sizeof(edges[0]); ++i)
+    {
+        tags->AddComponent((Entity)edges[i]);
+        expectedTagged.push_back((Entity)edges[i]);
+        if (i % 2U == 1U)
+        {
+            transforms->AddComponent((Entity)edges[i]);
+            expectedQueried.push_back((Entity)edges[i]);
+        }
+    }
+
+    std::vector<Entity> visited;
+    tags->ForEachEntity([&](Entity anEntity) { visited.push_back(anEntity); });
+    const bool isIterationExact = visited == expectedTagged && tags->GetSize() == expectedTagged.size();
+    bool isQueryExact = SortedEntities(tagged->GetEntities(), tagged->GetSize()) == expectedQueried;
+
+    /* The last entity leaves the query with its tag. */
+    tags->RemoveComponent(MAX_ENTITIES - 1U);
+    expectedQueried.pop_back();
+    isQueryExact = isQueryExact && SortedEntities(tagged->GetEntities(), tagged->GetSize()) == expectedQueried;
+
+    /* A snapshot holds the membership bits alone; the count is rebuilt from them. */
+    ComponentList<SelfTestTag>* loaded = new ComponentList<SelfTestTag>();
+    SnapshotWriter writer;
+    SnapshotReader reader;
+    bool isRestored = tags->Serialize(writer, 0U) && writer.Save(Config::snapshotPath) && reader.Open(Config::snapshotPath) && loaded->Serialize(reader, 0U);
+    isRestored = isRestored && loaded->GetEntitiesContainingComponent() == tags->GetEntitiesContainingComponent() && loaded->GetSize() == tags->GetSize();
+    reader.Close();
+    remove(Config::snapshotPath);
+
+    tags->Clear();
+    isQueryExact = isQueryExact && tagged->GetSize() == 0U && tags->GetSize() == 0U;
+
+    delete loaded;
+    delete tagged;
+    delete transforms;
+    delete tags;
+
+    bool succeeded = Expect(isFindNextExact, "tags", "FindNext missed a bit at a word edge or reported one past the end.");
+    succeeded = Expect(isIterationExact, "tags", "A tag list skipped, repeated or reordered its entities.") && succeeded;
+    succeeded = Expect(isQueryExact, "tags", "A query on a tag list kept the wrong matches.") && succeeded;
+    succeeded = Expect(isRestored, "tags", "A tag list came back from a snapshot with other members.") && succeeded;
+
+    return succeeded;
+}
+
+struct Check
+{
+    const char* myName;
+    bool (*myRun)();
+};
+
+int main(int argc, char** argv)
+{
+    const Check checks[] = {
+        { "snapshot", CheckSnapshot },
+        { "worlds", CheckWorlds },
+        { "replication", CheckReplication },
+        { "optimize", CheckOptimize },
+        { "simplify", CheckSimplify },
+        { "culling", CheckCulling },
+        { "render", CheckRender },
+        { "grid", CheckGrid },
+        { "collide", CheckCollide },
+        { "bits", CheckBits },
+        { "entities", CheckEntities },
+        { "tags", CheckTags },
+    };
+
+    for (int i = 1; i < argc; ++i)
+    {
+        bool isKnown = false;
+        for (const Check& check : checks)
+        {
+            isKnown = isKnown || strcmp(argv[i], check.myName) == 0;
+        }
+
+        if (!isKnown)
+        {
+            fprintf(stderr, "SELFTEST: Unknown check '%s'.\n", argv[i]);
+            return 1;
+        }
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(Config::screenWidth, Config::screenHeight, Config::title);
+    Game::Init();
+
+    /* Worlds pick up model bounds, so checksums only compare once every model has finished loading. */
+    while (ModelManager::GetPendingCount() > 0U)
+    {
+        Game::UpdateAssets();
+        std::this_thread::yield();
+    }
+
+    uint32_t failedCount = 0U;
+    for (const Check& check : checks)
+    {
+        bool isSelected = argc == 1;
+        for (int i = 1; i < argc; ++i)
+        {
+            isSelected = isSelected || strcmp(argv[i], check.myName) == 0;
+        }
+        if (!isSelected)
+        {
+            continue;
+        }
+
+        const bool passed = check.myRun();
+        printf("%-12s %s\n", check.myName, passed ? "passed" : "FAILED");
+        failedCount += passed ? 0U : 1U;
+    }
+
+    Game::Terminate();
+    CloseWindow();
+
+    return failedCount > 0U ? 1 : 0;
+}
@@ -0,0 +1,220 @@
+#include "Allocators.h"
+
+#include <new>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#define ALLOCATORS_USE_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+/* The usual x86-64 and AArch64 huge page; explicit huge page mappings have to be a multiple of it. */
+constexpr uint64_t HUGE_PAGE_SIZE = 2ULL * 1024ULL * 1024ULL;
+#endif
+
+static uint64_t RoundUp(uint64_t aValue, uint64_t aMultiple)
+{
+	return (aValue + aMultiple - 1U) / aMultiple * aMultiple;
+}
+
+bool HugePageRegion::Init(uint64_t aSize)
+{
+	Terminate();
+
+	if (aSize == 0U)
+	{
+		return false;
+	}
+
+#if defined(_WIN32)
+	const SIZE_T largePageSize = GetLargePageMinimum();
+	if (largePageSize > 0U)
+	{
+		const uint64_t size = RoundUp(aSize, largePageSize);
+		myData = VirtualAlloc(nullptr, (SIZE_T)size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (myData)
+		{
+			mySize = size;
+			myIsHugePages = true;
+			myIsMapped = true;
+			return true;
+		}
+	}
+
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	const uint64_t size = RoundUp(aSize, info.dwPageSize);
+	myData = VirtualAlloc(nullptr, (SIZE_T)size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	if (myData)
+	{
+		mySize = size;
+		myIsMapped = true;
+		return true;
+	}
+#elif defined(ALLOCATORS_USE_MMAP)
+#if defined(__linux__) && defined(MAP_HUGETLB)
+	{
+		const uint64_t size = RoundUp(aSize, HUGE_PAGE_SIZE);
+		void* data = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (data != MAP_FAILED)
+		{
+			myData = data;
+			mySize = size;
+			myIsHugePages = true;
+			myIsMapped = true;
+			return true;
+		}
+	}
+#endif
+
+	const uint64_t size = RoundUp(aSize, (uint64_t)sysconf(_SC_PAGESIZE));
+	void* data = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (data != MAP_FAILED)
+	{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+		/* No hugetlbfs pages reserved; transparent huge pages may still back it. */
+		madvise(data, (size_t)size, MADV_HUGEPAGE);
+#endif
+		myData = data;
+		mySize = size;
+		myIsMapped = true;
+		return true;
+	}
+#endif
+
+	myData = malloc((size_t)aSize);
+	mySize = myData ? aSize : 0U;
+
+	return myData != nullptr;
+}
+
+void HugePageRegion::Terminate()
+{
+	if (!myData)
+	{
+		return;
+	}
+
+#if defined(_WIN32)
+	if (myIsMapped)
+	{
+		VirtualFree(myData, 0, MEM_RELEASE);
+	}
+	else
+#elif defined(ALLOCATORS_USE_MMAP)
+	if (myIsMapped)
+	{
+		munmap(myData, (size_t)mySize);
+	}
+	else
+#endif
+	{
+		free(myData);
+	}
+
+	myData = nullptr;
+	mySize = 0U;
+	myIsHugePages = false;
+	myIsMapped = false;
+}
+
+bool LinearArena::Init(uint64_t aCapacity)
+{
+	Terminate();
+
+	void* memory = malloc((size_t)aCapacity);
+	if (!memory)
+	{
+		return false;
+	}
+
+	Init(memory, aCapacity);
+	myIsOwner = true;
+
+	return true;
+}
+
+void LinearArena::Init(void* someMemory, uint64_t aCapacity)
+{
+	Terminate();
+
+	myData = (char*)someMemory;
+	myCapacity = aCapacity;
+	myOffset.store(0U, std::memory_order_relaxed);
+	myPeak = 0U;
+}
+
+void LinearArena::Terminate()
+{
+	if (myIsOwner)
+	{
+		free(myData);
+	}
+
+	myData = nullptr;
+	myCapacity = 0U;
+	myOffset.store(0U, std::memory_order_relaxed);
+	myPeak = 0U;
+	myIsOwner = false;
+}
+
+uint64_t FixedPool::GetRequiredSize(uint64_t aBlockSize, uint32_t aBlockCount)
+{
+	return RoundUp(aBlockSize * aBlockCount, alignof(std::atomic<uint32_t>)) + sizeof(std::atomic<uint32_t>) * aBlockCount;
+}
+
+bool FixedPool::Init(uint64_t aBlockSize, uint32_t aBlockCount)
+{
+	Terminate();
+
+	void* memory = malloc((size_t)GetRequiredSize(aBlockSize, aBlockCount));
+	if (!memory)
+	{
+		return false;
+	}
+
+	Init(memory, aBlockSize, aBlockCount);
+	myIsOwner = true;
+
+	return true;
+}
+
+void FixedPool::Init(void* someMemory, uint64_t aBlockSize, uint32_t aBlockCount)
+{
+	assert(aBlockSize > 0U && "Blocks have to hold something.");
+	assert((uintptr_t)someMemory % DEFAULT_ALLOCATION_ALIGNMENT == 0U && "Pool memory has to be aligned like malloc's.");
+
+	Terminate();
+
+	myData = (char*)someMemory;
+	myNextFree = (std::atomic<uint32_t>*)(myData + RoundUp(aBlockSize * aBlockCount, alignof(std::atomic<uint32_t>)));
+	myBlockSize = aBlockSize;
+	myBlockCount = aBlockCount;
+
+	/* Linked front to back, so blocks are handed out in address order. */
+	for (uint32_t block = 0U; block < aBlockCount; ++block)
+	{
+		new (myNextFree + block) std::atomic<uint32_t>(block + 1U);
+	}
+	myFreeList.store(0U, std::memory_order_relaxed);
+}
+
+void FixedPool::Terminate()
+{
+	if (myIsOwner)
+	{
+		free(myData);
+	}
+
+	myData = nullptr;
+	myNextFree = nullptr;
+	myBlockSize = 0U;
+	myBlockCount = 0U;
+	myFreeList.store(0U, std::memory_order_relaxed);
+	myIsOwner = false;
+}
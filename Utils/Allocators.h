@@ -0,0 +1,336 @@
+/*
+* Allocators
+*
+* Memory sources for containers that should not go through malloc for every
+* table or page:
+*
+*     HugePageRegion  one big block, backed by huge pages where the OS allows
+*     LinearArena     bump allocation, everything freed at once by Reset()
+*     FixedPool       equally sized blocks, freed and reused one at a time
+*
+* Arenas and pools either allocate their memory from the heap or carve it out
+* of memory given to Init(), such as a HugePageRegion. Containers such as
+* Dictionary take an allocator type with
+*
+*     void* Allocate(uint64_t aSize, uint64_t anAlignment);
+*     void Free(void* aPointer, uint64_t aSize);
+*
+* which MallocAllocator implements on the heap, and ArenaAllocator and
+* PoolAllocator by pointing at an arena or pool that outlives the container.
+*
+* Requirements: C++17
+*/
+
+#if !defined(ALLOCATORS_H_)
+#define ALLOCATORS_H_
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <assert.h>
+
+#include <atomic>
+
+/* Alignment the heap guarantees, and what arenas and pools hand out when nothing bigger is asked for. */
+constexpr uint64_t DEFAULT_ALLOCATION_ALIGNMENT = alignof(max_align_t);
+
+class HugePageRegion
+{
+public:
+	/* Constructors & Destructor */
+	HugePageRegion()
+		: myData(nullptr)
+		, mySize(0U)
+		, myIsHugePages(false)
+		, myIsMapped(false)
+	{
+	}
+	~HugePageRegion()
+	{
+		Terminate();
+	}
+
+	HugePageRegion(const HugePageRegion&) = delete;
+	HugePageRegion& operator=(const HugePageRegion&) = delete;
+
+	/* Interface */
+
+	/*
+	* Reserves and commits at least aSize bytes, rounded up to the page size.
+	* Tries explicit huge pages first (Linux hugetlbfs pages, Windows large
+	* pages, which need the "Lock pages in memory" privilege), then plain
+	* pages, advised for transparent huge pages on Linux. Returns false only
+	* if no memory could be had at all.
+	*/
+	bool Init(uint64_t aSize);
+	void Terminate();
+
+	/* Getters */
+	void* Data() const
+	{
+		return myData;
+	}
+
+	uint64_t Size() const
+	{
+		return mySize;
+	}
+
+	/* True if Init() got explicit huge pages rather than falling back. */
+	bool IsHugePages() const
+	{
+		return myIsHugePages;
+	}
+
+private:
+	void* myData;
+	uint64_t mySize;
+	bool myIsHugePages;
+	bool myIsMapped;
+};
+
+/*
+* Allocate() is lock-free and may be called from any number of threads at
+* once. Free() does nothing; Reset() takes everything back, for example at the
+* end of a frame, and must not overlap with anything else.
+*/
+class LinearArena
+{
+public:
+	/* Constructors & Destructor */
+	LinearArena()
+		: myData(nullptr)
+		, myCapacity(0U)
+		, myOffset(0U)
+		, myPeak(0U)
+		, myIsOwner(false)
+	{
+	}
+	~LinearArena()
+	{
+		Terminate();
+	}
+
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+
+	/* Interface */
+
+	/* Allocates aCapacity bytes from the heap. */
+	bool Init(uint64_t aCapacity);
+	/* Uses someMemory, which has to outlive the arena. */
+	void Init(void* someMemory, uint64_t aCapacity);
+	void Terminate();
+
+	/* Returns nullptr once the arena is full. */
+	void* Allocate(uint64_t aSize, uint64_t anAlignment = DEFAULT_ALLOCATION_ALIGNMENT)
+	{
+		assert(anAlignment > 0U && (anAlignment & (anAlignment - 1U)) == 0U && "Alignment has to be a power of two.");
+
+		const uint64_t base = (uint64_t)(uintptr_t)myData;
+		uint64_t offset = myOffset.load(std::memory_order_relaxed);
+		uint64_t begin;
+		do
+		{
+			begin = ((base + offset + anAlignment - 1U) & ~(anAlignment - 1U)) - base;
+			if (begin + aSize > myCapacity)
+			{
+				return nullptr;
+			}
+		} while (!myOffset.compare_exchange_weak(offset, begin + aSize, std::memory_order_relaxed));
+
+		return myData + begin;
+	}
+	void Free(void*, uint64_t)
+	{
+	}
+
+	/* Frees every allocation at once. */
+	void Reset()
+	{
+		const uint64_t used = myOffset.load(std::memory_order_relaxed);
+		myPeak = used > myPeak ? used : myPeak;
+		myOffset.store(0U, std::memory_order_relaxed);
+	}
+
+	/* Getters */
+	uint64_t GetUsed() const
+	{
+		return myOffset.load(std::memory_order_relaxed);
+	}
+
+	uint64_t GetCapacity() const
+	{
+		return myCapacity;
+	}
+
+	/* Most bytes in use before any Reset() so far, for sizing the arena. */
+	uint64_t GetPeak() const
+	{
+		const uint64_t used = GetUsed();
+		return used > myPeak ? used : myPeak;
+	}
+
+private:
+	char* myData;
+	uint64_t myCapacity;
+	std::atomic<uint64_t> myOffset;
+	uint64_t myPeak;
+	bool myIsOwner;
+};
+
+/*
+* Allocate() and Free() are lock-free and may be called from any number of
+* threads at once. Blocks are aligned to the largest power of two that
+* divides the block size, up to DEFAULT_ALLOCATION_ALIGNMENT.
+*/
+class FixedPool
+{
+public:
+	/* Constructors & Destructor */
+	FixedPool()
+		: myData(nullptr)
+		, myNextFree(nullptr)
+		, myBlockSize(0U)
+		, myBlockCount(0U)
+		, myFreeList(0U)
+		, myIsOwner(false)
+	{
+	}
+	~FixedPool()
+	{
+		Terminate();
+	}
+
+	FixedPool(const FixedPool&) = delete;
+	FixedPool& operator=(const FixedPool&) = delete;
+
+	/* Interface */
+
+	/* Allocates aBlockCount blocks of aBlockSize bytes from the heap. */
+	bool Init(uint64_t aBlockSize, uint32_t aBlockCount);
+	/* Uses someMemory, which has to hold GetRequiredSize() bytes and outlive the pool. */
+	void Init(void* someMemory, uint64_t aBlockSize, uint32_t aBlockCount);
+	void Terminate();
+
+	static uint64_t GetRequiredSize(uint64_t aBlockSize, uint32_t aBlockCount);
+
+	/* Returns nullptr if the pool is empty, or aSize does not fit in a block or anAlignment not on one. */
+	void* Allocate(uint64_t aSize, uint64_t anAlignment = DEFAULT_ALLOCATION_ALIGNMENT)
+	{
+		if (aSize > myBlockSize || anAlignment > DEFAULT_ALLOCATION_ALIGNMENT || (myBlockSize & (anAlignment - 1U)) != 0U)
+		{
+			return nullptr;
+		}
+
+		uint64_t head = myFreeList.load(std::memory_order_acquire);
+		while (true)
+		{
+			const uint32_t block = (uint32_t)head;
+			if (block == myBlockCount)
+			{
+				return nullptr;
+			}
+
+			/* May read a block another thread just took; the pop count then fails the exchange. */
+			const uint32_t next = myNextFree[block].load(std::memory_order_relaxed);
+			const uint64_t newHead = ((head >> 32U) + 1U) << 32U | next;
+			if (myFreeList.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire))
+			{
+				return myData + block * myBlockSize;
+			}
+		}
+	}
+	void Free(void* aPointer, uint64_t)
+	{
+		if (!aPointer)
+		{
+			return;
+		}
+
+		assert((char*)aPointer >= myData && (char*)aPointer < myData + myBlockSize * myBlockCount && "Pointer not from this pool.");
+		PushFree((uint32_t)(((char*)aPointer - myData) / myBlockSize));
+	}
+
+	/* Getters */
+	uint64_t GetBlockSize() const
+	{
+		return myBlockSize;
+	}
+
+	uint32_t GetBlockCount() const
+	{
+		return myBlockCount;
+	}
+
+private:
+	void PushFree(uint32_t aBlock)
+	{
+		uint64_t head = myFreeList.load(std::memory_order_relaxed);
+		uint64_t newHead;
+		do
+		{
+			myNextFree[aBlock].store((uint32_t)head, std::memory_order_relaxed);
+			newHead = ((head >> 32U) + 1U) << 32U | aBlock;
+		} while (!myFreeList.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	char* myData;
+	/* Next free block after each free block; myBlockCount ends the list. */
+	std::atomic<uint32_t>* myNextFree;
+	uint64_t myBlockSize;
+	uint32_t myBlockCount;
+	/* First free block in the low half, a push count against ABA in the high half. */
+	std::atomic<uint64_t> myFreeList;
+	bool myIsOwner;
+};
+
+/* The default for containers: plain malloc and free. */
+struct MallocAllocator
+{
+	void* Allocate(uint64_t aSize, uint64_t anAlignment = DEFAULT_ALLOCATION_ALIGNMENT)
+	{
+		assert(anAlignment <= DEFAULT_ALLOCATION_ALIGNMENT && "malloc does not align that far.");
+		(void)anAlignment;
+
+		return malloc(aSize);
+	}
+	void Free(void* aPointer, uint64_t)
+	{
+		free(aPointer);
+	}
+};
+
+/* Container allocators that forward to an arena or pool owned elsewhere. */
+struct ArenaAllocator
+{
+	LinearArena* myArena = nullptr;
+
+	void* Allocate(uint64_t aSize, uint64_t anAlignment = DEFAULT_ALLOCATION_ALIGNMENT)
+	{
+		return myArena->Allocate(aSize, anAlignment);
+	}
+	void Free(void* aPointer, uint64_t aSize)
+	{
+		myArena->Free(aPointer, aSize);
+	}
+};
+
+struct PoolAllocator
+{
+	FixedPool* myPool = nullptr;
+
+	void* Allocate(uint64_t aSize, uint64_t anAlignment = DEFAULT_ALLOCATION_ALIGNMENT)
+	{
+		return myPool->Allocate(aSize, anAlignment);
+	}
+	void Free(void* aPointer, uint64_t aSize)
+	{
+		myPool->Free(aPointer, aSize);
+	}
+};
+
+#endif // ALLOCATORS_H_
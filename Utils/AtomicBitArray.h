@@ -0,0 +1,240 @@
+/*
+* AtomicBitArray
+*
+* BitArray whose bits many threads may set and reset at once, each change a
+* single fetch_or or fetch_and on its word. For many changes per thread,
+* gather them in a plain BitArray local to the thread and merge it in once at
+* the end with MergeSet() or MergeReset(), which costs one atomic per
+* non-zero word instead of one per bit.
+*
+* Requirements: C++17
+*/
+
+#if !defined(ATOMICBITARRAY_H_)
+#define ATOMICBITARRAY_H_
+
+#pragma once
+
+#include <stdint.h>
+
+#include <assert.h>
+
+#include <atomic>
+
+#include "BitArray.h"
+
+template <size_t size>
+class AtomicBitArray
+{
+	using dataType = uint64_t;
+
+	static_assert(size > 0, "Attempting to create an empty bitarray.");
+public:
+	/* Constructors & Destructor */
+	AtomicBitArray()
+	{
+		ResetAll();
+	}
+	~AtomicBitArray() = default;
+
+	AtomicBitArray(const AtomicBitArray<size>&) = delete;
+	AtomicBitArray& operator=(const AtomicBitArray<size>&) = delete;
+
+	/* Interface */
+
+	/* Getters */
+	size_t Size() const
+	{
+		return size;
+	}
+
+	bool Test(size_t anIndex) const
+	{
+		assert(anIndex < size && "Index out of range.");
+
+		return (myData[anIndex / ourSizeOfType].load(std::memory_order_acquire) >> (anIndex % ourSizeOfType)) & 1;
+	}
+
+	bool Any() const
+	{
+		for (size_t index = 0; index < dataCount; ++index)
+		{
+			if (myData[index].load(std::memory_order_acquire))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	size_t Count() const
+	{
+		size_t count = 0U;
+
+		for (size_t index = 0; index < dataCount; ++index)
+		{
+			count += PopCount(myData[index].load(std::memory_order_acquire));
+		}
+
+		return count;
+	}
+
+	/* Copies every word in turn; changes made meanwhile may be seen in some words and not others. */
+	BitArray<size> Load() const
+	{
+		BitArray<size> bits;
+
+		for (size_t index = 0; index < dataCount; ++index)
+		{
+			for (dataType word = myData[index].load(std::memory_order_acquire); word; word &= word - 1U)
+			{
+				bits.Set(index * ourSizeOfType + CountTrailingZeros(word));
+			}
+		}
+
+		return bits;
+	}
+
+	/* Setters, each returning the previous value of the bit */
+	bool Set(size_t anIndex)
+	{
+		assert(anIndex < size && "Index out of range.");
+
+		const dataType mask = dataType(1U) << (anIndex % ourSizeOfType);
+		return (myData[anIndex / ourSizeOfType].fetch_or(mask, std::memory_order_acq_rel) & mask) != 0;
+	}
+
+	bool Set(size_t anIndex, bool aValue)
+	{
+		return aValue ? Set(anIndex) : Reset(anIndex);
+	}
+
+	bool Reset(size_t anIndex)
+	{
+		assert(anIndex < size && "Index out of range.");
+
+		const dataType mask = dataType(1U) << (anIndex % ourSizeOfType);
+		return (myData[anIndex / ourSizeOfType].fetch_and(~mask, std::memory_order_acq_rel) & mask) != 0;
+	}
+
+	bool Flip(size_t anIndex)
+	{
+		assert(anIndex < size && "Index out of range.");
+
+		const dataType mask = dataType(1U) << (anIndex % ourSizeOfType);
+		return (myData[anIndex / ourSizeOfType].fetch_xor(mask, std::memory_order_acq_rel) & mask) != 0;
+	}
+
+	/* Sets every bit set in aMask. */
+	void MergeSet(const BitArray<size>& aMask)
+	{
+		ForEachWord(aMask, [this](size_t anIndex, dataType aWord)
+		{
+			myData[anIndex].fetch_or(aWord, std::memory_order_acq_rel);
+		});
+	}
+
+	/* Resets every bit set in aMask. */
+	void MergeReset(const BitArray<size>& aMask)
+	{
+		ForEachWord(aMask, [this](size_t anIndex, dataType aWord)
+		{
+			myData[anIndex].fetch_and(~aWord, std::memory_order_acq_rel);
+		});
+	}
+
+	/* Whole-array writes; not atomic as a whole, so keep them out of parallel sections. */
+	void Store(const BitArray<size>& aBitArray)
+	{
+		dataType words[dataCount] = {};
+		ForEachWord(aBitArray, [&words](size_t anIndex, dataType aWord)
+		{
+			words[anIndex] = aWord;
+		});
+
+		for (size_t index = 0; index < dataCount; ++index)
+		{
+			myData[index].store(words[index], std::memory_order_release);
+		}
+	}
+
+	void SetAll()
+	{
+		for (size_t index = 0; index + 1 < dataCount; ++index)
+		{
+			myData[index].store(~dataType(0), std::memory_order_release);
+		}
+
+		/* Unlike BitArray::SetAll(), leaves the unused bits past the end clear so Count() stays exact. */
+		const size_t usedBits = size - (dataCount - 1) * ourSizeOfType;
+		myData[dataCount - 1].store(usedBits == ourSizeOfType ? ~dataType(0) : (dataType(1U) << usedBits) - 1U, std::memory_order_release);
+	}
+
+	void ResetAll()
+	{
+		for (size_t index = 0; index < dataCount; ++index)
+		{
+			myData[index].store(0, std::memory_order_release);
+		}
+	}
+
+private:
+	/* Calls aFunction(index, word) for every word of aBitArray with a bit set, gathered through FindNext(). */
+	template <class Function>
+	static void ForEachWord(const BitArray<size>& aBitArray, const Function& aFunction)
+	{
+		size_t bit = aBitArray.FindNext(0);
+		while (bit < size)
+		{
+			const size_t index = bit / ourSizeOfType;
+			dataType word = 0;
+			for (; bit < size && bit / ourSizeOfType == index; bit = aBitArray.FindNext(bit + 1))
+			{
+				word |= dataType(1U) << (bit % ourSizeOfType);
+			}
+
+			aFunction(index, word);
+		}
+	}
+
+	static size_t CountTrailingZeros(dataType aWord)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanForward64(&index, aWord);
+		return index;
+#elif defined(_MSC_VER)
+		size_t index = 0U;
+		for (; !((aWord >> index) & 1U); ++index)
+		{
+		}
+		return index;
+#else
+		return (size_t)__builtin_ctzll(aWord);
+#endif
+	}
+
+	static size_t PopCount(dataType aWord)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		return (size_t)__popcnt64(aWord);
+#elif defined(_MSC_VER)
+		size_t count = 0U;
+		for (; aWord; aWord &= aWord - 1U)
+		{
+			++count;
+		}
+		return count;
+#else
+		return (size_t)__builtin_popcountll(aWord);
+#endif
+	}
+
+	static constexpr size_t ourSizeOfType = sizeof(dataType) * 8U;
+	static constexpr size_t dataCount = (size - 1) / ourSizeOfType + 1;
+
+	std::atomic<dataType> myData[dataCount];
+};
+
+#endif // ATOMICBITARRAY_H_
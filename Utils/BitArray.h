@@ -16,6 +16,10 @@
 
 #include <assert.h>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 template <size_t size>
 class BitArray
 {
@@ -68,6 +72,30 @@ public:
 		return size;
 	}
 
+	/* Index of the first set bit at or after aFrom, or Size() if there is none. Skips clear words whole. */
+	size_t FindNext(size_t aFrom) const
+	{
+		if (aFrom >= size)
+		{
+			return size;
+		}
+
+		size_t index = aFrom / ourSizeOfType;
+		dataType word = myData[index] & (~dataType(0) << (aFrom % ourSizeOfType));
+		while (word == 0)
+		{
+			if (++index == dataCount)
+			{
+				return size;
+			}
+			word = myData[index];
+		}
+
+		/* SetAll() also sets the unused bits past the end. */
+		const size_t bit = index * ourSizeOfType + CountTrailingZeros(word);
+		return bit < size ? bit : size;
+	}
+
 	bool Test(size_t anIndex) const
 	{
 		assert(anIndex < size && "Index out of range.");
@@ -255,6 +283,23 @@ public:
 	}
 
 private:
+	static size_t CountTrailingZeros(dataType aWord)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanForward64(&index, aWord);
+		return index;
+#elif defined(_MSC_VER)
+		size_t index = 0U;
+		for (; !((aWord >> index) & 1U); ++index)
+		{
+		}
+		return index;
+#else
+		return (size_t)__builtin_ctzll(aWord);
+#endif
+	}
+
 	static constexpr size_t ourSizeOfTypeBytes = sizeof(dataType);
 	static constexpr size_t ourSizeOfType = ourSizeOfTypeBytes * 8U;
 	static constexpr size_t dataCount = (size - 1) / ourSizeOfType + 1;
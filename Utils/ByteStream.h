@@ -0,0 +1,149 @@
+/*
+* ByteStream
+*
+* Growable little-endian byte writer and a bounds-checked reader over a
+* finished buffer. Used for network and replay payloads.
+*
+* Requirements: C++17
+*/
+
+#if !defined(BYTESTREAM_H_)
+#define BYTESTREAM_H_
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+class ByteWriter
+{
+public:
+	/* Constructors & Destructor */
+	ByteWriter()
+		: myData(nullptr)
+		, mySize(0U)
+		, myCapacity(0U)
+	{
+	}
+	~ByteWriter()
+	{
+		free(myData);
+	}
+
+	ByteWriter(const ByteWriter&) = delete;
+	ByteWriter& operator=(const ByteWriter&) = delete;
+
+	/* Interface */
+	void Clear()
+	{
+		mySize = 0U;
+	}
+
+	void WriteBytes(const void* aData, size_t aSize)
+	{
+		Reserve(mySize + aSize);
+		memcpy(myData + mySize, aData, aSize);
+		mySize += aSize;
+	}
+
+	void WriteU8(uint8_t aValue) { WriteBytes(&aValue, sizeof(aValue)); }
+	void WriteU16(uint16_t aValue) { WriteBytes(&aValue, sizeof(aValue)); }
+	void WriteU32(uint32_t aValue) { WriteBytes(&aValue, sizeof(aValue)); }
+	void WriteFloat(float aValue) { WriteBytes(&aValue, sizeof(aValue)); }
+
+	/* Overwrites bytes already written, for counts that are only known afterwards. */
+	void Patch(size_t anOffset, const void* aData, size_t aSize)
+	{
+		memcpy(myData + anOffset, aData, aSize);
+	}
+
+	/* Getters */
+	const uint8_t* Data() const
+	{
+		return myData;
+	}
+
+	size_t Size() const
+	{
+		return mySize;
+	}
+
+private:
+	void Reserve(size_t aCapacity)
+	{
+		if (aCapacity <= myCapacity)
+		{
+			return;
+		}
+
+		size_t newCapacity = myCapacity ? myCapacity * 2U : 256U;
+		while (newCapacity < aCapacity)
+		{
+			newCapacity *= 2U;
+		}
+
+		myData = (uint8_t*)realloc(myData, newCapacity);
+		myCapacity = newCapacity;
+	}
+
+	/* Members */
+	uint8_t* myData;
+	size_t mySize;
+	size_t myCapacity;
+};
+
+class ByteReader
+{
+public:
+	/* Constructors & Destructor */
+	ByteReader(const uint8_t* aData, size_t aSize)
+		: myData(aData)
+		, mySize(aSize)
+		, myCursor(0U)
+		, myFailed(false)
+	{
+	}
+	~ByteReader() = default;
+
+	/* Interface */
+	/* Reading past the end zero-fills the output and marks the reader as failed. */
+	bool ReadBytes(void* aDataOut, size_t aSize)
+	{
+		if (myFailed || aSize > mySize - myCursor)
+		{
+			myFailed = true;
+			memset(aDataOut, 0, aSize);
+			return false;
+		}
+
+		memcpy(aDataOut, myData + myCursor, aSize);
+		myCursor += aSize;
+		return true;
+	}
+
+	uint8_t ReadU8() { uint8_t value; ReadBytes(&value, sizeof(value)); return value; }
+	uint16_t ReadU16() { uint16_t value; ReadBytes(&value, sizeof(value)); return value; }
+	uint32_t ReadU32() { uint32_t value; ReadBytes(&value, sizeof(value)); return value; }
+	float ReadFloat() { float value; ReadBytes(&value, sizeof(value)); return value; }
+
+	/* Getters */
+	bool HasFailed() const
+	{
+		return myFailed;
+	}
+
+	bool IsAtEnd() const
+	{
+		return myCursor == mySize;
+	}
+
+private:
+	/* Members */
+	const uint8_t* myData;
+	size_t mySize;
+	size_t myCursor;
+	bool myFailed;
+};
+
+#endif // BYTESTREAM_H_
@@ -0,0 +1,363 @@
+/*
+* ConcurrentDictionary
+*
+* Hash map for lookup tables that many threads read and few write. Keys are
+* spread over shards by hash. Each shard publishes an immutable table through
+* an atomic pointer, so readers never lock, spin or write shared memory. A
+* writer locks only its shard, builds a new table with the change and swaps
+* it in (RCU-style). Replaced tables are kept until Reclaim(), which the owner
+* calls at a point where no reader can still be looking at them, such as once
+* per frame between parallel sections.
+*
+* Writes copy a whole shard, so this suits tables that change rarely, like
+* asset lookups. Use Dictionary for anything written often.
+*
+* Requirements: C++17
+*/
+
+#if !defined(CONCURRENTDICTIONARY_H_)
+#define CONCURRENTDICTIONARY_H_
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <new>
+
+#include <atomic>
+#include <mutex>
+
+/**
+* \brief ConcurrentDictionary - Sharded hash map with lock-free readers.
+*
+* \param Key - Type used for keys. Hash has to take it as an argument.
+* \param Value - Type used for values. Get() copies them out.
+* \param Hash - Functor which takes Key as an argument, and returns a uint64_t hash.
+* \param ShardCount - Number of independently locked shards. Power of two.
+**/
+template <class Key, class Value, class Hash, uint32_t ShardCount = 16U>
+class ConcurrentDictionary
+{
+	static_assert(ShardCount > 0U && (ShardCount & (ShardCount - 1U)) == 0U, "ShardCount has to be a power of two.");
+
+public:
+	/*** PUBLIC INTERFACE ***/
+
+	/* Constructors */
+
+	ConcurrentDictionary()
+	{
+		for (Shard& shard : myShards)
+		{
+			shard.table.store(nullptr, std::memory_order_relaxed);
+			shard.retired = nullptr;
+		}
+	}
+
+	/* Destructor */
+
+	~ConcurrentDictionary()
+	{
+		Reclaim();
+
+		for (Shard& shard : myShards)
+		{
+			__FreeTable(shard.table.load(std::memory_order_relaxed));
+		}
+	}
+
+	/* Copying and Moving */
+
+	ConcurrentDictionary(const ConcurrentDictionary&) = delete;
+	ConcurrentDictionary& operator=(const ConcurrentDictionary&) = delete;
+
+	/* Access, from any thread without locking */
+
+	/* Copies the value into aValueOut if the key is there. aValueOut may be null. */
+	inline bool Get(const Key& aKey, Value* aValueOut) const
+	{
+		const uint64_t hash = __Hash(aKey);
+		const HashTable* const table = myShards[__ShardIndex(hash)].table.load(std::memory_order_acquire);
+
+		const Slot* const slot = __Find(table, aKey, hash);
+		if (!slot)
+		{
+			return false;
+		}
+
+		if (aValueOut)
+		{
+			*aValueOut = slot->value;
+		}
+		return true;
+	}
+	inline bool Contains(const Key& aKey) const
+	{
+		return Get(aKey, nullptr);
+	}
+
+	/* Capacity */
+
+	/* Adds up the shards one after another, so it is only exact while nobody writes. */
+	inline uint64_t Size() const
+	{
+		uint64_t size = 0U;
+		for (const Shard& shard : myShards)
+		{
+			const HashTable* const table = shard.table.load(std::memory_order_acquire);
+			size += table ? table->size : 0U;
+		}
+
+		return size;
+	}
+	inline bool Empty() const
+	{
+		return Size() == 0U;
+	}
+
+	/* Modifiers, from any thread; writers to the same shard take turns */
+
+	/* Adds the pair, or replaces the value if the key is already there. Returns false if out of memory. */
+	inline bool Insert(const Key& aKey, const Value& aValue)
+	{
+		const uint64_t hash = __Hash(aKey);
+		Shard& shard = myShards[__ShardIndex(hash)];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		const HashTable* const oldTable = shard.table.load(std::memory_order_relaxed);
+		const bool isNew = !__Find(oldTable, aKey, hash);
+		const uint64_t size = (oldTable ? oldTable->size : 0U) + (isNew ? 1U : 0U);
+
+		HashTable* const newTable = __AllocTable(size);
+		if (!newTable)
+		{
+			return false;
+		}
+
+		__CopyTable(oldTable, newTable, &aKey, hash);
+		__InsertToTable(newTable, aKey, aValue, hash);
+
+		__Publish(shard, newTable);
+		return true;
+	}
+	/* Returns false if the key was not there, or if out of memory. */
+	inline bool Remove(const Key& aKey)
+	{
+		const uint64_t hash = __Hash(aKey);
+		Shard& shard = myShards[__ShardIndex(hash)];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		const HashTable* const oldTable = shard.table.load(std::memory_order_relaxed);
+		if (!__Find(oldTable, aKey, hash))
+		{
+			return false;
+		}
+
+		HashTable* newTable = nullptr;
+		if (oldTable->size > 1U)
+		{
+			newTable = __AllocTable(oldTable->size - 1U);
+			if (!newTable)
+			{
+				return false;
+			}
+			__CopyTable(oldTable, newTable, &aKey, hash);
+		}
+
+		__Publish(shard, newTable);
+		return true;
+	}
+	inline void Clear()
+	{
+		for (Shard& shard : myShards)
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			__Publish(shard, nullptr);
+		}
+	}
+
+	/*
+	* Frees every table replaced since the last call. Nothing may be inside
+	* Get() or Contains() while this runs, or have started before it and still
+	* be running; writers may carry on.
+	*/
+	inline void Reclaim()
+	{
+		for (Shard& shard : myShards)
+		{
+			HashTable* retired;
+			{
+				std::lock_guard<std::mutex> lock(shard.mutex);
+				retired = shard.retired;
+				shard.retired = nullptr;
+			}
+
+			while (retired)
+			{
+				HashTable* const next = retired->nextRetired;
+				__FreeTable(retired);
+				retired = next;
+			}
+		}
+	}
+
+private:
+	/*** DATA ***/
+
+	struct Slot
+	{
+		Key key;
+		Value value;
+	};
+
+	/* One allocation: this header, then a used flag per slot, then the slots. Never changed once published. */
+	struct HashTable
+	{
+		HashTable* nextRetired;
+		uint8_t* used;
+		Slot* slots;
+		uint64_t capacity;
+		uint64_t size;
+	};
+
+	/* Own cache line each, so writers to different shards do not slow each other's readers down. */
+	struct alignas(64) Shard
+	{
+		std::atomic<HashTable*> table;
+		std::mutex mutex;
+		/* Replaced tables waiting for Reclaim(), guarded by mutex. */
+		HashTable* retired;
+	};
+
+	Shard myShards[ShardCount];
+
+	/*** INTERNAL METHODS ***/
+
+	static inline uint64_t __Hash(const Key& aKey)
+	{
+		return Hash()(aKey);
+	}
+	/* The slot comes from the low bits, so the shard comes from mixed high ones. */
+	static inline uint64_t __ShardIndex(uint64_t aHash)
+	{
+		return ((aHash * 0x9E3779B97F4A7C15ULL) >> 32) & (ShardCount - 1U);
+	}
+
+	static inline const Slot* __Find(const HashTable* aTable, const Key& aKey, uint64_t aHash)
+	{
+		if (!aTable)
+		{
+			return nullptr;
+		}
+
+		/* At most half full, so there is always an empty slot to stop at. */
+		const uint64_t mask = aTable->capacity - 1U;
+		for (uint64_t index = aHash & mask; aTable->used[index]; index = (index + 1U) & mask)
+		{
+			if (aTable->slots[index].key == aKey)
+			{
+				return aTable->slots + index;
+			}
+		}
+
+		return nullptr;
+	}
+
+	static inline HashTable* __AllocTable(uint64_t aSize)
+	{
+		uint64_t capacity = 8U;
+		while (capacity < aSize * 2U)
+		{
+			capacity <<= 1U;
+		}
+
+		const uint64_t usedOffset = sizeof(HashTable);
+		const uint64_t slotOffset = (usedOffset + capacity + alignof(Slot) - 1U) / alignof(Slot) * alignof(Slot);
+
+		char* const buffer = (char*)malloc(slotOffset + sizeof(Slot) * capacity);
+		if (!buffer)
+		{
+			assert(false && "Malloc failed.");
+			return nullptr;
+		}
+
+		HashTable* const table = new (buffer) HashTable;
+		table->nextRetired = nullptr;
+		table->used = (uint8_t*)(buffer + usedOffset);
+		table->slots = (Slot*)(buffer + slotOffset);
+		table->capacity = capacity;
+		table->size = 0U;
+		memset(table->used, 0, capacity);
+
+		return table;
+	}
+
+	static inline void __FreeTable(HashTable* aTable)
+	{
+		if (!aTable)
+		{
+			return;
+		}
+
+		for (uint64_t index = 0U; index < aTable->capacity; ++index)
+		{
+			if (aTable->used[index])
+			{
+				aTable->slots[index].~Slot();
+			}
+		}
+
+		aTable->~HashTable();
+		free(aTable);
+	}
+
+	static inline void __InsertToTable(HashTable* aTable, const Key& aKey, const Value& aValue, uint64_t aHash)
+	{
+		const uint64_t mask = aTable->capacity - 1U;
+		uint64_t index = aHash & mask;
+		while (aTable->used[index])
+		{
+			index = (index + 1U) & mask;
+		}
+
+		new (aTable->slots + index) Slot{ aKey, aValue };
+		aTable->used[index] = 1U;
+		++aTable->size;
+	}
+
+	/* Copies every pair of aFrom except the one with key *aSkippedKey. */
+	static inline void __CopyTable(const HashTable* aFrom, HashTable* aTo, const Key* aSkippedKey, uint64_t aSkippedHash)
+	{
+		if (!aFrom)
+		{
+			return;
+		}
+
+		const Slot* const skipped = __Find(aFrom, *aSkippedKey, aSkippedHash);
+		for (uint64_t index = 0U; index < aFrom->capacity; ++index)
+		{
+			const Slot& slot = aFrom->slots[index];
+			if (aFrom->used[index] && &slot != skipped)
+			{
+				__InsertToTable(aTo, slot.key, slot.value, __Hash(slot.key));
+			}
+		}
+	}
+
+	/* Swaps aTable in and retires the old one. Called with the shard locked. */
+	static inline void __Publish(Shard& aShard, HashTable* aTable)
+	{
+		HashTable* const oldTable = aShard.table.load(std::memory_order_relaxed);
+		aShard.table.store(aTable, std::memory_order_release);
+
+		if (oldTable)
+		{
+			oldTable->nextRetired = aShard.retired;
+			aShard.retired = oldTable;
+		}
+	}
+};
+
+#endif // CONCURRENTDICTIONARY_H_
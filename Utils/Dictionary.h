@@ -14,6 +14,9 @@
 #include <string.h>
 #include <initializer_list>
 #include <new>
+#include <type_traits>
+
+#include "Allocators.h"
 
 constexpr uint64_t dictionaryDefaultCapacity = 32U;
 constexpr uint64_t capacityThreshold = 2U;
@@ -25,8 +28,17 @@ constexpr uint64_t capacityThreshold = 2U;
 * \param Value - Type used for values.
 * \param Hash - Functor which takes Key as an argument, and returns a uint64_t hash.
 * \param R - Amount of pairs to move from old table when inserting to new table.
+* \param Allocator - Where the tables come from, see Allocators.h. An arena or pool behind it has to outlive the dictionary.
+*
+* Insert() and operator[] return nullptr when a table cannot be allocated, and
+* leave the dictionary as it was. Assign() returns false in that case and
+* leaves an empty dictionary, as do the copy constructor and copy assignment,
+* whose copies then have no capacity. Arenas never take memory back, so each time
+* an arena-backed dictionary grows the old table stays allocated until the
+* arena is reset: create those at their final capacity, or reset the arena
+* together with the dictionaries in it.
 **/
-template <class Key, class Value, class Hash, uint64_t R = 2>
+template <class Key, class Value, class Hash, uint64_t R = 2, class Allocator = MallocAllocator>
 class Dictionary
 {
 	static_assert(R > 0);
@@ -50,11 +62,21 @@ public:
 	{
 		__AllocTable(0, dictionaryDefaultCapacity);
 	}
-	Dictionary(uint64_t aCapacity)
+	explicit Dictionary(const Allocator& anAllocator)
+		: myHashTables{ { 0,0,0,0,0 } }
+		, myWriteTable(0)
+		, myMovingFromTable(uint64_t(-1))
+		, myMovingFromTableMarker(0)
+		, myAllocator(anAllocator)
+	{
+		__AllocTable(0, dictionaryDefaultCapacity);
+	}
+	Dictionary(uint64_t aCapacity, const Allocator& anAllocator = Allocator())
 		: myHashTables{ { 0,0,0,0,0 } }
 		, myWriteTable(0)
 		, myMovingFromTable(uint64_t(-1))
 		, myMovingFromTableMarker(0)
+		, myAllocator(anAllocator)
 	{
 		uint64_t size = aCapacity;
 		--size;
@@ -68,11 +90,12 @@ public:
 
 		__AllocTable(0, size);
 	}
-	Dictionary(std::initializer_list<KeyValuePair> anIList)
+	Dictionary(std::initializer_list<KeyValuePair> anIList, const Allocator& anAllocator = Allocator())
 		: myHashTables{ { 0,0,0,0,0 } }
 		, myWriteTable(0)
 		, myMovingFromTable(uint64_t(-1))
 		, myMovingFromTableMarker(0)
+		, myAllocator(anAllocator)
 	{
 		uint64_t count = anIList.size();
 		uint64_t size = count;
@@ -106,35 +129,22 @@ public:
 
 	/* Copying and Moving */
 
-	Dictionary(const Dictionary<Key, Value, Hash, R>& aDict)
+	Dictionary(const Dictionary<Key, Value, Hash, R, Allocator>& aDict)
 		: myHashTables{ { 0,0,0,0,0 } }
 		, myWriteTable(0)
 		, myMovingFromTable(uint64_t(-1))
 		, myMovingFromTableMarker(0)
+		, myAllocator(aDict.myAllocator)
 	{
-		this->~Dictionary();
-
-		if (aDict.myHashTables[0].states)
-		{
-			__Copy(aDict, 0);
-		}
-		if (aDict.myHashTables[1].states)
-		{
-			__Copy(aDict, 1);
-		}
-
-		myWriteTable = aDict.myWriteTable;
-		myMovingFromTable = aDict.myMovingFromTable;
-		myMovingFromTableMarker = aDict.myMovingFromTableMarker;
+		Assign(aDict);
 	}
-	Dictionary(Dictionary<Key, Value, Hash, R>&& aDict) noexcept
+	Dictionary(Dictionary<Key, Value, Hash, R, Allocator>&& aDict) noexcept
 		: myHashTables{ { 0,0,0,0,0 } }
 		, myWriteTable(0)
 		, myMovingFromTable(uint64_t(-1))
 		, myMovingFromTableMarker(0)
+		, myAllocator(aDict.myAllocator)
 	{
-		this->~Dictionary();
-			
 		__Move((Dictionary&&)aDict, 0);
 		__Move((Dictionary&&)aDict, 1);
 
@@ -146,28 +156,24 @@ public:
 		aDict.myWriteTable = uint64_t(-1);
 		aDict.myMovingFromTableMarker = uint64_t(-1);
 	}
-	Dictionary& operator=(const Dictionary<Key, Value, Hash, R>& aDict)
+	/* Keeps this dictionary's allocator. */
+	Dictionary& operator=(const Dictionary<Key, Value, Hash, R, Allocator>& aDict)
 	{
-		this->~Dictionary();
-
-		if (aDict.myHashTables[0].states)
-		{
-			__Copy(aDict, 0);
-		}
-		if (aDict.myHashTables[1].states)
-		{
-			__Copy(aDict, 1);
-		}
-
-		myWriteTable = aDict.myWriteTable;
-		myMovingFromTable = aDict.myMovingFromTable;
-		myMovingFromTableMarker = aDict.myMovingFromTableMarker;
+		Assign(aDict);
 
 		return *this;
 	}
-	Dictionary& operator=(Dictionary<Key, Value, Hash, R>&& aDict) noexcept
+	/* Takes the tables along with the allocator they came from. */
+	Dictionary& operator=(Dictionary<Key, Value, Hash, R, Allocator>&& aDict) noexcept
 	{
-		this->~Dictionary();
+		if (this == &aDict)
+		{
+			return *this;
+		}
+
+		__FreeTable(0);
+		__FreeTable(1);
+		myAllocator = aDict.myAllocator;
 
 		__Move((Dictionary&&)aDict, 0);
 		__Move((Dictionary&&)aDict, 1);
@@ -185,29 +191,63 @@ public:
 
 	/* Modifiers */
 
+	/* Copies aDict with this dictionary's allocator. On failure nothing of aDict is kept and false is returned. */
+	inline bool Assign(const Dictionary& aDict)
+	{
+		if (this == &aDict)
+		{
+			return true;
+		}
+
+		__FreeTable(0);
+		__FreeTable(1);
+		myWriteTable = 0U;
+		myMovingFromTable = uint64_t(-1);
+		myMovingFromTableMarker = 0U;
+
+		/* Both tables have to come through, or the entries still waiting in the old one would be lost. */
+		for (uint64_t table = 0U; table < 2U; ++table)
+		{
+			if (aDict.myHashTables[table].states && !__Copy(aDict, table))
+			{
+				__FreeTable(0);
+				__FreeTable(1);
+				myWriteTable = 0U;
+
+				return false;
+			}
+		}
+
+		myWriteTable = aDict.myWriteTable;
+		myMovingFromTable = aDict.myMovingFromTable;
+		myMovingFromTableMarker = aDict.myMovingFromTableMarker;
+
+		return true;
+	}
+
 	inline Value* Insert(const Key& aKey, const Value& aValue)
 	{
 		/* Grow table */
 		if (myHashTables[myWriteTable].size >= myHashTables[myWriteTable].capacity / capacityThreshold)
 		{
-			myMovingFromTable = myWriteTable;
-			myWriteTable = !myWriteTable;
-			myMovingFromTableMarker = 0U;
+			assert(myMovingFromTable == uint64_t(-1) && "The previous table has to be moved out before growing again.");
+
+			const uint64_t oldTable = myWriteTable;
+			const uint64_t newTable = !oldTable;
 
 			/* The capacity has to be at least (R+1)/R times bigger to ensure we never run out of space in the new list before the old list is empty. */
-			const uint64_t newCapacity = myHashTables[myMovingFromTable].capacity * 2U;
+			const uint64_t oldCapacity = myHashTables[oldTable].capacity;
+			const uint64_t newCapacity = oldCapacity ? oldCapacity * 2U : dictionaryDefaultCapacity;
 
-			uint64_t result;
-			if (myHashTables[myWriteTable].states)
-			{
-				result = __ReallocTable(myWriteTable, newCapacity);
-			}
-			else
+			/* Only switch tables once the new one exists, so a failed allocation changes nothing. */
+			if (__ReallocTable(newTable, newCapacity) == uint64_t(-1))
 			{
-				result = __AllocTable(myWriteTable, newCapacity);
+				return nullptr;
 			}
 
-			if (result == uint64_t(-1)) return nullptr;
+			myWriteTable = newTable;
+			myMovingFromTable = oldCapacity ? oldTable : uint64_t(-1);
+			myMovingFromTableMarker = 0U;
 		}
 
 		/* Insert to write table */
@@ -398,6 +438,8 @@ private:
 	/* Basically a for-loop iterator for where we are in the moving of the old table. */
 	uint64_t myMovingFromTableMarker;
 
+	Allocator myAllocator;
+
 	/*** INTERNAL METHODS ***/
 
 	enum SlotState_ : uint64_t
@@ -405,67 +447,86 @@ private:
 		SlotState_Empty = 0b00, SlotState_Used = 0b01, SlotState_Removed = 0b10
 	};
 
+	/* Tables are one allocation: slot states, then keys, then values, each aligned for its type. */
+	static constexpr uint64_t ourTableAlignment =
+		alignof(Key) > alignof(Value) ? (alignof(Key) > alignof(uint64_t) ? alignof(Key) : alignof(uint64_t))
+		: (alignof(Value) > alignof(uint64_t) ? alignof(Value) : alignof(uint64_t));
+
+	static inline uint64_t __AlignUp(uint64_t anOffset, uint64_t anAlignment)
+	{
+		return (anOffset + anAlignment - 1U) / anAlignment * anAlignment;
+	}
+	static inline uint64_t __GetKeyOffset(uint64_t aCapacity)
+	{
+		return __AlignUp(sizeof(uint64_t) * (aCapacity / 32 + 1), alignof(Key));
+	}
+	static inline uint64_t __GetValueOffset(uint64_t aCapacity)
+	{
+		return __AlignUp(__GetKeyOffset(aCapacity) + sizeof(Key) * aCapacity, alignof(Value));
+	}
+	static inline uint64_t __GetTableSize(uint64_t aCapacity)
+	{
+		return __GetValueOffset(aCapacity) + sizeof(Value) * aCapacity;
+	}
+
 	inline uint64_t __AllocTable(uint64_t anIndex, uint64_t aCapacity)
 	{
-		const uint64_t slotStateSize = sizeof(uint64_t) * (aCapacity / 32 + 1);
-		const uint64_t keySize = sizeof(Key) * aCapacity;
-		const uint64_t valueSize = sizeof(Value) * aCapacity;
+		const uint64_t tableSize = __GetTableSize(aCapacity);
 
-		char* buffer = (char*)malloc(slotStateSize + keySize + valueSize);
+		/* Callers check for this; an arena running out is expected, see the class comment. */
+		char* buffer = (char*)myAllocator.Allocate(tableSize, ourTableAlignment);
 		if (!buffer)
 		{
-			assert(false && "Malloc failed.");
 			return uint64_t(-1);
 		}
 
 		myHashTables[anIndex].states = (uint64_t*)buffer;
-		myHashTables[anIndex].keys = (Key*)(buffer + slotStateSize);
-		myHashTables[anIndex].values = (Value*)(buffer + slotStateSize + keySize);
+		myHashTables[anIndex].keys = (Key*)(buffer + __GetKeyOffset(aCapacity));
+		myHashTables[anIndex].values = (Value*)(buffer + __GetValueOffset(aCapacity));
 		myHashTables[anIndex].capacity = aCapacity;
 		myHashTables[anIndex].size = 0U;
 
-		memset(myHashTables[anIndex].states, 0, slotStateSize);
+		memset(myHashTables[anIndex].states, 0, sizeof(uint64_t) * (aCapacity / 32 + 1));
 
 		myWriteTable = anIndex;
 
-		return slotStateSize + keySize + valueSize;
+		return tableSize;
 	}
 
+	/* The table being replaced has been moved out already, so nothing in it needs keeping. */
 	inline uint64_t __ReallocTable(uint64_t anIndex, uint64_t aCapacity)
 	{
-		const uint64_t slotStateSize = sizeof(uint64_t) * (aCapacity / 32 + 1);
-		const uint64_t keySize = sizeof(Key) * aCapacity;
-		const uint64_t valueSize = sizeof(Value) * aCapacity;
-
-		char* buffer = (char*)realloc(myHashTables[anIndex].states, slotStateSize + keySize + valueSize);
-		if (!buffer)
-		{
-			assert(false && "Realloc failed.");
-			return uint64_t(-1);
-		}
-
-		myHashTables[anIndex].states = (uint64_t*)buffer;
-		myHashTables[anIndex].keys = (Key*)(buffer + slotStateSize);
-		myHashTables[anIndex].values = (Value*)(buffer + slotStateSize + keySize);
-		myHashTables[anIndex].capacity = aCapacity;
-		myHashTables[anIndex].size = 0U;
-
-		memset(myHashTables[anIndex].states, 0, slotStateSize);
-
-		myWriteTable = anIndex;
-
-		return slotStateSize + keySize + valueSize;
+		__FreeTable(anIndex);
+		return __AllocTable(anIndex, aCapacity);
 	}
 
 	inline void __FreeTable(uint64_t anIndex)
 	{
 		if (myHashTables[anIndex].states)
 		{
-			free(myHashTables[anIndex].states);
+			__DestroySlots(anIndex);
+			myAllocator.Free(myHashTables[anIndex].states, __GetTableSize(myHashTables[anIndex].capacity));
 			myHashTables[anIndex] = { 0,0,0,0,0 };
 		}
 	}
 
+	/* Keys and values are constructed the first time their slot is used, and stay so through removal, until the table is cleared or freed. */
+	inline void __DestroySlots(uint64_t anIndex)
+	{
+		if constexpr (!std::is_trivially_destructible<Key>::value || !std::is_trivially_destructible<Value>::value)
+		{
+			HashTable& table = myHashTables[anIndex];
+			for (uint64_t hashCode = 0U; hashCode < table.capacity; ++hashCode)
+			{
+				if (__GetStateAtHashCode(hashCode, anIndex) != SlotState_Empty)
+				{
+					table.keys[hashCode].~Key();
+					table.values[hashCode].~Value();
+				}
+			}
+		}
+	}
+
 	inline uint64_t __GetHashCode(const Key& aKey, uint64_t aCapacity) const
 	{
 		static Hash h;
@@ -489,11 +550,34 @@ private:
 		return returnValue;
 	}
 
-	inline void __Copy(const Dictionary& aDict, uint64_t anIndex)
+	inline bool __Copy(const Dictionary& aDict, uint64_t anIndex)
 	{
-		const uint64_t size = __AllocTable(anIndex, aDict.myHashTables[anIndex].capacity);
-		memcpy(myHashTables[anIndex].states, aDict.myHashTables[anIndex].states, size);
-		myHashTables[anIndex].size = aDict.myHashTables[anIndex].size;
+		const HashTable& source = aDict.myHashTables[anIndex];
+		const uint64_t size = __AllocTable(anIndex, source.capacity);
+		if (size == uint64_t(-1))
+		{
+			return false;
+		}
+
+		if constexpr (std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value)
+		{
+			memcpy(myHashTables[anIndex].states, source.states, size);
+		}
+		else
+		{
+			memcpy(myHashTables[anIndex].states, source.states, sizeof(uint64_t) * (source.capacity / 32 + 1));
+			for (uint64_t hashCode = 0U; hashCode < source.capacity; ++hashCode)
+			{
+				if (__GetStateAtHashCode(hashCode, anIndex) != SlotState_Empty)
+				{
+					new (myHashTables[anIndex].keys + hashCode) Key(source.keys[hashCode]);
+					new (myHashTables[anIndex].values + hashCode) Value(source.values[hashCode]);
+				}
+			}
+		}
+		myHashTables[anIndex].size = source.size;
+
+		return true;
 	}
 	inline void __Move(Dictionary&& aDict, uint64_t anIndex)
 	{
@@ -574,6 +658,8 @@ private:
 	{
 		if (myHashTables[anIndex].states)
 		{
+			__DestroySlots(anIndex);
+
 			const uint64_t slotStateSize = sizeof(uint64_t) * (myHashTables[anIndex].capacity / 32 + 1);
 			memset(myHashTables[anIndex].states, 0, slotStateSize);
 			myHashTables[anIndex].size = 0U;
@@ -0,0 +1,213 @@
+/*
+* JobSystem
+*
+* Small fixed-size thread pool for data-parallel loops over dense arrays.
+*
+* Requirements: C++17
+*/
+
+#if !defined(JOBSYSTEM_H_)
+#define JOBSYSTEM_H_
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Profiler.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define JOBSYSTEM_NO_THREADS
+#endif
+
+class JobSystem
+{
+public:
+	static constexpr uint32_t ourMaxWorkers = 31U;
+
+	/* Constructors & Destructor */
+	JobSystem()
+		: myWorkerCount(0U)
+		, myJob(nullptr)
+		, myGeneration(0U)
+		, myStop(false)
+	{
+	}
+	~JobSystem()
+	{
+		Terminate();
+	}
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	/* Interface */
+
+	/* aWorkerCount of uint32_t(-1) uses one worker per hardware thread, minus the caller. */
+	void Init(uint32_t aWorkerCount = uint32_t(-1))
+	{
+		Terminate();
+
+#if !defined(JOBSYSTEM_NO_THREADS)
+		if (aWorkerCount == uint32_t(-1))
+		{
+			const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+			aWorkerCount = hardwareThreads > 1U ? hardwareThreads - 1U : 0U;
+		}
+		aWorkerCount = aWorkerCount < ourMaxWorkers ? aWorkerCount : ourMaxWorkers;
+
+		myStop = false;
+		for (; myWorkerCount < aWorkerCount; ++myWorkerCount)
+		{
+			myWorkers[myWorkerCount] = std::thread(&JobSystem::WorkerLoop, this);
+		}
+#else
+		(void)aWorkerCount;
+#endif
+	}
+
+	void Terminate()
+	{
+		{
+			std::lock_guard<std::mutex> lock(myMutex);
+			myStop = true;
+		}
+		myWorkCondition.notify_all();
+
+		for (uint32_t i = 0U; i < myWorkerCount; ++i)
+		{
+			myWorkers[i].join();
+		}
+		myWorkerCount = 0U;
+	}
+
+	uint32_t GetWorkerCount() const
+	{
+		return myWorkerCount;
+	}
+
+	/*
+	* Calls aFunction(aBegin, anEnd) for batches covering [0, aCount), on the workers
+	* and the calling thread, and returns once every batch is done. Batches are at
+	* least aMinBatchSize long. Only one thread may issue ParallelFor at a time.
+	*/
+	template <class Function>
+	void ParallelFor(uint32_t aCount, uint32_t aMinBatchSize, const Function& aFunction)
+	{
+		if (aCount == 0U)
+		{
+			return;
+		}
+
+		const uint32_t threadCount = myWorkerCount + 1U;
+		uint32_t batchSize = (aCount + threadCount * 4U - 1U) / (threadCount * 4U);
+		batchSize = batchSize > aMinBatchSize ? batchSize : aMinBatchSize;
+		batchSize = batchSize > 0U ? batchSize : 1U;
+
+		if (myWorkerCount == 0U || batchSize >= aCount)
+		{
+			aFunction(0U, aCount);
+			return;
+		}
+
+		Job job;
+		job.myInvoke = [](const void* aFunctionPtr, uint32_t aBegin, uint32_t anEnd)
+		{
+			(*(const Function*)aFunctionPtr)(aBegin, anEnd);
+		};
+		job.myFunction = &aFunction;
+		job.myCount = aCount;
+		job.myBatchSize = batchSize;
+		job.myNextIndex = 0U;
+		job.myActiveWorkers = 0U;
+
+		{
+			std::lock_guard<std::mutex> lock(myMutex);
+			myJob = &job;
+			++myGeneration;
+		}
+		myWorkCondition.notify_all();
+
+		RunBatches(job);
+
+		std::unique_lock<std::mutex> lock(myMutex);
+		myJob = nullptr;
+		myDoneCondition.wait(lock, [&job] { return job.myActiveWorkers == 0U; });
+	}
+
+private:
+	struct Job
+	{
+		void (*myInvoke)(const void*, uint32_t, uint32_t);
+		const void* myFunction;
+		uint32_t myCount;
+		uint32_t myBatchSize;
+		std::atomic<uint32_t> myNextIndex;
+		/* Workers currently inside RunBatches for this job, guarded by myMutex. */
+		uint32_t myActiveWorkers;
+	};
+
+	static void RunBatches(Job& aJob)
+	{
+		PROFILE_ZONE("JobSystem::RunBatches");
+
+		while (true)
+		{
+			const uint32_t begin = aJob.myNextIndex.fetch_add(aJob.myBatchSize);
+			if (begin >= aJob.myCount)
+			{
+				return;
+			}
+
+			const uint32_t end = begin + aJob.myBatchSize < aJob.myCount ? begin + aJob.myBatchSize : aJob.myCount;
+			aJob.myInvoke(aJob.myFunction, begin, end);
+		}
+	}
+
+	void WorkerLoop()
+	{
+		uint64_t seenGeneration = 0U;
+
+		while (true)
+		{
+			Job* job;
+			{
+				std::unique_lock<std::mutex> lock(myMutex);
+				myWorkCondition.wait(lock, [&] { return myStop || (myJob && myGeneration != seenGeneration); });
+
+				if (myStop)
+				{
+					return;
+				}
+
+				seenGeneration = myGeneration;
+				job = myJob;
+				++job->myActiveWorkers;
+			}
+
+			RunBatches(*job);
+
+			{
+				std::lock_guard<std::mutex> lock(myMutex);
+				--job->myActiveWorkers;
+			}
+			myDoneCondition.notify_all();
+		}
+	}
+
+	std::thread myWorkers[ourMaxWorkers];
+	uint32_t myWorkerCount;
+
+	std::mutex myMutex;
+	std::condition_variable myWorkCondition;
+	std::condition_variable myDoneCondition;
+	Job* myJob;
+	uint64_t myGeneration;
+	bool myStop;
+};
+
+#endif // JOBSYSTEM_H_
\ No newline at end of file
@@ -0,0 +1,138 @@
+/*
+* MappedFile
+*
+* Read-only view of a whole file. Memory-mapped on POSIX platforms,
+* read into a heap buffer everywhere else.
+*
+* Requirements: C++17
+*/
+
+#if !defined(MAPPEDFILE_H_)
+#define MAPPEDFILE_H_
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPEDFILE_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class MappedFile
+{
+public:
+	/* Constructors & Destructor */
+	MappedFile()
+		: myData(nullptr)
+		, mySize(0U)
+		, myIsMapped(false)
+	{
+	}
+	~MappedFile()
+	{
+		Close();
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/* Interface */
+	bool Open(const char* const aPath)
+	{
+		Close();
+
+#if defined(MAPPEDFILE_USE_MMAP)
+		const int fd = open(aPath, O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		struct stat info;
+		if (fstat(fd, &info) == 0 && info.st_size > 0)
+		{
+			void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED)
+			{
+				madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+				myData = (const char*)data;
+				mySize = (size_t)info.st_size;
+				myIsMapped = true;
+			}
+		}
+		close(fd);
+
+		if (myIsMapped)
+		{
+			return true;
+		}
+#endif
+
+		FILE* file = fopen(aPath, "rb");
+		if (!file)
+		{
+			return false;
+		}
+
+		fseek(file, 0, SEEK_END);
+		const long fileSize = ftell(file);
+		fseek(file, 0, SEEK_SET);
+
+		if (fileSize > 0)
+		{
+			char* buffer = (char*)malloc((size_t)fileSize);
+			mySize = fread(buffer, 1, (size_t)fileSize, file);
+			myData = buffer;
+		}
+		fclose(file);
+
+		return myData != nullptr;
+	}
+
+	void Close()
+	{
+		if (!myData)
+		{
+			return;
+		}
+
+#if defined(MAPPEDFILE_USE_MMAP)
+		if (myIsMapped)
+		{
+			munmap((void*)myData, mySize);
+		}
+		else
+#endif
+		{
+			free((void*)myData);
+		}
+
+		myData = nullptr;
+		mySize = 0U;
+		myIsMapped = false;
+	}
+
+	/* Getters */
+	const char* Data() const
+	{
+		return myData;
+	}
+
+	size_t Size() const
+	{
+		return mySize;
+	}
+
+private:
+	const char* myData;
+	size_t mySize;
+	bool myIsMapped;
+};
+
+#endif // MAPPEDFILE_H_
\ No newline at end of file
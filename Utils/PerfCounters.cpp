@@ -0,0 +1,221 @@
+#include "PerfCounters.h"
+
+#if defined(PERF_COUNTERS_ENABLED)
+
+#include <string.h>
+#include <unistd.h>
+
+#include <mutex>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+namespace PerfCounters
+{
+	namespace
+	{
+		struct CounterConfig
+		{
+			uint32_t myType;
+			uint64_t myConfig;
+			const char* myName;
+		};
+
+		const CounterConfig COUNTER_CONFIGS[Counter_Count] = {
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles" },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions" },
+			{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), "L1D misses" },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "LLC misses" },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "branch misses" },
+		};
+
+		struct Globals
+		{
+			int fds[Counter_Count];
+			bool isInitialized;
+
+			/* Scopes may close on several threads at once, e.g. when worlds tick in parallel. */
+			std::mutex systemMutex;
+			SystemCounters systems[MAX_SYSTEMS];
+			uint32_t systemCount;
+		} globals;
+
+		int OpenCounter(const CounterConfig& aConfig)
+		{
+			perf_event_attr attributes;
+			memset(&attributes, 0, sizeof(attributes));
+			attributes.size = sizeof(attributes);
+			attributes.type = aConfig.myType;
+			attributes.config = aConfig.myConfig;
+			attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			/* User space only, which is all perf_event_paranoid = 2 allows anyway. */
+			attributes.exclude_kernel = 1;
+			attributes.exclude_hv = 1;
+			/* Threads started later count into the same totals. */
+			attributes.inherit = 1;
+
+			return (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0UL);
+		}
+
+		SystemCounters* FindSystem(const char* aName)
+		{
+			for (uint32_t i = 0U; i < globals.systemCount; ++i)
+			{
+				if (globals.systems[i].myName == aName || strcmp(globals.systems[i].myName, aName) == 0)
+				{
+					return &globals.systems[i];
+				}
+			}
+
+			if (globals.systemCount == MAX_SYSTEMS)
+			{
+				return nullptr;
+			}
+
+			SystemCounters* system = &globals.systems[globals.systemCount++];
+			memset(system, 0, sizeof(SystemCounters));
+			system->myName = aName;
+			return system;
+		}
+	}
+}
+
+bool PerfCounters::Init()
+{
+	Terminate();
+
+	bool isAnyOpen = false;
+	for (uint32_t counter = 0U; counter < Counter_Count; ++counter)
+	{
+		globals.fds[counter] = OpenCounter(COUNTER_CONFIGS[counter]);
+		isAnyOpen = isAnyOpen || globals.fds[counter] >= 0;
+	}
+
+	globals.isInitialized = isAnyOpen;
+	if (!isAnyOpen)
+	{
+		fprintf(stderr, "PERFCOUNTERS: Hardware counters are not available, check /proc/sys/kernel/perf_event_paranoid.\n");
+	}
+
+	return isAnyOpen;
+}
+
+void PerfCounters::Terminate()
+{
+	for (uint32_t counter = 0U; globals.isInitialized && counter < Counter_Count; ++counter)
+	{
+		if (globals.fds[counter] >= 0)
+		{
+			close(globals.fds[counter]);
+		}
+	}
+
+	globals.isInitialized = false;
+	Reset();
+}
+
+bool PerfCounters::IsAvailable(Counter aCounter)
+{
+	return globals.isInitialized && globals.fds[aCounter] >= 0;
+}
+
+bool PerfCounters::Read(Sample* aSampleOut)
+{
+	if (!globals.isInitialized)
+	{
+		return false;
+	}
+
+	for (uint32_t counter = 0U; counter < Counter_Count; ++counter)
+	{
+		aSampleOut->myValues[counter] = 0U;
+
+		uint64_t values[3];
+		if (globals.fds[counter] < 0 || read(globals.fds[counter], values, sizeof(values)) != (ssize_t)sizeof(values))
+		{
+			continue;
+		}
+
+		/* values: count, time enabled, time running. Scale up for the time another counter had the PMU. */
+		const uint64_t count = values[0];
+		const uint64_t enabled = values[1];
+		const uint64_t running = values[2];
+		aSampleOut->myValues[counter] = running > 0U && running < enabled
+			? (uint64_t)((double)count * (double)enabled / (double)running)
+			: count;
+	}
+
+	return true;
+}
+
+void PerfCounters::Accumulate(const char* aName, uint64_t anEntityCount, const Sample& aBegin, const Sample& anEnd)
+{
+	std::lock_guard<std::mutex> lock(globals.systemMutex);
+	SystemCounters* system = FindSystem(aName);
+	if (!system)
+	{
+		return;
+	}
+
+	++system->myCallCount;
+	system->myEntityCount += anEntityCount;
+	for (uint32_t counter = 0U; counter < Counter_Count; ++counter)
+	{
+		/* Scaled values can step back slightly between reads. */
+		system->myTotals[counter] += anEnd.myValues[counter] > aBegin.myValues[counter] ? anEnd.myValues[counter] - aBegin.myValues[counter] : 0U;
+	}
+}
+
+uint32_t PerfCounters::GetSystemCounters(SystemCounters* someCountersOut, uint32_t aMaxCount)
+{
+	const uint32_t count = globals.systemCount < aMaxCount ? globals.systemCount : aMaxCount;
+	memcpy(someCountersOut, globals.systems, sizeof(SystemCounters) * count);
+
+	return count;
+}
+
+void PerfCounters::Reset()
+{
+	globals.systemCount = 0U;
+}
+
+void PerfCounters::WriteReport(FILE* aFile)
+{
+	if (!globals.isInitialized)
+	{
+		return;
+	}
+
+	fprintf(aFile, "%-28s %8s %14s %6s %14s %14s %14s %10s %10s\n",
+		"system", "calls", "cycles/call", "IPC", "L1D miss/call", "LLC miss/call", "br miss/call", "L1D/ent", "LLC/ent");
+
+	for (uint32_t i = 0U; i < globals.systemCount; ++i)
+	{
+		const SystemCounters& system = globals.systems[i];
+		const double calls = system.myCallCount > 0U ? (double)system.myCallCount : 1.0;
+		const double entities = system.myEntityCount > 0U ? (double)system.myEntityCount : 1.0;
+		const uint64_t* totals = system.myTotals;
+
+		fprintf(aFile, "%-28s %8llu %14.0f %6.2f %14.0f %14.0f %14.0f %10.3f %10.3f\n",
+			system.myName,
+			(unsigned long long)system.myCallCount,
+			totals[Counter_Cycles] / calls,
+			totals[Counter_Cycles] > 0U ? (double)totals[Counter_Instructions] / (double)totals[Counter_Cycles] : 0.0,
+			totals[Counter_L1DMisses] / calls,
+			totals[Counter_LLCMisses] / calls,
+			totals[Counter_BranchMisses] / calls,
+			totals[Counter_L1DMisses] / entities,
+			totals[Counter_LLCMisses] / entities);
+	}
+
+	for (uint32_t counter = 0U; counter < Counter_Count; ++counter)
+	{
+		if (globals.fds[counter] < 0)
+		{
+			fprintf(aFile, "(%s not available, reported as 0)\n", COUNTER_CONFIGS[counter].myName);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,127 @@
+/*
+* PerfCounters
+*
+* Hardware performance counters (cycles, instructions, L1D and last-level
+* cache misses, branch misses) around whole systems, through Linux
+* perf_event_open. PERF_COUNTERS_SCOPE("Name", entityCount) adds what the
+* enclosed code cost to that system's totals, so they can be reported per
+* call and per entity.
+*
+* The counters follow the thread that calls Init() and are inherited by
+* threads it creates afterwards, so work done on job system workers is
+* included as long as the pool starts after Init(). Threads that already run
+* at Init() are never counted; start background threads whose work should
+* stay out of the totals, such as asset loaders, before it. Scopes may close
+* on any thread, but since the counters cover all of those threads, scopes
+* that overlap in time, such as those of worlds ticking in parallel, each
+* count all work done meanwhile.
+*
+* Elsewhere, or when the kernel refuses (perf_event_paranoid, containers,
+* VMs without a PMU), Init() returns false and every scope does nothing.
+* Counters the CPU lacks are reported as unavailable while the rest work.
+*
+* Requirements: C++17
+*/
+
+#if !defined(PERFCOUNTERS_H_)
+#define PERFCOUNTERS_H_
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#if defined(__linux__) && !defined(PERF_COUNTERS_DISABLED)
+#define PERF_COUNTERS_ENABLED
+#endif
+
+namespace PerfCounters
+{
+	enum Counter : uint32_t
+	{
+		Counter_Cycles,
+		Counter_Instructions,
+		Counter_L1DMisses,
+		Counter_LLCMisses,
+		Counter_BranchMisses,
+		Counter_Count,
+	};
+
+	constexpr uint32_t MAX_SYSTEMS = 32U;
+
+	struct Sample
+	{
+		uint64_t myValues[Counter_Count];
+	};
+
+	struct SystemCounters
+	{
+		const char* myName;
+		uint64_t myCallCount;
+		/* Sum of the entity counts passed to every call. */
+		uint64_t myEntityCount;
+		uint64_t myTotals[Counter_Count];
+	};
+
+#if defined(PERF_COUNTERS_ENABLED)
+	/* Opens whatever counters the kernel allows. Returns false if none could be opened. */
+	bool Init();
+	void Terminate();
+	bool IsAvailable(Counter aCounter);
+
+	/* Current values summed over every counted thread, scaled up if the kernel had to multiplex the counters. */
+	bool Read(Sample* aSampleOut);
+	void Accumulate(const char* aName, uint64_t anEntityCount, const Sample& aBegin, const Sample& anEnd);
+
+	uint32_t GetSystemCounters(SystemCounters* someCountersOut, uint32_t aMaxCount);
+	void Reset();
+	/* One line per system: per-call cycles, IPC, and misses per call and per entity. */
+	void WriteReport(FILE* aFile);
+
+	class Scope
+	{
+	public:
+		Scope(const char* aName, uint64_t anEntityCount)
+			: myName(aName)
+			, myEntityCount(anEntityCount)
+			, myIsActive(Read(&myBegin))
+		{
+		}
+		~Scope()
+		{
+			Sample end;
+			if (myIsActive && Read(&end))
+			{
+				Accumulate(myName, myEntityCount, myBegin, end);
+			}
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		const char* myName;
+		uint64_t myEntityCount;
+		Sample myBegin;
+		bool myIsActive;
+	};
+#else
+	inline bool Init() { return false; }
+	inline void Terminate() {}
+	inline bool IsAvailable(Counter) { return false; }
+	inline bool Read(Sample*) { return false; }
+	inline uint32_t GetSystemCounters(SystemCounters*, uint32_t) { return 0U; }
+	inline void Reset() {}
+	inline void WriteReport(FILE*) {}
+#endif
+}
+
+#if defined(PERF_COUNTERS_ENABLED)
+#define PERF_COUNTERS_CONCAT_INNER(a, b) a##b
+#define PERF_COUNTERS_CONCAT(a, b) PERF_COUNTERS_CONCAT_INNER(a, b)
+#define PERF_COUNTERS_SCOPE(aName, anEntityCount) PerfCounters::Scope PERF_COUNTERS_CONCAT(perfCounterScope, __LINE__)(aName, anEntityCount)
+#else
+#define PERF_COUNTERS_SCOPE(aName, anEntityCount) (void)(anEntityCount)
+#endif
+
+#endif // PERFCOUNTERS_H_
@@ -0,0 +1,420 @@
+#include "Profiler.h"
+
+#if defined(PROFILER_ENABLED)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <mutex>
+
+namespace Profiler
+{
+	namespace
+	{
+		/* Capture memory is bounded; a capture that would exceed this drops the rest. */
+		constexpr uint32_t MAX_CAPTURE_EVENTS = 1U << 20;
+		/* Events EndFrame() copies off a ring before checking whether the owner lapped them. */
+		constexpr uint32_t DRAIN_BATCH = 256U;
+
+		struct ZoneHistory
+		{
+			const char* myName;
+			uint64_t myFrameTicks;
+			uint32_t myFrameCalls;
+
+			float myHistoryMs[HISTORY_FRAMES];
+			uint32_t myHistoryCount;
+			uint32_t myHistoryNext;
+
+			double myLastMs;
+			uint32_t myLastCalls;
+		};
+
+		struct CaptureEvent
+		{
+			uint32_t myZone;
+			uint64_t myBegin;
+			uint64_t myEnd;
+			uint32_t myThreadIndex;
+		};
+
+		struct Globals
+		{
+			/* Only taken when a thread records its first zone and once per PROFILE_ZONE site. */
+			std::mutex registryMutex;
+			ThreadBuffer* threads[MAX_THREADS];
+			std::atomic<uint32_t> threadCount;
+
+			/* Zones below zoneCount are initialized before the count is published. */
+			ZoneHistory zones[MAX_ZONES];
+			std::atomic<uint32_t> zoneCount;
+			uint64_t droppedCount;
+
+			/* Tick rate, measured against steady_clock between the first zone and the latest frame end. */
+			uint64_t originTicks;
+			int64_t originNanoseconds;
+			double nanosecondsPerTick;
+
+			CaptureEvent* capture;
+			uint32_t captureCount;
+			uint32_t captureCapacity;
+			uint32_t captureFramesLeft;
+			uint64_t captureOriginTicks;
+		} globals;
+
+		/* Hands the buffer back when its thread exits, so pools that restart their threads reuse buffers. */
+		struct ThreadBufferRelease
+		{
+			ThreadBuffer* myBuffer = nullptr;
+			bool myHasFailed = false;
+
+			~ThreadBufferRelease()
+			{
+				if (myBuffer)
+				{
+					myBuffer->myIsOwned.store(false, std::memory_order_release);
+				}
+			}
+		};
+
+		thread_local ThreadBufferRelease tThreadBufferRelease;
+
+		int64_t SteadyNanoseconds()
+		{
+			return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		void Calibrate()
+		{
+#if defined(PROFILER_RDTSC)
+			const uint64_t ticks = Now();
+			const int64_t nanoseconds = SteadyNanoseconds();
+
+			/* Wait for a millisecond of history so the ratio is not dominated by the read skew. */
+			if (nanoseconds - globals.originNanoseconds > 1000000 && ticks > globals.originTicks)
+			{
+				globals.nanosecondsPerTick = (double)(nanoseconds - globals.originNanoseconds) / (double)(ticks - globals.originTicks);
+			}
+#else
+			globals.nanosecondsPerTick = 1.0;
+#endif
+		}
+
+		double TicksToMilliseconds(uint64_t aTicks)
+		{
+			return (double)aTicks * globals.nanosecondsPerTick * 1e-6;
+		}
+
+		void Consume(uint64_t aBegin, uint64_t aZoneAndDuration, uint32_t aThreadIndex)
+		{
+			const uint32_t zoneIndex = (uint32_t)(aZoneAndDuration >> DURATION_BITS);
+			const uint64_t duration = aZoneAndDuration & DURATION_MASK;
+			if (zoneIndex >= MAX_ZONES)
+			{
+				++globals.droppedCount;
+				return;
+			}
+
+			ZoneHistory& zone = globals.zones[zoneIndex];
+			zone.myFrameTicks += duration;
+			++zone.myFrameCalls;
+
+			/* Zones still queued from before StartCapture() stay out of it. */
+			if (globals.captureFramesLeft == 0U || aBegin < globals.captureOriginTicks)
+			{
+				return;
+			}
+
+			if (globals.captureCount == globals.captureCapacity)
+			{
+				const uint32_t newCapacity = globals.captureCapacity ? globals.captureCapacity * 2U : 4096U;
+				CaptureEvent* grown = newCapacity <= MAX_CAPTURE_EVENTS
+					? (CaptureEvent*)realloc(globals.capture, sizeof(CaptureEvent) * newCapacity)
+					: nullptr;
+				if (!grown)
+				{
+					++globals.droppedCount;
+					return;
+				}
+
+				globals.capture = grown;
+				globals.captureCapacity = newCapacity;
+			}
+
+			globals.capture[globals.captureCount++] = { zoneIndex, aBegin, aBegin + duration, aThreadIndex };
+		}
+
+		void WriteEscaped(FILE* aFile, const char* aString)
+		{
+			for (; *aString; ++aString)
+			{
+				if (*aString == '"' || *aString == '\\')
+				{
+					fputc('\\', aFile);
+				}
+				fputc(*aString, aFile);
+			}
+		}
+	}
+}
+
+Profiler::ThreadBuffer* Profiler::AcquireThreadBuffer()
+{
+	ThreadBufferRelease& release = tThreadBufferRelease;
+	if (release.myHasFailed)
+	{
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(globals.registryMutex);
+
+	const uint32_t threadCount = globals.threadCount.load(std::memory_order_relaxed);
+	if (threadCount == 0U)
+	{
+		globals.originTicks = Now();
+		globals.originNanoseconds = SteadyNanoseconds();
+		globals.nanosecondsPerTick = 1.0;
+	}
+
+	ThreadBuffer* buffer = nullptr;
+	for (uint32_t i = 0U; i < threadCount && !buffer; ++i)
+	{
+		bool expected = false;
+		if (globals.threads[i]->myIsOwned.compare_exchange_strong(expected, true, std::memory_order_acquire))
+		{
+			buffer = globals.threads[i];
+		}
+	}
+
+	if (!buffer && threadCount < MAX_THREADS)
+	{
+		buffer = new ThreadBuffer;
+		buffer->myWriteIndex.store(0U, std::memory_order_relaxed);
+		buffer->myReadIndex = 0U;
+		buffer->myIsOwned.store(true, std::memory_order_relaxed);
+		buffer->myThreadIndex = threadCount;
+
+		globals.threads[threadCount] = buffer;
+		globals.threadCount.store(threadCount + 1U, std::memory_order_release);
+	}
+
+	release.myBuffer = buffer;
+	release.myHasFailed = !buffer;
+	ourThreadBuffer = buffer;
+
+	return buffer;
+}
+
+uint32_t Profiler::RegisterZone(const char* aName)
+{
+	std::lock_guard<std::mutex> lock(globals.registryMutex);
+
+	const uint32_t zoneCount = globals.zoneCount.load(std::memory_order_relaxed);
+	for (uint32_t i = 0U; i < zoneCount; ++i)
+	{
+		/* Identical literals may still live at different addresses in different translation units. */
+		if (globals.zones[i].myName == aName || strcmp(globals.zones[i].myName, aName) == 0)
+		{
+			return i;
+		}
+	}
+
+	if (zoneCount == MAX_ZONES)
+	{
+		return INVALID_ZONE;
+	}
+
+	ZoneHistory& zone = globals.zones[zoneCount];
+	memset(&zone, 0, sizeof(ZoneHistory));
+	zone.myName = aName;
+	globals.zoneCount.store(zoneCount + 1U, std::memory_order_release);
+
+	return zoneCount;
+}
+
+void Profiler::EndFrame()
+{
+	const uint32_t threadCount = globals.threadCount.load(std::memory_order_acquire);
+	/* The clock origin is set by whichever thread records first, before it publishes threadCount. */
+	if (threadCount > 0U)
+	{
+		Calibrate();
+	}
+
+	for (uint32_t t = 0U; t < threadCount; ++t)
+	{
+		ThreadBuffer& buffer = *globals.threads[t];
+		const uint64_t writeIndex = buffer.myWriteIndex.load(std::memory_order_acquire);
+
+		uint64_t readIndex = buffer.myReadIndex;
+		if (writeIndex - readIndex > RING_CAPACITY)
+		{
+			globals.droppedCount += writeIndex - readIndex - RING_CAPACITY;
+			readIndex = writeIndex - RING_CAPACITY;
+		}
+
+		/*
+		* The owner keeps writing while this runs and may lap slots that were
+		* read here. Read a batch, then reload the write index: any slot the
+		* owner has since reached again holds a torn mix and is dropped.
+		*/
+		while (readIndex < writeIndex)
+		{
+			uint64_t begins[DRAIN_BATCH];
+			uint64_t zoneAndDurations[DRAIN_BATCH];
+			const uint32_t count = (uint32_t)std::min<uint64_t>(writeIndex - readIndex, DRAIN_BATCH);
+
+			for (uint32_t i = 0U; i < count; ++i)
+			{
+				const Event& event = buffer.myEvents[(readIndex + i) & (RING_CAPACITY - 1U)];
+				begins[i] = event.myBegin.load(std::memory_order_relaxed);
+				zoneAndDurations[i] = event.myZoneAndDuration.load(std::memory_order_relaxed);
+			}
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			const uint64_t lappedBelow = buffer.myWriteIndex.load(std::memory_order_relaxed) - RING_CAPACITY;
+
+			for (uint32_t i = 0U; i < count; ++i)
+			{
+				if ((int64_t)(readIndex + i - lappedBelow) > 0)
+				{
+					Consume(begins[i], zoneAndDurations[i], buffer.myThreadIndex);
+				}
+				else
+				{
+					++globals.droppedCount;
+				}
+			}
+			readIndex += count;
+		}
+		buffer.myReadIndex = writeIndex;
+	}
+
+	const uint32_t zoneCount = globals.zoneCount.load(std::memory_order_acquire);
+	for (uint32_t i = 0U; i < zoneCount; ++i)
+	{
+		ZoneHistory& zone = globals.zones[i];
+		zone.myLastCalls = zone.myFrameCalls;
+		zone.myLastMs = TicksToMilliseconds(zone.myFrameTicks);
+
+		if (zone.myFrameCalls > 0U)
+		{
+			zone.myHistoryMs[zone.myHistoryNext] = (float)zone.myLastMs;
+			zone.myHistoryNext = (zone.myHistoryNext + 1U) % HISTORY_FRAMES;
+			zone.myHistoryCount += zone.myHistoryCount < HISTORY_FRAMES ? 1U : 0U;
+		}
+
+		zone.myFrameTicks = 0U;
+		zone.myFrameCalls = 0U;
+	}
+
+	if (globals.captureFramesLeft > 0U)
+	{
+		--globals.captureFramesLeft;
+	}
+}
+
+uint32_t Profiler::GetZoneStats(ZoneStats* someStatsOut, uint32_t aMaxCount)
+{
+	const uint32_t zoneCount = globals.zoneCount.load(std::memory_order_acquire);
+	const uint32_t count = zoneCount < aMaxCount ? zoneCount : aMaxCount;
+
+	for (uint32_t i = 0U; i < count; ++i)
+	{
+		const ZoneHistory& zone = globals.zones[i];
+		ZoneStats& stats = someStatsOut[i];
+
+		stats.myName = zone.myName;
+		stats.myFrameCount = zone.myHistoryCount;
+		stats.myLastMs = zone.myLastMs;
+		stats.myLastCallCount = zone.myLastCalls;
+		stats.myMinMs = stats.myAvgMs = stats.myP99Ms = 0.0;
+
+		if (zone.myHistoryCount == 0U)
+		{
+			continue;
+		}
+
+		float sorted[HISTORY_FRAMES];
+		memcpy(sorted, zone.myHistoryMs, sizeof(float) * zone.myHistoryCount);
+		std::sort(sorted, sorted + zone.myHistoryCount);
+
+		double sum = 0.0;
+		for (uint32_t f = 0U; f < zone.myHistoryCount; ++f)
+		{
+			sum += sorted[f];
+		}
+
+		const uint32_t p99Index = (zone.myHistoryCount * 99U + 99U) / 100U - 1U;
+		stats.myMinMs = sorted[0];
+		stats.myAvgMs = sum / zone.myHistoryCount;
+		stats.myP99Ms = sorted[p99Index];
+	}
+
+	return count;
+}
+
+uint64_t Profiler::GetDroppedEventCount()
+{
+	return globals.droppedCount;
+}
+
+void Profiler::StartCapture(uint32_t aFrameCount)
+{
+	globals.captureCount = 0U;
+	globals.captureFramesLeft = aFrameCount;
+	globals.captureOriginTicks = Now();
+}
+
+bool Profiler::IsCapturing()
+{
+	return globals.captureFramesLeft > 0U;
+}
+
+bool Profiler::SaveCapture(const char* const aPath)
+{
+	char tempPath[512];
+	snprintf(tempPath, sizeof(tempPath), "%s.tmp", aPath);
+
+	FILE* file = fopen(tempPath, "wb");
+	if (!file)
+	{
+		return false;
+	}
+
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+
+	const uint32_t threadCount = globals.threadCount.load(std::memory_order_acquire);
+	for (uint32_t t = 0U; t < threadCount; ++t)
+	{
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"Thread %u\"}}",
+			t > 0U ? ",\n" : "", t, t);
+	}
+
+	const double microsecondsPerTick = globals.nanosecondsPerTick * 1e-3;
+	for (uint32_t i = 0U; i < globals.captureCount; ++i)
+	{
+		const CaptureEvent& event = globals.capture[i];
+		const double begin = (double)(int64_t)(event.myBegin - globals.captureOriginTicks) * microsecondsPerTick;
+		const double duration = (double)(event.myEnd - event.myBegin) * microsecondsPerTick;
+
+		fputs(threadCount > 0U || i > 0U ? ",\n{\"name\":\"" : "{\"name\":\"", file);
+		WriteEscaped(file, globals.zones[event.myZone].myName);
+		fprintf(file, "\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", event.myThreadIndex, begin, duration);
+	}
+
+	fputs("\n]}\n", file);
+
+	const bool succeeded = !ferror(file);
+	if (fclose(file) != 0 || !succeeded || rename(tempPath, aPath) != 0)
+	{
+		remove(tempPath);
+		return false;
+	}
+
+	return true;
+}
+
+#endif
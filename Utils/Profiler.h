@@ -0,0 +1,185 @@
+/*
+* Profiler
+*
+* Scoped CPU zones for frame profiling. PROFILE_ZONE("Name") times the rest of
+* the enclosing scope into a lock-free ring buffer owned by the calling
+* thread; PROFILE_FRAME_END() drains every thread's buffer on the main thread
+* and folds the zones into per-frame statistics, and into a Chrome trace
+* (chrome://tracing, Perfetto) while a capture is running.
+*
+* Zone names must outlive the profiler; pass string literals. Each
+* PROFILE_ZONE site looks its name up once, so recording a zone only reads
+* the clock twice and stores a timestamp and a zone id. Defining
+* PROFILER_DISABLED compiles every zone out and turns the interface into
+* no-ops.
+*
+* Requirements: C++17
+*/
+
+#if !defined(PROFILER_H_)
+#define PROFILER_H_
+
+#pragma once
+
+#include <stdint.h>
+
+#if !defined(PROFILER_DISABLED)
+#define PROFILER_ENABLED
+#endif
+
+#if defined(PROFILER_ENABLED)
+#include <atomic>
+#include <chrono>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PROFILER_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_RDTSC
+#endif
+#endif
+
+namespace Profiler
+{
+	constexpr uint32_t MAX_THREADS = 64U;
+	constexpr uint32_t MAX_ZONES = 64U;
+	/* Per thread; a thread that records more zones than this between two frame ends loses the oldest. */
+	constexpr uint32_t RING_CAPACITY = 1U << 13;
+	/* Frames the min/avg/p99 statistics look back over. */
+	constexpr uint32_t HISTORY_FRAMES = 256U;
+
+	struct ZoneStats
+	{
+		const char* myName;
+		/* Over the frames the zone ran in, within the last HISTORY_FRAMES. Times are per frame, summed over all threads. */
+		uint32_t myFrameCount;
+		double myLastMs;
+		double myMinMs;
+		double myAvgMs;
+		double myP99Ms;
+		uint32_t myLastCallCount;
+	};
+
+#if defined(PROFILER_ENABLED)
+	/* Drains the thread buffers and updates the statistics. Call once per frame, from one thread. */
+	void EndFrame();
+
+	/* Copies up to aMaxCount zones, in first-seen order. Returns how many were written. */
+	uint32_t GetZoneStats(ZoneStats* someStatsOut, uint32_t aMaxCount);
+	/* Events lost to full ring buffers or a full capture since the start. */
+	uint64_t GetDroppedEventCount();
+
+	/* Records every zone of the next aFrameCount frames, then stops by itself. */
+	void StartCapture(uint32_t aFrameCount);
+	bool IsCapturing();
+	/* Writes the last capture as Chrome trace JSON. */
+	bool SaveCapture(const char* const aPath);
+
+	/* Zone ids above this are out of range; RegisterZone() returns it once MAX_ZONES names are taken. */
+	constexpr uint32_t INVALID_ZONE = MAX_ZONES;
+	/* Events keep the zone id in the bits above the duration. */
+	constexpr uint32_t DURATION_BITS = 48U;
+	constexpr uint64_t DURATION_MASK = (1ULL << DURATION_BITS) - 1U;
+
+	/*
+	* Stored relaxed, so EndFrame() may read a slot while the owner overwrites
+	* it; EndFrame() then sees from the write index that the slot was lapped
+	* and drops what it read.
+	*/
+	struct Event
+	{
+		std::atomic<uint64_t> myBegin;
+		std::atomic<uint64_t> myZoneAndDuration;
+	};
+
+	/* Single producer (the owning thread), single consumer (EndFrame). */
+	struct ThreadBuffer
+	{
+		Event myEvents[RING_CAPACITY];
+		/* Events published so far; the slot of the next one may already be half written. */
+		std::atomic<uint64_t> myWriteIndex;
+		uint64_t myReadIndex;
+		std::atomic<bool> myIsOwned;
+		uint32_t myThreadIndex;
+	};
+
+	/* Id for zones named aName, the same for every call with an equal string. Takes a lock; PROFILE_ZONE calls it once per site. */
+	uint32_t RegisterZone(const char* aName);
+
+	/* Hands the calling thread a buffer, or nullptr once MAX_THREADS threads hold one. */
+	ThreadBuffer* AcquireThreadBuffer();
+
+	inline thread_local ThreadBuffer* ourThreadBuffer = nullptr;
+
+	/* Raw ticks; EndFrame converts them to time. */
+	inline uint64_t Now()
+	{
+#if defined(PROFILER_RDTSC)
+		return __rdtsc();
+#else
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	inline void Record(uint32_t aZone, uint64_t aBegin, uint64_t anEnd)
+	{
+		ThreadBuffer* buffer = ourThreadBuffer ? ourThreadBuffer : AcquireThreadBuffer();
+		if (!buffer)
+		{
+			return;
+		}
+
+		const uint64_t index = buffer->myWriteIndex.load(std::memory_order_relaxed);
+		/* Keeps the previous publish ahead of these stores, so a reader that sees them also sees the slot was taken. */
+		std::atomic_thread_fence(std::memory_order_release);
+
+		Event& event = buffer->myEvents[index & (RING_CAPACITY - 1U)];
+		event.myBegin.store(aBegin, std::memory_order_relaxed);
+		event.myZoneAndDuration.store((uint64_t)aZone << DURATION_BITS | ((anEnd - aBegin) & DURATION_MASK), std::memory_order_relaxed);
+		buffer->myWriteIndex.store(index + 1U, std::memory_order_release);
+	}
+
+	class Zone
+	{
+	public:
+		explicit Zone(uint32_t aZone)
+			: myZone(aZone)
+			, myBegin(Now())
+		{
+		}
+		~Zone()
+		{
+			Record(myZone, myBegin, Now());
+		}
+
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+
+	private:
+		uint32_t myZone;
+		uint64_t myBegin;
+	};
+#else
+	inline void EndFrame() {}
+	inline uint32_t GetZoneStats(ZoneStats*, uint32_t) { return 0U; }
+	inline uint64_t GetDroppedEventCount() { return 0U; }
+	inline void StartCapture(uint32_t) {}
+	inline bool IsCapturing() { return false; }
+	inline bool SaveCapture(const char* const) { return false; }
+#endif
+}
+
+#if defined(PROFILER_ENABLED)
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(aName) \
+	static const uint32_t PROFILE_CONCAT(profileZoneId, __LINE__) = Profiler::RegisterZone(aName); \
+	Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(PROFILE_CONCAT(profileZoneId, __LINE__))
+#define PROFILE_FRAME_END() Profiler::EndFrame()
+#else
+#define PROFILE_ZONE(aName)
+#define PROFILE_FRAME_END()
+#endif
+
+#endif // PROFILER_H_
@@ -0,0 +1,124 @@
+/*
+* Random
+*
+* xoshiro128** generator, seeded through splitmix64. Gives the same sequence
+* on every platform and compiler, which rand() and raylib's GetRandomValue()
+* do not, so it can drive deterministic simulations.
+*
+* Requirements: C++17
+*/
+
+#if !defined(RANDOM_H_)
+#define RANDOM_H_
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+class Random
+{
+public:
+	/* Constructors & Destructor */
+	Random()
+	{
+		Seed(0U);
+	}
+	explicit Random(uint64_t aSeed)
+	{
+		Seed(aSeed);
+	}
+	~Random() = default;
+
+	/* Interface */
+	void Seed(uint64_t aSeed)
+	{
+		for (int i = 0; i < 4; i += 2)
+		{
+			aSeed += 0x9E3779B97F4A7C15ULL;
+			uint64_t z = aSeed;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			z ^= z >> 31;
+
+			myState[i] = (uint32_t)z;
+			myState[i + 1] = (uint32_t)(z >> 32);
+		}
+	}
+
+	uint32_t Next()
+	{
+		const uint32_t result = Rotate(myState[1] * 5U, 7) * 9U;
+		const uint32_t t = myState[1] << 9;
+
+		myState[2] ^= myState[0];
+		myState[3] ^= myState[1];
+		myState[1] ^= myState[2];
+		myState[0] ^= myState[3];
+		myState[2] ^= t;
+		myState[3] = Rotate(myState[3], 11);
+
+		return result;
+	}
+
+	/* Uniform in [aMin, aMax], both inclusive like GetRandomValue(). Unbiased. */
+	int Range(int aMin, int aMax)
+	{
+		if (aMin > aMax)
+		{
+			const int swap = aMin;
+			aMin = aMax;
+			aMax = swap;
+		}
+
+		const uint64_t range = (uint64_t)((int64_t)aMax - (int64_t)aMin) + 1U;
+		if (range > UINT32_MAX)
+		{
+			return (int)((int64_t)aMin + Next());
+		}
+
+		/* Lemire's multiply-shift, rejecting the few values that would bias the result. */
+		uint64_t product = (uint64_t)Next() * range;
+		uint32_t low = (uint32_t)product;
+		if (low < range)
+		{
+			const uint32_t threshold = (uint32_t)((0x100000000ULL - range) % range);
+			while (low < threshold)
+			{
+				product = (uint64_t)Next() * range;
+				low = (uint32_t)product;
+			}
+		}
+
+		return (int)((int64_t)aMin + (int64_t)(product >> 32));
+	}
+
+	/* Uniform in [0, 1). */
+	float NextFloat()
+	{
+		return (Next() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	/* Getters & Setters */
+	const uint32_t* GetState() const
+	{
+		return myState;
+	}
+
+	/* Restores a state taken from GetState(), e.g. out of a snapshot. */
+	void SetState(const uint32_t someState[4])
+	{
+		memcpy(myState, someState, sizeof(myState));
+	}
+
+private:
+	static uint32_t Rotate(uint32_t aValue, int aShift)
+	{
+		return (aValue << aShift) | (aValue >> (32 - aShift));
+	}
+
+	/* Members */
+	uint32_t myState[4];
+};
+
+#endif // RANDOM_H_